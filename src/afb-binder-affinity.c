@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-affinity.h"
+
+/** maximum count of NUMA nodes */
+#define MAX_NODES 1024
+
+/** bits per item of a node mask */
+#define BITS (8 * sizeof(unsigned long))
+
+/** a mask of NUMA nodes */
+struct nodemask
+{
+	unsigned long bits[MAX_NODES / BITS];
+};
+
+/** the affinity before afb_binder_affinity_set */
+static cpu_set_t saved_cpus;
+
+/** is saved_cpus set? */
+static int saved;
+
+/** the memory policy before afb_binder_affinity_set */
+static int saved_mode;
+static struct nodemask saved_nodes;
+
+/** is the memory policy saved, and so changed? */
+static int saved_policy;
+
+/**
+ * Parses the list of CPUs 'list' in 'set'
+ *
+ * @return 0 on success or -EINVAL if the list is invalid
+ */
+static int parse_cpus(const char *list, cpu_set_t *set)
+{
+	unsigned long first, last;
+	char *end;
+
+	CPU_ZERO(set);
+	for (;;) {
+		first = strtoul(list, &end, 10);
+		if (end == list)
+			return -EINVAL;
+		last = first;
+		if (*end == '-') {
+			list = end + 1;
+			last = strtoul(list, &end, 10);
+			if (end == list)
+				return -EINVAL;
+		}
+		if (first > last || last >= CPU_SETSIZE)
+			return -EINVAL;
+		while (first <= last)
+			CPU_SET(first++, set);
+		while (*end == ' ' || *end == '\n')
+			end++;
+		if (*end == 0)
+			return 0;
+		if (*end != ',')
+			return -EINVAL;
+		list = end + 1;
+	}
+}
+
+/**
+ * Computes in 'nodes' the NUMA nodes having CPUs in 'cpus'
+ * or all the nodes when 'cpus' is NULL
+ *
+ * @return the count of nodes found
+ */
+static int get_nodes(const cpu_set_t *cpus, struct nodemask *nodes)
+{
+	DIR *dir;
+	struct dirent *ent;
+	cpu_set_t nodecpus;
+	unsigned long node;
+	char path[300], buffer[4096], *end;
+	FILE *file;
+	int count = 0, has;
+
+	memset(nodes, 0, sizeof *nodes);
+	dir = opendir("/sys/devices/system/node");
+	if (dir == NULL)
+		return 0;
+	while ((ent = readdir(dir)) != NULL) {
+		if (strncmp(ent->d_name, "node", 4))
+			continue;
+		node = strtoul(&ent->d_name[4], &end, 10);
+		if (end == &ent->d_name[4] || *end || node >= MAX_NODES)
+			continue;
+		has = cpus == NULL;
+		if (!has) {
+			snprintf(path, sizeof path, "/sys/devices/system/node/%s/cpulist", ent->d_name);
+			file = fopen(path, "r");
+			if (file == NULL)
+				continue;
+			if (fgets(buffer, sizeof buffer, file) != NULL && parse_cpus(buffer, &nodecpus) == 0) {
+				CPU_AND(&nodecpus, &nodecpus, cpus);
+				has = CPU_COUNT(&nodecpus) != 0;
+			}
+			fclose(file);
+		}
+		if (has) {
+			nodes->bits[node / BITS] |= 1UL << (node % BITS);
+			count++;
+		}
+	}
+	closedir(dir);
+	return count;
+}
+
+/* see afb-binder-affinity.h */
+int afb_binder_affinity_set(const char *cpus, const char *numa)
+{
+	cpu_set_t set;
+	struct nodemask nodes;
+	int mode, withnodes, rc;
+
+	/* set the affinity */
+	if (cpus != NULL) {
+		rc = parse_cpus(cpus, &set);
+		if (rc < 0) {
+			LIBAFB_ERROR("invalid list of CPUs %s", cpus);
+			return rc;
+		}
+		if (!saved && sched_getaffinity(0, sizeof saved_cpus, &saved_cpus) == 0)
+			saved = 1;
+		if (sched_setaffinity(0, sizeof set, &set) < 0) {
+			rc = -errno;
+			LIBAFB_ERROR("can't set the affinity to CPUs %s: %s", cpus, strerror(-rc));
+			return rc;
+		}
+		LIBAFB_INFO("threads restricted to CPUs %s", cpus);
+	}
+
+	/* set the memory policy */
+	if (numa != NULL) {
+		memset(&nodes, 0, sizeof nodes);
+		if (!strcmp(numa, "default"))
+			mode = MPOL_DEFAULT;
+		else if (!strcmp(numa, "local"))
+			mode = MPOL_LOCAL;
+		else if (!strcmp(numa, "bind"))
+			mode = MPOL_BIND;
+		else if (!strcmp(numa, "interleave"))
+			mode = MPOL_INTERLEAVE;
+		else {
+			LIBAFB_ERROR("invalid NUMA policy %s", numa);
+			return -EINVAL;
+		}
+		withnodes = mode == MPOL_BIND || mode == MPOL_INTERLEAVE;
+		if (withnodes && get_nodes(cpus == NULL ? NULL : &set, &nodes) == 0) {
+			LIBAFB_ERROR("no NUMA node for policy %s", numa);
+			return -ENOENT;
+		}
+		if (!saved_policy && syscall(SYS_get_mempolicy, &saved_mode, saved_nodes.bits, MAX_NODES, NULL, 0) == 0)
+			saved_policy = 1;
+		if (syscall(SYS_set_mempolicy, mode, withnodes ? nodes.bits : NULL, withnodes ? MAX_NODES + 1 : 0) < 0) {
+			rc = -errno;
+			LIBAFB_ERROR("can't set the NUMA policy %s: %s", numa, strerror(-rc));
+			return rc;
+		}
+		LIBAFB_INFO("NUMA policy set to %s", numa);
+	}
+	return 0;
+}
+
+/* see afb-binder-affinity.h */
+void afb_binder_affinity_restore(void)
+{
+	if (saved)
+		sched_setaffinity(0, sizeof saved_cpus, &saved_cpus);
+	if (saved_policy)
+		syscall(SYS_set_mempolicy, saved_mode, saved_nodes.bits, MAX_NODES + 1);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#pragma once
+
+/**
+ * Restricts the calling thread, and so the threads it creates after,
+ * to the CPUs of the list 'cpus' and sets its NUMA memory policy.
+ *
+ * The list of CPUs is a comma separated list of CPU numbers or of
+ * ranges of CPU numbers (example: "0-3,6").
+ *
+ * The NUMA policies are:
+ *  - default:    the policy of the system
+ *  - local:      allocates on the node of the CPU running the thread
+ *  - bind:       allocates only on the nodes of the CPUs of the list
+ *  - interleave: interleaves allocations on the nodes of the CPUs of the list
+ *
+ * When 'cpus' is NULL, all the nodes are used by bind and interleave.
+ *
+ * @param cpus the list of CPUs or NULL for not changing the affinity
+ * @param numa the NUMA policy or NULL for not changing the policy
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_affinity_set(const char *cpus, const char *numa);
+
+/**
+ * Restores for the calling thread the affinity and the NUMA policy
+ * of before afb_binder_affinity_set, for example in a forked child
+ * before executing an other program.
+ */
+extern void afb_binder_affinity_restore(void);
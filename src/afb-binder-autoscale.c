@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-sys.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-defaults.h"
+#include "afb-binder-autoscale.h"
+
+/** count of consecutive high samples for adding threads */
+#define UP_SAMPLES	2
+
+/** count of consecutive low samples for retiring a thread */
+#define DOWN_SAMPLES	30
+
+/** state of the autoscaling */
+static struct
+{
+	/** protection of the state */
+	pthread_mutex_t mutex;
+
+	/** is the autoscaling active */
+	int active;
+
+	/** bounds of the count of threads */
+	int min, max;
+
+	/** current count of threads */
+	int threads;
+
+	/** count of available CPUs */
+	int cpus;
+
+	/** expected time of the next sample */
+	struct timespec due;
+
+	/** last wait and its moving average in ns */
+	uint64_t wait, average;
+
+	/** last count of pending jobs */
+	int pending;
+
+	/** consecutive high and low samples */
+	unsigned highs, lows;
+
+	/** counts of samples and of decisions */
+	unsigned long samples, ups, downs;
+}
+	scaler = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+/* read the line of the file in buffer */
+static int read_line(const char *path, char *buffer, size_t size)
+{
+	FILE *file;
+	char *line;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+	line = fgets(buffer, (int)size, file);
+	fclose(file);
+	return line == NULL ? -1 : 0;
+}
+
+/* get the CPU quota of the cgroup in CPUs (rounded up) or 0 if none */
+static int cgroup_cpu_quota(void)
+{
+	char path[PATH_MAX], line[PATH_MAX];
+	long long quota, period;
+	FILE *file;
+	char *nl;
+
+	/* cgroup v2: "QUOTA PERIOD" or "max PERIOD" in cpu.max of the cgroup */
+	strcpy(path, "/sys/fs/cgroup/cpu.max");
+	file = fopen("/proc/self/cgroup", "r");
+	if (file != NULL) {
+		while (fgets(line, (int)sizeof line, file) != NULL) {
+			if (!strncmp(line, "0::", 3)) {
+				nl = strchr(line, '\n');
+				if (nl != NULL)
+					*nl = 0;
+				snprintf(path, sizeof path, "/sys/fs/cgroup%s/cpu.max",
+					strcmp(&line[3], "/") ? &line[3] : "");
+				break;
+			}
+		}
+		fclose(file);
+	}
+	if (read_line(path, line, sizeof line) == 0) {
+		if (sscanf(line, "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0)
+			return (int)((quota + period - 1) / period);
+		return 0;
+	}
+
+	/* cgroup v1 */
+	if (read_line("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", line, sizeof line) == 0
+	 && sscanf(line, "%lld", &quota) == 1 && quota > 0
+	 && read_line("/sys/fs/cgroup/cpu/cpu.cfs_period_us", line, sizeof line) == 0
+	 && sscanf(line, "%lld", &period) == 1 && period > 0)
+		return (int)((quota + period - 1) / period);
+	return 0;
+}
+
+/* see afb-binder-autoscale.h */
+int afb_binder_autoscale_bounds(int *min, int *max)
+{
+	cpu_set_t set;
+	int cpus, quota;
+
+	cpus = sched_getaffinity(0, sizeof set, &set) == 0 ? CPU_COUNT(&set) : 1;
+	quota = cgroup_cpu_quota();
+	if (quota > 0 && quota < cpus)
+		cpus = quota;
+	if (cpus < 1)
+		cpus = 1;
+
+	if (*max <= 0) {
+		*max = cpus * DEFAULT_AUTOSCALE_THREADS_PER_CPU;
+		if (*max < DEFAULT_THREADS_MAX)
+			*max = DEFAULT_THREADS_MAX;
+	}
+	if (*min < 1)
+		*min = 1;
+	if (*min > *max)
+		*min = *max;
+	return cpus;
+}
+
+/* set the count of threads of the scheduler */
+static void apply(int threads)
+{
+	afb_threads_setup_counts(threads, scaler.min);
+}
+
+/* schedule the next sample */
+static void schedule(void);
+
+/* job sampling the wait of jobs and deciding the count of threads */
+static void sample_job(int signum, void *arg)
+{
+	struct timespec now;
+	int64_t wait;
+	int pending, from, to;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	pending = afb_jobs_get_pending_count();
+
+	pthread_mutex_lock(&scaler.mutex);
+	/* the job is late of the time it waited in the queue */
+	wait = (int64_t)(now.tv_sec - scaler.due.tv_sec) * 1000000000
+		+ (int64_t)(now.tv_nsec - scaler.due.tv_nsec);
+	scaler.wait = wait > 0 ? (uint64_t)wait : 0;
+	scaler.average = scaler.samples ? (3 * scaler.average + scaler.wait) / 4 : scaler.wait;
+	scaler.pending = pending;
+	scaler.samples++;
+
+	/* hysteresis: add quickly, retire slowly */
+	if (scaler.average > DEFAULT_AUTOSCALE_WAIT_HIGH * 1000ull || pending > scaler.threads) {
+		scaler.highs++;
+		scaler.lows = 0;
+	}
+	else if (scaler.average < DEFAULT_AUTOSCALE_WAIT_LOW * 1000ull && pending == 0) {
+		scaler.lows++;
+		scaler.highs = 0;
+	}
+	else
+		scaler.highs = scaler.lows = 0;
+
+	from = to = scaler.threads;
+	if (scaler.highs >= UP_SAMPLES && from < scaler.max) {
+		to = from + (from + 1) / 2;
+		if (to > scaler.max)
+			to = scaler.max;
+		scaler.ups++;
+		scaler.highs = 0;
+	}
+	else if (scaler.lows >= DOWN_SAMPLES && from > scaler.min) {
+		to = from - 1;
+		scaler.downs++;
+		scaler.lows = 0;
+	}
+	scaler.threads = to;
+	pthread_mutex_unlock(&scaler.mutex);
+
+	if (to != from) {
+		apply(to);
+		LIBAFB_INFO("autoscale threads %d -> %d (wait %.3f ms, %d pending)",
+			from, to, (double)scaler.average / 1e6, pending);
+	}
+	schedule();
+}
+
+/* schedule the next sample */
+static void schedule(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &scaler.due);
+	scaler.due.tv_nsec += DEFAULT_AUTOSCALE_PERIOD * 1000000L;
+	scaler.due.tv_sec += scaler.due.tv_nsec / 1000000000L;
+	scaler.due.tv_nsec %= 1000000000L;
+	if (afb_sched_post_job(NULL, DEFAULT_AUTOSCALE_PERIOD, 0, sample_job, NULL, Afb_Sched_Mode_Normal) < 0)
+		LIBAFB_WARNING("autoscale of threads stopped: can't post sample job");
+}
+
+/* see afb-binder-autoscale.h */
+int afb_binder_autoscale_start(int min, int max)
+{
+	pthread_mutex_lock(&scaler.mutex);
+	if (scaler.active) {
+		pthread_mutex_unlock(&scaler.mutex);
+		LIBAFB_ERROR("autoscale of threads already active");
+		return -EEXIST;
+	}
+	scaler.active = 1;
+	scaler.min = min;
+	scaler.max = max;
+	scaler.cpus = afb_binder_autoscale_bounds(&scaler.min, &scaler.max);
+	scaler.threads = scaler.min;
+	pthread_mutex_unlock(&scaler.mutex);
+
+	apply(scaler.threads);
+	LIBAFB_NOTICE("autoscale threads between %d and %d (%d CPUs available)",
+		scaler.min, scaler.max, scaler.cpus);
+	schedule();
+	return 0;
+}
+
+/* see afb-binder-autoscale.h */
+struct json_object *afb_binder_autoscale_metrics(void)
+{
+	struct json_object *obj;
+
+	pthread_mutex_lock(&scaler.mutex);
+	if (!scaler.active)
+		obj = NULL;
+	else {
+		obj = json_object_new_object();
+		json_object_object_add(obj, "threads", json_object_new_int(scaler.threads));
+		json_object_object_add(obj, "min", json_object_new_int(scaler.min));
+		json_object_object_add(obj, "max", json_object_new_int(scaler.max));
+		json_object_object_add(obj, "cpus", json_object_new_int(scaler.cpus));
+		json_object_object_add(obj, "samples", json_object_new_int64((int64_t)scaler.samples));
+		json_object_object_add(obj, "ups", json_object_new_int64((int64_t)scaler.ups));
+		json_object_object_add(obj, "downs", json_object_new_int64((int64_t)scaler.downs));
+		json_object_object_add(obj, "pending", json_object_new_int(scaler.pending));
+		json_object_object_add(obj, "wait", json_object_new_int64((int64_t)(scaler.wait / 1000)));
+		json_object_object_add(obj, "wait-average", json_object_new_int64((int64_t)(scaler.average / 1000)));
+	}
+	pthread_mutex_unlock(&scaler.mutex);
+	return obj;
+}
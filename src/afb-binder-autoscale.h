@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#pragma once
+
+struct json_object;
+
+/**
+ * Computes the bounds of the autoscaling of threads.
+ *
+ * The count of CPUs available is the count of CPUs of the affinity of
+ * the process, reduced by the CPU quota of its cgroup if any.
+ *
+ * @param min the minimal count of threads, set to at least 1
+ * @param max the maximal count of threads or 0 for deducing it
+ *            from the count of available CPUs
+ *
+ * @return the count of available CPUs
+ */
+extern int afb_binder_autoscale_bounds(int *min, int *max);
+
+/**
+ * Starts the autoscaling of the threads of the scheduler, that must be
+ * running, between 'min' and 'max' threads.
+ *
+ * The wait time of jobs in the queue and the count of pending jobs are
+ * sampled periodically. Threads are added when jobs wait too long and
+ * retired after a longer time of low wait.
+ *
+ * @param min the minimal count of threads
+ * @param max the maximal count of threads
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_autoscale_start(int min, int max);
+
+/**
+ * Gets the metrics of the autoscaling: bounds, current count of
+ * threads, count of decisions and last samples.
+ *
+ * @return a new JSON object or NULL if the autoscaling is not active
+ */
+extern struct json_object *afb_binder_autoscale_metrics(void);
@@ -0,0 +1,646 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <json-c/json.h>
+
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-cache.h"
+
+/*
+ * Layout of the cache file (integers in host order, without alignment):
+ *
+ *   header    see struct header
+ *   deps      records of dependencies: kind, length, name, values
+ *   data      the configuration: tag, then value depending on the tag
+ *
+ * kinds of dependencies:
+ *   'F' file:      u64 mtime (ns), u64 size, u64 hash of the content
+ *   'D' directory: u64 mtime (ns)
+ *   'E' variable:  u64 hash of the value
+ *   'U' unset variable
+ *
+ * tags of values:
+ *   'n' null, 't' true, 'f' false, 'i' i64, 'd' double,
+ *   's' u32 length + bytes, 'a' u32 count + values,
+ *   'o' u32 count + (u32 length + bytes of key + value)
+ */
+
+/** magic of the cache files */
+static const char magic[8] = { 'A', 'F', 'B', 'C', 'F', 'G', 0, 1 };
+
+/** header of the cache file */
+struct header
+{
+	char magic[8];		/**< the magic */
+	uint64_t key;		/**< key of the arguments and environment */
+	uint64_t check;		/**< hash of deps and data */
+	uint32_t depsize;	/**< size of deps */
+	uint32_t datasize;	/**< size of data */
+};
+
+/** a recorded dependency */
+struct dep
+{
+	struct dep *next;	/**< next dependency */
+	char kind;		/**< kind of the dependency */
+	uint64_t values[3];	/**< values of the dependency */
+	char name[];		/**< name of the dependency */
+};
+
+/** growing buffer for writing */
+struct buf
+{
+	char *data;		/**< the data */
+	size_t size;		/**< used size */
+	size_t alloc;		/**< allocated size */
+	int error;		/**< allocation failed */
+};
+
+/** reading cursor */
+struct cursor
+{
+	const char *pos;	/**< current position */
+	const char *end;	/**< end of the data */
+};
+
+/** state of the cache */
+static struct {
+	char *filename;		/**< path of the cache file */
+	uint64_t key;		/**< the computed key */
+	struct dep *deps;	/**< recorded dependencies */
+	int active;		/**< is recording */
+} cache;
+
+/******************************************************************************/
+/* hashing                                                                    */
+/******************************************************************************/
+
+#define FNV_INIT  UINT64_C(14695981039346656037)
+
+static uint64_t hash(uint64_t h, const void *data, size_t size)
+{
+	const unsigned char *p = data;
+	while (size--)
+		h = (h ^ *p++) * UINT64_C(1099511628211);
+	return h;
+}
+
+static uint64_t hash_str(uint64_t h, const char *str)
+{
+	return hash(h, str, strlen(str) + 1);
+}
+
+/** hash the content of the file 'fd' */
+static int hash_fd(int fd, uint64_t *result)
+{
+	char buffer[16384];
+	ssize_t rc;
+	uint64_t h = FNV_INIT;
+
+	while ((rc = read(fd, buffer, sizeof buffer)) != 0) {
+		if (rc < 0) {
+			if (errno != EINTR)
+				return -errno;
+		}
+		else
+			h = hash(h, buffer, (size_t)rc);
+	}
+	*result = h;
+	return 0;
+}
+
+static uint64_t mtime_of(const struct stat *st)
+{
+	return (uint64_t)st->st_mtim.tv_sec * 1000000000 + (uint64_t)st->st_mtim.tv_nsec;
+}
+
+/** compute the values of the dependency of 'kind' and 'name' */
+static int dep_values(char kind, const char *name, uint64_t values[3])
+{
+	struct stat st;
+	const char *value;
+	int fd, rc;
+
+	values[0] = values[1] = values[2] = 0;
+	switch (kind) {
+	case 'F':
+		fd = open(name, O_RDONLY|O_CLOEXEC);
+		if (fd < 0)
+			return -errno;
+		rc = fstat(fd, &st) < 0 ? -errno : hash_fd(fd, &values[2]);
+		close(fd);
+		if (rc < 0)
+			return rc;
+		values[0] = mtime_of(&st);
+		values[1] = (uint64_t)st.st_size;
+		return 0;
+	case 'D':
+		if (stat(name, &st) < 0)
+			return -errno;
+		values[0] = mtime_of(&st);
+		return 0;
+	case 'E':
+	case 'U':
+		value = getenv(name);
+		if (value == NULL)
+			return kind == 'U' ? 0 : -ENOENT;
+		if (kind == 'U')
+			return -EEXIST;
+		values[0] = hash_str(FNV_INIT, value);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+/******************************************************************************/
+/* recording                                                                  */
+/******************************************************************************/
+
+static void record(char kind, const char *name)
+{
+	struct dep *dep;
+	size_t len;
+
+	for (dep = cache.deps ; dep ; dep = dep->next)
+		if (!strcmp(dep->name, name))
+			return;
+
+	len = strlen(name);
+	dep = malloc(sizeof *dep + len + 1);
+	if (dep == NULL || dep_values(kind, name, dep->values) < 0) {
+		/* an unknown dependency makes the cache unusable */
+		LIBAFB_WARNING("config cache can't track %s", name);
+		free(dep);
+		cache.active = 0;
+		return;
+	}
+	dep->kind = kind;
+	memcpy(dep->name, name, len + 1);
+	dep->next = cache.deps;
+	cache.deps = dep;
+}
+
+static void record_path(char kind, const char *path)
+{
+	char *real;
+
+	if (cache.active) {
+		real = realpath(path, NULL);
+		if (real == NULL) {
+			LIBAFB_WARNING("config cache can't track %s", path);
+			cache.active = 0;
+		}
+		else {
+			record(kind, real);
+			free(real);
+		}
+	}
+}
+
+void afb_binder_cache_record_file(const char *path)
+{
+	record_path('F', path);
+}
+
+void afb_binder_cache_record_dir(const char *path)
+{
+	record_path('D', path);
+}
+
+void afb_binder_cache_record_env(const char *name, size_t len, const char *value)
+{
+	char *var;
+
+	/* AFB_* variables are in the key, PWD, OLDPWD and the other AFB_*
+	 * variables are set by the binder from the config itself */
+	if (cache.active
+	 && (len < 4 || memcmp(name, "AFB_", 4))
+	 && (len != 3 || memcmp(name, "PWD", 3))
+	 && (len != 6 || memcmp(name, "OLDPWD", 6))) {
+		var = strndupa(name, len);
+		record(value ? 'E' : 'U', var);
+	}
+}
+
+/******************************************************************************/
+/* key                                                                        */
+/******************************************************************************/
+
+extern char **environ;
+
+void afb_binder_cache_begin(const char *filename, const char *stamp, int argc, char **argv)
+{
+	char *cwd;
+	char **env;
+	int i;
+	uint64_t h, envh;
+
+	h = hash_str(FNV_INIT, stamp);
+	cwd = getcwd(NULL, 0);
+	h = hash_str(h, cwd ?: "");
+	free(cwd);
+	for (i = 0 ; i < argc ; i++)
+		h = hash_str(h, argv[i]);
+
+	/* the sum makes it independent of the order of the variables */
+	envh = 0;
+	for (env = environ ; *env ; env++)
+		if (!strncmp(*env, "AFB_", 4))
+			envh += hash_str(FNV_INIT, *env);
+	h = hash(h, &envh, sizeof envh);
+
+	free(cache.filename);
+	cache.filename = strdup(filename);
+	cache.key = h;
+	cache.active = cache.filename != NULL;
+}
+
+/******************************************************************************/
+/* writing                                                                    */
+/******************************************************************************/
+
+static void put(struct buf *buf, const void *data, size_t size)
+{
+	size_t alloc;
+	char *ndata;
+
+	if (buf->error)
+		return;
+	if (buf->size + size > buf->alloc) {
+		alloc = buf->alloc ? buf->alloc : 4096;
+		while (buf->size + size > alloc)
+			alloc <<= 1;
+		ndata = realloc(buf->data, alloc);
+		if (ndata == NULL) {
+			buf->error = 1;
+			return;
+		}
+		buf->data = ndata;
+		buf->alloc = alloc;
+	}
+	memcpy(&buf->data[buf->size], data, size);
+	buf->size += size;
+}
+
+static void put_tag(struct buf *buf, char tag)
+{
+	put(buf, &tag, 1);
+}
+
+static void put_u32(struct buf *buf, size_t value)
+{
+	uint32_t u32 = (uint32_t)value;
+	if (value > UINT32_MAX)
+		buf->error = 1;
+	put(buf, &u32, sizeof u32);
+}
+
+static void put_str(struct buf *buf, const char *str, size_t len)
+{
+	put_u32(buf, len);
+	put(buf, str, len);
+}
+
+static void put_json(struct buf *buf, struct json_object *object)
+{
+	int64_t i64;
+	double dbl;
+	size_t idx, count;
+
+	switch (json_object_get_type(object)) {
+	case json_type_null:
+		put_tag(buf, 'n');
+		break;
+	case json_type_boolean:
+		put_tag(buf, json_object_get_boolean(object) ? 't' : 'f');
+		break;
+	case json_type_int:
+		i64 = json_object_get_int64(object);
+		put_tag(buf, 'i');
+		put(buf, &i64, sizeof i64);
+		break;
+	case json_type_double:
+		dbl = json_object_get_double(object);
+		put_tag(buf, 'd');
+		put(buf, &dbl, sizeof dbl);
+		break;
+	case json_type_string:
+		put_tag(buf, 's');
+		put_str(buf, json_object_get_string(object), (size_t)json_object_get_string_len(object));
+		break;
+	case json_type_array:
+		count = json_object_array_length(object);
+		put_tag(buf, 'a');
+		put_u32(buf, count);
+		for (idx = 0 ; idx < count ; idx++)
+			put_json(buf, json_object_array_get_idx(object, idx));
+		break;
+	case json_type_object:
+		put_tag(buf, 'o');
+		put_u32(buf, (size_t)json_object_object_length(object));
+		json_object_object_foreach(object, key, val) {
+			put_str(buf, key, strlen(key));
+			put_json(buf, val);
+		}
+		break;
+	}
+}
+
+static void put_deps(struct buf *buf)
+{
+	struct dep *dep;
+	int n;
+
+	for (dep = cache.deps ; dep ; dep = dep->next) {
+		put_tag(buf, dep->kind);
+		put_str(buf, dep->name, strlen(dep->name));
+		n = dep->kind == 'F' ? 3 : dep->kind == 'U' ? 0 : 1;
+		put(buf, dep->values, n * sizeof *dep->values);
+	}
+}
+
+static void forget(void)
+{
+	struct dep *dep;
+
+	cache.active = 0;
+	while ((dep = cache.deps) != NULL) {
+		cache.deps = dep->next;
+		free(dep);
+	}
+}
+
+int afb_binder_cache_save(struct json_object *config)
+{
+	struct buf buf = { NULL, 0, 0, 0 };
+	struct header head;
+	size_t depsize;
+	char *tmpname = NULL;
+	int fd, rc;
+
+	if (!cache.active) {
+		rc = -ECANCELED;
+		goto end;
+	}
+
+	/* serialize */
+	memset(&head, 0, sizeof head);
+	put(&buf, &head, sizeof head);
+	put_deps(&buf);
+	depsize = buf.size - sizeof head;
+	put_json(&buf, config);
+	if (buf.error) {
+		rc = -ENOMEM;
+		goto end;
+	}
+	memcpy(head.magic, magic, sizeof magic);
+	head.key = cache.key;
+	head.check = hash(FNV_INIT, &buf.data[sizeof head], buf.size - sizeof head);
+	head.depsize = (uint32_t)depsize;
+	head.datasize = (uint32_t)(buf.size - sizeof head - depsize);
+	memcpy(buf.data, &head, sizeof head);
+
+	/* write atomically */
+	if (asprintf(&tmpname, "%s.XXXXXX", cache.filename) < 0) {
+		tmpname = NULL;
+		rc = -ENOMEM;
+		goto end;
+	}
+	fd = mkostemp(tmpname, O_CLOEXEC);
+	if (fd < 0) {
+		rc = -errno;
+		goto end;
+	}
+	rc = write(fd, buf.data, buf.size) == (ssize_t)buf.size ? 0 : -errno ?: -EIO;
+	if (close(fd) < 0 && rc == 0)
+		rc = -errno;
+	if (rc == 0 && rename(tmpname, cache.filename) < 0)
+		rc = -errno;
+	if (rc < 0)
+		unlink(tmpname);
+	else
+		LIBAFB_INFO("config cache %s written", cache.filename);
+end:
+	if (rc < 0 && rc != -ECANCELED)
+		LIBAFB_WARNING("can't write config cache %s: %s", cache.filename, strerror(-rc));
+	free(tmpname);
+	free(buf.data);
+	forget();
+	return rc;
+}
+
+/******************************************************************************/
+/* reading                                                                    */
+/******************************************************************************/
+
+static int get(struct cursor *cur, void *data, size_t size)
+{
+	if ((size_t)(cur->end - cur->pos) < size)
+		return -1;
+	memcpy(data, cur->pos, size);
+	cur->pos += size;
+	return 0;
+}
+
+static int get_str(struct cursor *cur, const char **str, uint32_t *len)
+{
+	if (get(cur, len, sizeof *len) < 0 || (size_t)(cur->end - cur->pos) < *len)
+		return -1;
+	*str = cur->pos;
+	cur->pos += *len;
+	return 0;
+}
+
+static int get_json(struct cursor *cur, int depth, struct json_object **result)
+{
+	struct json_object *object, *item;
+	const char *str;
+	uint32_t len, count;
+	int64_t i64;
+	double dbl;
+	char tag, *key;
+
+	*result = NULL;
+	if (depth > 1000 || get(cur, &tag, 1) < 0)
+		return -1;
+
+	switch (tag) {
+	case 'n':
+		return 0;
+	case 't':
+	case 'f':
+		*result = json_object_new_boolean(tag == 't');
+		break;
+	case 'i':
+		if (get(cur, &i64, sizeof i64) < 0)
+			return -1;
+		*result = json_object_new_int64(i64);
+		break;
+	case 'd':
+		if (get(cur, &dbl, sizeof dbl) < 0)
+			return -1;
+		*result = json_object_new_double(dbl);
+		break;
+	case 's':
+		if (get_str(cur, &str, &len) < 0 || len > INT_MAX)
+			return -1;
+		*result = json_object_new_string_len(str, (int)len);
+		break;
+	case 'a':
+		if (get(cur, &count, sizeof count) < 0)
+			return -1;
+		object = json_object_new_array();
+		while (object && count--) {
+			if (get_json(cur, depth + 1, &item) < 0
+			 || json_object_array_add(object, item) < 0) {
+				json_object_put(item);
+				json_object_put(object);
+				return -1;
+			}
+		}
+		*result = object;
+		break;
+	case 'o':
+		if (get(cur, &count, sizeof count) < 0)
+			return -1;
+		object = json_object_new_object();
+		while (object && count--) {
+			if (get_str(cur, &str, &len) < 0
+			 || (key = strndup(str, len)) == NULL) {
+				json_object_put(object);
+				return -1;
+			}
+			if (get_json(cur, depth + 1, &item) < 0) {
+				free(key);
+				json_object_put(object);
+				return -1;
+			}
+			json_object_object_add(object, key, item);
+			free(key);
+		}
+		*result = object;
+		break;
+	default:
+		return -1;
+	}
+	return *result == NULL ? -1 : 0;
+}
+
+/** check that the recorded dependencies are unchanged */
+static int check_deps(struct cursor *cur)
+{
+	const char *name;
+	uint32_t len;
+	uint64_t values[3], current[3];
+	char kind, *str;
+	int n;
+
+	while (cur->pos < cur->end) {
+		if (get(cur, &kind, 1) < 0 || get_str(cur, &name, &len) < 0)
+			return -1;
+		n = kind == 'F' ? 3 : kind == 'U' ? 0 : 1;
+		if (get(cur, values, n * sizeof *values) < 0)
+			return -1;
+		str = strndupa(name, len);
+		if (dep_values(kind, str, current) < 0
+		 || memcmp(values, current, n * sizeof *values)) {
+			LIBAFB_INFO("config cache outdated by %s", str);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int afb_binder_cache_load(struct json_object **config)
+{
+	struct header head;
+	struct stat st;
+	struct cursor cur;
+	struct json_object *result = NULL;
+	void *map = MAP_FAILED;
+	const char *data;
+	int fd, rc = -1;
+
+	if (!cache.active)
+		return -1;
+
+	fd = open(cache.filename, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		goto end;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof head)
+		goto end;
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto end;
+
+	/* check the header */
+	data = map;
+	memcpy(&head, data, sizeof head);
+	if (memcmp(head.magic, magic, sizeof magic)
+	 || head.key != cache.key
+	 || sizeof head + head.depsize + head.datasize != (size_t)st.st_size
+	 || head.check != hash(FNV_INIT, &data[sizeof head], (size_t)st.st_size - sizeof head))
+		goto end;
+
+	/* check the dependencies */
+	cur.pos = &data[sizeof head];
+	cur.end = cur.pos + head.depsize;
+	if (check_deps(&cur) < 0)
+		goto end;
+
+	/* read the config */
+	cur.end = cur.pos + head.datasize;
+	if (get_json(&cur, 0, &result) < 0 || cur.pos != cur.end
+	 || !json_object_is_type(result, json_type_object))
+		goto end;
+
+	LIBAFB_INFO("config read from cache %s", cache.filename);
+	json_object_put(*config);
+	*config = result;
+	result = NULL;
+	forget();
+	rc = 0;
+end:
+	json_object_put(result);
+	if (map != MAP_FAILED)
+		munmap(map, (size_t)st.st_size);
+	if (fd >= 0)
+		close(fd);
+	return rc;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+
+struct json_object;
+
+/**
+ * Starts the use of the config cache file 'filename'.
+ *
+ * Computes the key of the cache from 'stamp' (identifying the binder),
+ * the current directory, the arguments and the AFB_* environment
+ * variables, then starts recording the files, directories and
+ * variables that contribute to the configuration.
+ *
+ * @param filename path of the cache file
+ * @param stamp    string identifying the version of the binder
+ * @param argc     count of arguments
+ * @param argv     the arguments
+ */
+extern void afb_binder_cache_begin(const char *filename, const char *stamp, int argc, char **argv);
+
+/**
+ * Loads the configuration from the cache file if it is still valid.
+ *
+ * @param config where to store the loaded configuration
+ *
+ * @return 0 on success or a negative value when the cache is missing,
+ * invalid or outdated
+ */
+extern int afb_binder_cache_load(struct json_object **config);
+
+/**
+ * Saves the final configuration in the cache file with the recorded
+ * dependencies and stops recording.
+ *
+ * @param config the configuration to save
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_cache_save(struct json_object *config);
+
+/** records that the configuration depends on the file of 'path' */
+extern void afb_binder_cache_record_file(const char *path);
+
+/** records that the configuration depends on the content of the directory 'path' */
+extern void afb_binder_cache_record_dir(const char *path);
+
+/** records that the configuration depends on the environment variable 'name' of 'len' */
+extern void afb_binder_cache_record_env(const char *name, size_t len, const char *value);
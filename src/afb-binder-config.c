@@ -26,9 +26,12 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <limits.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fts.h>
@@ -45,6 +48,40 @@
 #include <libafb/misc/afb-verbose.h>
 
 #include "afb-binder-config.h"
+#include "afb-binder-cache.h"
+
+/** maximum count of threads reading the files of a reference */
+#define MAX_READERS 8
+
+/**
+ * a file to be loaded
+ */
+struct pending
+{
+	/** path of the file */
+	char *path;
+
+	/** the read object */
+	struct json_object *obj;
+
+	/** status of the read */
+	int rc;
+};
+
+/**
+ * files read in parallel
+ */
+struct readers
+{
+	/** the files to read */
+	struct pending *pendings;
+
+	/** count of files to read */
+	unsigned count;
+
+	/** index of the next file to read */
+	unsigned next;
+};
 
 /**
  * callback data for expanding references
@@ -87,10 +124,21 @@ struct expref
 	/** found directory count when searching entries */
 	int found_directory;
 
+	/** files to be loaded and merged in that order */
+	struct pending *pendings;
+
+	/** count of files to be loaded */
+	unsigned npendings;
+
+	/** allocated count of pendings */
+	unsigned apendings;
+
 	/** path to a file or directory */
 	char filename[PATH_MAX + 1];
 };
 
+static int load_config_file(struct json_object **obj, const char *filename);
+
 /**
  * Emits an error for a given object of within path of ref
  *
@@ -198,45 +246,109 @@ static int search_path(struct expref *expref, const char *filename)
 }
 
 /**
- * Load the JSON object from the file of 'filename' in data of 'expref'
+ * Records the file of 'filename' for being loaded by 'load_pendings'
  *
  * @param expref the structure containing the data for merging
- * @param filename the file to be loaded relative to current context
- * @param path the file to be loaded but for printing
+ * @param filename the file to be loaded
  */
-static void merge_one_file(struct expref *expref, const char *filename, const char *path)
+static void add_pending(struct expref *expref, const char *filename)
 {
-	int rc;
-	struct json_object *obj;
-	
-	LIBAFB_NOTICE("Loading config file %s", path);
-
-	/* read the object in obj */
-	rc = read_config_file(&obj, filename);
-	if (rc < 0) {
-		LIBAFB_ERROR("Can't process json file %s: %s", path, strerror(-rc));
-		expref->expand_error_code = rc;
-	}
-	else {
-		expref->count++;
-		if (expref->target == NULL)
-			expref->target = obj;
-		else {
-			rp_jsonc_object_merge(expref->target, obj, expref->merge_option);
-			json_object_put(obj);
+	struct pending *pendings;
+	unsigned alloc;
+
+	if (expref->npendings == expref->apendings) {
+		alloc = expref->apendings ? 2 * expref->apendings : 16;
+		pendings = realloc(expref->pendings, alloc * sizeof *pendings);
+		if (pendings == NULL) {
+			expref->expand_error_code = -ENOMEM;
+			return;
 		}
+		expref->pendings = pendings;
+		expref->apendings = alloc;
 	}
+	pendings = &expref->pendings[expref->npendings];
+	pendings->path = strdup(filename);
+	if (pendings->path == NULL)
+		expref->expand_error_code = -ENOMEM;
+	else
+		expref->npendings++;
 }
 
 /**
- * Load the JSON object from the file of 'filename' in data of 'expref'
+ * Reads the pending files until none remains
+ */
+static void *read_pendings(void *closure)
+{
+	struct readers *readers = closure;
+	struct pending *pending;
+	unsigned idx;
+
+	while ((idx = __atomic_fetch_add(&readers->next, 1, __ATOMIC_RELAXED)) < readers->count) {
+		pending = &readers->pendings[idx];
+		pending->rc = load_config_file(&pending->obj, pending->path);
+	}
+	return NULL;
+}
+
+/**
+ * Count of threads for reading 'count' files
+ */
+static unsigned count_readers(unsigned count)
+{
+	cpu_set_t cpus;
+	unsigned n = MAX_READERS;
+
+	if (sched_getaffinity(0, sizeof cpus, &cpus) == 0 && (unsigned)CPU_COUNT(&cpus) < n)
+		n = (unsigned)CPU_COUNT(&cpus);
+	return count < n ? count : n;
+}
+
+/**
+ * Loads the pending files of 'expref' and merges them in their order.
+ * Files are read and parsed in parallel when there are many.
  *
  * @param expref the structure containing the data for merging
- * @param filename the file to be loaded
  */
-static void expand_a_file(struct expref *expref, const char *filename)
+static void load_pendings(struct expref *expref)
 {
-	merge_one_file(expref, filename, filename);
+	struct readers readers;
+	struct pending *pending;
+	pthread_t tids[MAX_READERS - 1];
+	unsigned idx, ntids, nreaders;
+
+	/* read the files */
+	readers.pendings = expref->pendings;
+	readers.count = expref->npendings;
+	readers.next = 0;
+	nreaders = count_readers(readers.count);
+	for (ntids = 0 ; ntids + 1 < nreaders ; ntids++)
+		if (pthread_create(&tids[ntids], NULL, read_pendings, &readers) != 0)
+			break;
+	read_pendings(&readers);
+	while (ntids)
+		pthread_join(tids[--ntids], NULL);
+
+	/* merge in order */
+	for (idx = 0 ; idx < expref->npendings ; idx++) {
+		pending = &expref->pendings[idx];
+		LIBAFB_NOTICE("Loading config file %s", pending->path);
+		if (pending->rc < 0) {
+			LIBAFB_ERROR("Can't process json file %s: %s", pending->path, strerror(-pending->rc));
+			expref->expand_error_code = pending->rc;
+		}
+		else {
+			afb_binder_cache_record_file(pending->path);
+			expref->count++;
+			if (expref->target == NULL)
+				expref->target = pending->obj;
+			else {
+				rp_jsonc_object_merge(expref->target, pending->obj, expref->merge_option);
+				json_object_put(pending->obj);
+			}
+		}
+		free(pending->path);
+	}
+	expref->npendings = 0;
 }
 
 /**
@@ -264,8 +376,11 @@ static void expand_a_directory(struct expref *expref)
 	}
 	else {
 		while((ent = fts_read(fts)) != NULL) {
+			/* FTS_LOGICAL implies FTS_NOCHDIR, fts_path is accessible */
 			if (ent->fts_info & FTS_F)
-				merge_one_file(expref, ent->fts_accpath, ent->fts_path);
+				add_pending(expref, ent->fts_path);
+			else if (ent->fts_info == FTS_D)
+				afb_binder_cache_record_dir(ent->fts_accpath);
 		}
 		fts_close(fts);
 	}
@@ -296,7 +411,7 @@ static void expand_ref(void *closure, struct json_object *object)
 			expref->error_code = rc;
 		}
 		else if (rc == 0) {
-			expand_a_file(expref, expref->filename);
+			add_pending(expref, expref->filename);
 		}
 		else {
 			if (expref->accept_dirs)
@@ -337,6 +452,7 @@ static struct json_object *expand_object(void *closure, struct json_object* obje
 		expref->expand_error_code = 0;
 		expref->merge_option = rp_jsonc_merge_option_replace;
 		rp_jsonc_optarray_for_all(ref, expand_ref, expref);
+		load_pendings(expref);
 		if (expref->count == 0 && expref->expand_error_code == 0) {
 			error_at_object(object, expand_path, "No refererence found in %s", json_object_get_string(object));
 			expref->expand_error_code = -EINVAL;
@@ -391,8 +507,10 @@ static int get_var(void *closure, const char *name, size_t len, rp_expand_vars_r
 	}
 
 	/* else search environment */
-	if (result == NULL)
+	if (result == NULL) {
 		result = rp_expand_vars_search_env(name, len);
+		afb_binder_cache_record_env(name, len, result);
+	}
 
 	vres->value = result;
 	return result != NULL;
@@ -487,7 +605,11 @@ int expand_config(struct json_object **config, int readrefs)
 
 	expref.pathsearch = NULL;
 	expref.error_code = 0;
+	expref.pendings = NULL;
+	expref.npendings = 0;
+	expref.apendings = 0;
 	obj = rp_jsonc_expand(*config, &expref, readrefs ? expand_object : NULL, expand_string);
+	free(expref.pendings);
 	if (obj != *config) {
 		json_object_put(*config);
 		*config = obj;
@@ -526,8 +648,8 @@ static int read_yaml_file(struct json_object **obj, const char *filename)
 }
 
 
-/* read a config file */
-int read_config_file(struct json_object **obj, const char *filename)
+/* read a config file, safe to call from several threads */
+static int load_config_file(struct json_object **obj, const char *filename)
 {
 	int rc;
 	if (access(filename, R_OK) < 0) {
@@ -546,3 +668,12 @@ int read_config_file(struct json_object **obj, const char *filename)
 	}
 	return rc;
 }
+
+/* read a config file */
+int read_config_file(struct json_object **obj, const char *filename)
+{
+	int rc = load_config_file(obj, filename);
+	if (rc >= 0)
+		afb_binder_cache_record_file(filename);
+	return rc;
+}
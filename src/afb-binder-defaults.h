@@ -66,6 +66,59 @@
 # define DEFAULT_THREADS_MAX		5
 #endif
 
+/**
+ * default count of threads preloading bindings
+ */
+#if !defined(DEFAULT_PRELOAD_THREADS)
+# define DEFAULT_PRELOAD_THREADS		4
+#endif
+
+/**
+ * default count of concurrent startup calls
+ */
+#if !defined(DEFAULT_CALL_PARALLEL)
+# define DEFAULT_CALL_PARALLEL		4
+#endif
+
+/**
+ * default settings for the autoscaling of threads
+ */
+#if !defined(DEFAULT_AUTOSCALE_PERIOD)
+# define DEFAULT_AUTOSCALE_PERIOD	100	/* sampling period in ms */
+#endif
+#if !defined(DEFAULT_AUTOSCALE_WAIT_HIGH)
+# define DEFAULT_AUTOSCALE_WAIT_HIGH	5000	/* wait in us above which threads are added */
+#endif
+#if !defined(DEFAULT_AUTOSCALE_WAIT_LOW)
+# define DEFAULT_AUTOSCALE_WAIT_LOW	500	/* wait in us below which threads are retired */
+#endif
+#if !defined(DEFAULT_AUTOSCALE_THREADS_PER_CPU)
+# define DEFAULT_AUTOSCALE_THREADS_PER_CPU	4
+#endif
+
+/**
+ * default settings for worker pools
+ */
+#if !defined(DEFAULT_POOL_THREADS)
+# define DEFAULT_POOL_THREADS		1
+#endif
+#if !defined(DEFAULT_POOL_QUEUE_MAX)
+# define DEFAULT_POOL_QUEUE_MAX		200
+#endif
+
+/**
+ * default settings for the fair queueing of requests
+ */
+#if !defined(DEFAULT_FAIR_QUANTUM)
+# define DEFAULT_FAIR_QUANTUM		8	/* units given to a session at each round */
+#endif
+#if !defined(DEFAULT_FAIR_COST_UNIT)
+# define DEFAULT_FAIR_COST_UNIT		1024	/* bytes of arguments costing one more unit */
+#endif
+#if !defined(DEFAULT_FAIR_QUEUE_MAX)
+# define DEFAULT_FAIR_QUEUE_MAX		64	/* requests waiting per session */
+#endif
+
 /***************************************************/
 #if WITH_LIBMICROHTTPD
 /**
@@ -75,6 +128,19 @@
 # define DEFAULT_CACHE_TIMEOUT		100000
 #endif
 
+/**
+ * default settings of the serving of static files from memory
+ */
+#if !defined(DEFAULT_STATIC_FILE_MAX)
+# define DEFAULT_STATIC_FILE_MAX	(8 * 1024 * 1024)	/* bigger files are not loaded */
+#endif
+#if !defined(DEFAULT_STATIC_CACHE_MAX)
+# define DEFAULT_STATIC_CACHE_MAX	(64 * 1024 * 1024)	/* total of loaded files */
+#endif
+#if !defined(DEFAULT_STATIC_CHECK_PERIOD)
+# define DEFAULT_STATIC_CHECK_PERIOD	1000	/* ms between checks of changes of a file */
+#endif
+
 /**
  * The default HTTP port to serve
  */
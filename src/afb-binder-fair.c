@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-sys.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-defaults.h"
+#include "afb-binder-fair.h"
+
+/** period in ms of the service of the waiting requests */
+#define DRAIN_PERIOD	10
+
+/** period in ms of the release of idle sessions */
+#define SWEEP_PERIOD	1000
+
+/** size of the hash table of flows */
+#define FLOWS_HASH	64
+
+/** tokens are counted in thousandths of request */
+#define MILLI		1000
+
+/** a token bucket */
+struct bucket
+{
+	/** available tokens in thousandths */
+	uint64_t tokens;
+
+	/** time of the last refill in ns */
+	uint64_t stamp;
+};
+
+/** a rate limit, rate == 0 when none */
+struct limit
+{
+	/** requests per second */
+	uint64_t rate;
+
+	/** size of the bucket in thousandths */
+	uint64_t burst;
+};
+
+/** a request waiting its turn */
+struct waiting
+{
+	/** next request of the flow */
+	struct waiting *next;
+
+	/** the request */
+	struct afb_req_common *req;
+
+	/** the admission */
+	void (*admit)(void *closure, struct afb_req_common *req);
+	void *closure;
+
+	/** cost of the request */
+	unsigned cost;
+};
+
+/** the flow of requests of a session */
+struct flow
+{
+	/** next flow of the hash chain */
+	struct flow *next;
+
+	/** next active flow */
+	struct flow *rnext;
+
+	/** the session, NULL for requests without session */
+	struct afb_session *session;
+
+	/** the bucket of the session */
+	struct bucket bucket;
+
+	/** the waiting requests */
+	struct waiting *head, **tail;
+
+	/** count of waiting requests */
+	unsigned count;
+
+	/** deficit of the round robin */
+	unsigned deficit;
+};
+
+/** an interface */
+struct intf
+{
+	/** next interface */
+	struct intf *next;
+
+	/** the bucket of the interface */
+	struct bucket bucket;
+
+	/** count of throttled requests */
+	unsigned long throttled;
+
+	/** name of the interface */
+	char name[];
+};
+
+/** state of fair admission */
+static struct
+{
+	/** protection of the state */
+	pthread_mutex_t mutex;
+
+	/** limits of sessions and of interfaces */
+	struct limit session, intf;
+
+	/** threshold of fair queueing: negative if none, 0 for default */
+	int queue;
+
+	/** the flows */
+	struct flow *flows[FLOWS_HASH];
+
+	/** count of flows */
+	unsigned nflows;
+
+	/** active flows */
+	struct flow *active, **atail;
+
+	/** count of waiting requests */
+	unsigned nwaiting;
+
+	/** posted jobs */
+	int draining, sweeping;
+
+	/** the interfaces */
+	struct intf *intfs;
+
+	/** counters */
+	unsigned long admitted, throttled, queued, dropped;
+}
+	fair = { .mutex = PTHREAD_MUTEX_INITIALIZER, .queue = -1, .atail = &fair.active };
+
+/* current monotonic time in ns */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* refill the bucket, returns 1 if it is full */
+static int bucket_refill(struct bucket *bucket, const struct limit *limit, uint64_t now)
+{
+	uint64_t elapsed, full, credit;
+
+	if (limit->rate == 0)
+		return 1;
+	if (bucket->stamp != 0) {
+		/* tokens are given at rate per second, i.e. rate / 10^6 thousandths per ns */
+		elapsed = now - bucket->stamp;
+		full = limit->burst * 1000000 / limit->rate;
+		credit = elapsed >= full ? limit->burst : elapsed * limit->rate / 1000000;
+		if (bucket->tokens + credit < limit->burst) {
+			/* only the time converted in tokens is consumed, keeping the remainder */
+			bucket->tokens += credit;
+			bucket->stamp += credit * 1000000 / limit->rate;
+			return 0;
+		}
+	}
+	bucket->tokens = limit->burst;
+	bucket->stamp = now;
+	return 1;
+}
+
+/* take a token of the bucket, returns 1 on success or 0 if empty */
+static int bucket_take(struct bucket *bucket, const struct limit *limit, uint64_t now)
+{
+	if (limit->rate == 0)
+		return 1;
+	bucket_refill(bucket, limit, now);
+	if (bucket->tokens < MILLI)
+		return 0;
+	bucket->tokens -= MILLI;
+	return 1;
+}
+
+/* reply the error 'text' to the request */
+static void reply_error(struct afb_req_common *req, const char *text)
+{
+	struct afb_data *data;
+
+	if (afb_data_create_raw(&data, &afb_type_predefined_stringz, text, strlen(text) + 1, NULL, NULL) < 0)
+		afb_req_common_reply_hookable(req, AFB_ERRNO_NOT_AVAILABLE, 0, NULL);
+	else
+		afb_req_common_reply_hookable(req, AFB_ERRNO_NOT_AVAILABLE, 1, &data);
+}
+
+/* get the interface of name, must be locked */
+static struct intf *get_intf(const char *name)
+{
+	struct intf *intf;
+	size_t len;
+
+	for (intf = fair.intfs ; intf != NULL ; intf = intf->next)
+		if (!strcmp(intf->name, name))
+			return intf;
+	len = strlen(name) + 1;
+	intf = calloc(1, sizeof *intf + len);
+	if (intf != NULL) {
+		memcpy(intf->name, name, len);
+		intf->next = fair.intfs;
+		fair.intfs = intf;
+	}
+	return intf;
+}
+
+/* get the flow of the session, must be locked */
+static struct flow *get_flow(struct afb_session *session)
+{
+	struct flow *flow, **pflow;
+
+	pflow = &fair.flows[((uintptr_t)session >> 4) % FLOWS_HASH];
+	for (flow = *pflow ; flow != NULL ; flow = flow->next)
+		if (flow->session == session)
+			return flow;
+	flow = calloc(1, sizeof *flow);
+	if (flow != NULL) {
+		flow->session = session ? afb_session_addref(session) : NULL;
+		flow->tail = &flow->head;
+		flow->next = *pflow;
+		*pflow = flow;
+		fair.nflows++;
+	}
+	return flow;
+}
+
+/* count of pending jobs above which requests wait */
+static int threshold(void)
+{
+	return fair.queue > 0 ? fair.queue : afb_jobs_get_max_count() / 2;
+}
+
+/* cost of the request for the round robin */
+static unsigned cost_of(struct afb_req_common *req)
+{
+	size_t size = 0;
+	unsigned idx;
+
+	for (idx = 0 ; idx < req->params.count ; idx++)
+		size += afb_data_size(req->params.data[idx]);
+	return 1 + (unsigned)(size / DEFAULT_FAIR_COST_UNIT);
+}
+
+static void schedule_drain(void);
+static void schedule_sweep(void);
+
+/* job admitting a request served by the round robin */
+static void admit_job(int signum, void *arg)
+{
+	struct waiting *w = arg;
+
+	if (signum)
+		afb_req_common_reply_unavailable_error_hookable(w->req);
+	else
+		w->admit(w->closure, w->req);
+	afb_req_common_unref(w->req);
+	free(w);
+}
+
+/* serves the waiting requests in deficit round robin, must be locked */
+static void drain(void)
+{
+	struct flow *flow;
+	struct waiting *w;
+	int limit = threshold();
+
+	while ((flow = fair.active) != NULL && afb_jobs_get_pending_count() < limit) {
+		/* a flow is given its quantum once per round */
+		if (flow->deficit < flow->head->cost)
+			flow->deficit += DEFAULT_FAIR_QUANTUM;
+		while ((w = flow->head) != NULL && w->cost <= flow->deficit
+				&& afb_jobs_get_pending_count() < limit) {
+			flow->head = w->next;
+			flow->deficit -= w->cost;
+			if (afb_sched_post_job(NULL, 0, 0, admit_job, w, Afb_Sched_Mode_Normal) < 0) {
+				/* the queue is full, retry later */
+				flow->head = w;
+				flow->deficit += w->cost;
+				return;
+			}
+			if (flow->head == NULL)
+				flow->tail = &flow->head;
+			flow->count--;
+			fair.nwaiting--;
+		}
+		/* the scheduler is busy, the flow keeps its turn */
+		if (flow->head != NULL && flow->head->cost <= flow->deficit)
+			break;
+
+		/* the flow leaves the head of the round */
+		fair.active = flow->rnext;
+		if (fair.active == NULL)
+			fair.atail = &fair.active;
+		flow->rnext = NULL;
+		if (flow->head == NULL)
+			flow->deficit = 0;
+		else {
+			/* the flow waits the next round */
+			*fair.atail = flow;
+			fair.atail = &flow->rnext;
+		}
+	}
+}
+
+/* job serving the waiting requests */
+static void drain_job(int signum, void *arg)
+{
+	pthread_mutex_lock(&fair.mutex);
+	fair.draining = 0;
+	drain();
+	if (fair.nwaiting)
+		schedule_drain();
+	pthread_mutex_unlock(&fair.mutex);
+}
+
+/* post the job serving the waiting requests, must be locked */
+static void schedule_drain(void)
+{
+	if (!fair.draining)
+		fair.draining = afb_sched_post_job(NULL, DRAIN_PERIOD, 0, drain_job, NULL, Afb_Sched_Mode_Normal) >= 0;
+}
+
+/* job releasing the idle flows */
+static void sweep_job(int signum, void *arg)
+{
+	struct flow *flow, **pflow, *idle = NULL;
+	uint64_t now = now_ns();
+	int idx;
+
+	pthread_mutex_lock(&fair.mutex);
+	fair.sweeping = 0;
+	for (idx = 0 ; idx < FLOWS_HASH ; idx++) {
+		pflow = &fair.flows[idx];
+		while ((flow = *pflow) != NULL) {
+			if (flow->head != NULL || !bucket_refill(&flow->bucket, &fair.session, now))
+				pflow = &flow->next;
+			else {
+				*pflow = flow->next;
+				flow->next = idle;
+				idle = flow;
+				fair.nflows--;
+			}
+		}
+	}
+	if (fair.nflows)
+		schedule_sweep();
+	pthread_mutex_unlock(&fair.mutex);
+
+	while ((flow = idle) != NULL) {
+		idle = flow->next;
+		if (flow->session != NULL)
+			afb_session_unref(flow->session);
+		free(flow);
+	}
+}
+
+/* post the job releasing the idle flows, must be locked */
+static void schedule_sweep(void)
+{
+	if (!fair.sweeping)
+		fair.sweeping = afb_sched_post_job(NULL, SWEEP_PERIOD, 0, sweep_job, NULL, Afb_Sched_Mode_Normal) >= 0;
+}
+
+/* see afb-binder-fair.h */
+void afb_binder_fair_submit(
+		const char *name,
+		struct afb_req_common *req,
+		void (*admit)(void *closure, struct afb_req_common *req),
+		void *closure
+) {
+	struct intf *intf;
+	struct flow *flow;
+	struct waiting *w;
+	uint64_t now = now_ns();
+
+	pthread_mutex_lock(&fair.mutex);
+
+	/* check the limit of the interface */
+	intf = fair.intf.rate ? get_intf(name) : NULL;
+	if (intf != NULL && !bucket_take(&intf->bucket, &fair.intf, now)) {
+		intf->throttled++;
+		goto throttled;
+	}
+
+	/* check the limit of the session */
+	flow = get_flow(req->session);
+	if (flow == NULL) {
+		LIBAFB_ERROR("out of memory");
+		goto admitted;
+	}
+	schedule_sweep();
+	if (!bucket_take(&flow->bucket, &fair.session, now))
+		goto throttled;
+
+	/* admit the request if no one waits and the scheduler is not busy */
+	if (fair.queue < 0 || (fair.nwaiting == 0 && afb_jobs_get_pending_count() < threshold()))
+		goto admitted;
+
+	/* the request waits its turn */
+	if (flow->count >= DEFAULT_FAIR_QUEUE_MAX || (w = malloc(sizeof *w)) == NULL) {
+		fair.dropped++;
+		pthread_mutex_unlock(&fair.mutex);
+		reply_error(req, "overloaded");
+		return;
+	}
+	w->next = NULL;
+	w->req = afb_req_common_addref(req);
+	w->admit = admit;
+	w->closure = closure;
+	w->cost = cost_of(req);
+	*flow->tail = w;
+	flow->tail = &w->next;
+	if (flow->count++ == 0) {
+		*fair.atail = flow;
+		fair.atail = &flow->rnext;
+	}
+	fair.nwaiting++;
+	fair.queued++;
+	fair.admitted++;
+	schedule_drain();
+	pthread_mutex_unlock(&fair.mutex);
+	return;
+
+admitted:
+	fair.admitted++;
+	pthread_mutex_unlock(&fair.mutex);
+	admit(closure, req);
+	return;
+
+throttled:
+	fair.throttled++;
+	pthread_mutex_unlock(&fair.mutex);
+	reply_error(req, "throttled");
+}
+
+/* set the limit from text RATE[:BURST] */
+static int set_limit(struct limit *limit, const char *text)
+{
+	char *end;
+	unsigned long rate, burst;
+
+	if (text == NULL)
+		return 0;
+	rate = strtoul(text, &end, 10);
+	burst = rate;
+	if (*end == ':')
+		burst = strtoul(&end[1], &end, 10);
+	if (rate == 0 || burst == 0 || *end) {
+		LIBAFB_ERROR("invalid rate limit %s", text);
+		return -EINVAL;
+	}
+	limit->rate = rate;
+	limit->burst = (uint64_t)burst * MILLI;
+	return 0;
+}
+
+/* see afb-binder-fair.h */
+int afb_binder_fair_setup(const char *session_rate, const char *intf_rate, int fair_queue)
+{
+	if (set_limit(&fair.session, session_rate) < 0 || set_limit(&fair.intf, intf_rate) < 0)
+		return -EINVAL;
+	fair.queue = fair_queue;
+	return 0;
+}
+
+/* see afb-binder-fair.h */
+int afb_binder_fair_is_active(void)
+{
+	return fair.session.rate != 0 || fair.intf.rate != 0 || fair.queue >= 0;
+}
+
+/* see afb-binder-fair.h */
+struct json_object *afb_binder_fair_metrics(void)
+{
+	struct json_object *obj, *intfs;
+	struct intf *intf;
+
+	if (!afb_binder_fair_is_active())
+		return NULL;
+	obj = json_object_new_object();
+	intfs = json_object_new_object();
+	pthread_mutex_lock(&fair.mutex);
+	json_object_object_add(obj, "admitted", json_object_new_int64((int64_t)fair.admitted));
+	json_object_object_add(obj, "throttled", json_object_new_int64((int64_t)fair.throttled));
+	json_object_object_add(obj, "queued", json_object_new_int64((int64_t)fair.queued));
+	json_object_object_add(obj, "dropped", json_object_new_int64((int64_t)fair.dropped));
+	json_object_object_add(obj, "waiting", json_object_new_int((int)fair.nwaiting));
+	json_object_object_add(obj, "sessions", json_object_new_int((int)fair.nflows));
+	for (intf = fair.intfs ; intf != NULL ; intf = intf->next)
+		json_object_object_add(intfs, intf->name, json_object_new_int64((int64_t)intf->throttled));
+	json_object_object_add(obj, "throttled-by-interface", intfs);
+	pthread_mutex_unlock(&fair.mutex);
+	return obj;
+}
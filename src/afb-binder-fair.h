@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#pragma once
+
+struct afb_req_common;
+struct json_object;
+
+/**
+ * Sets the limits of the fair admission of requests
+ *
+ * @param session_rate   "RATE[:BURST]" requests per second allowed to a
+ *                       session or NULL for no limit
+ * @param intf_rate      "RATE[:BURST]" requests per second allowed to an
+ *                       interface or NULL for no limit
+ * @param fair_queue     count of pending jobs above which the requests
+ *                       wait in queues of sessions served in deficit
+ *                       round robin, 0 for half of jobs-max, negative
+ *                       for no fair queueing
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_fair_setup(const char *session_rate, const char *intf_rate, int fair_queue);
+
+/**
+ * Tells whether rate limits or fair queueing are set
+ *
+ * @return 1 if set, 0 otherwise
+ */
+extern int afb_binder_fair_is_active(void);
+
+/**
+ * Submits the request received on the interface of name 'intf'.
+ * If the limits of its session or of the interface are exceeded, the
+ * request is replied with the error "throttled". Otherwise, it is given
+ * to 'admit', immediately or after waiting its turn.
+ *
+ * @param intf    name of the interface receiving the request
+ * @param req     the request
+ * @param admit   the function admitting the request
+ * @param closure closure of admit
+ */
+extern void afb_binder_fair_submit(
+		const char *intf,
+		struct afb_req_common *req,
+		void (*admit)(void *closure, struct afb_req_common *req),
+		void *closure);
+
+/**
+ * Gets the counts of the requests admitted, queued and throttled
+ *
+ * @return a new JSON object or NULL if nothing is set
+ */
+extern struct json_object *afb_binder_fair_metrics(void);
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-apis.h>
+#include <libafb/afb-sys.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-lazy.h"
+
+/** states of a lazy binding */
+enum state
+{
+	Lazy_Idle,	/**< not loaded */
+	Lazy_Loading,	/**< being loaded and started */
+	Lazy_Active,	/**< loaded and started */
+	Lazy_Failed	/**< loading or starting failed */
+};
+
+/** a lazily loaded binding */
+struct lazy
+{
+	/** state of the binding */
+	enum state state;
+
+	/** log mask to set to the API once active (-1 if unset) */
+	int logmask;
+
+	/** protection of state and queue */
+	pthread_mutex_t mutex;
+
+	/** requests waiting activation */
+	struct afb_req_common **queue;
+
+	/** count of queued requests */
+	unsigned count;
+
+	/** allocated count of queue */
+	unsigned alloc;
+
+	/** the apiset where the binding is declared when active */
+	struct afb_apiset *set;
+
+	/** the API of the binding when active */
+	struct afb_api_item item;
+
+	/** the call set of the binding */
+	struct afb_apiset *call_set;
+
+	/** the configuration of the binding */
+	struct json_object *config;
+
+	/** name of the API */
+	char *apiname;
+
+	/** path of the binding */
+	char *path;
+};
+
+/* load and start the binding */
+static int activate(struct lazy *lazy)
+{
+	const struct afb_api_item *item;
+	int rc;
+
+	lazy->set = afb_apiset_create(lazy->apiname, afb_apiset_timeout_get(lazy->call_set));
+	if (lazy->set == NULL) {
+		LIBAFB_ERROR("can't create apiset of lazy binding %s", lazy->path);
+		return -ENOMEM;
+	}
+	rc = afb_api_so_add_binding_config(lazy->path, lazy->set, lazy->call_set, lazy->config);
+	if (rc < 0) {
+		LIBAFB_ERROR("can't load lazy binding %s", lazy->path);
+		return rc;
+	}
+	rc = afb_apiset_get_api(lazy->set, lazy->apiname, 0, 0, &item);
+	if (rc < 0) {
+		LIBAFB_ERROR("lazy binding %s doesn't declare the API %s", lazy->path, lazy->apiname);
+		return rc;
+	}
+	rc = afb_apiset_start_all_services(lazy->set);
+	if (rc < 0) {
+		LIBAFB_ERROR("can't start lazy binding %s", lazy->path);
+		return rc;
+	}
+	lazy->item = *item;
+	LIBAFB_NOTICE("lazy binding %s activated for API %s", lazy->path, lazy->apiname);
+	return 0;
+}
+
+/** a request forwarded to an API of a group */
+struct forward
+{
+	struct lazy *lazy;
+	struct afb_req_common *req;
+};
+
+/* job processing a forwarded request in the group of the API */
+static void forward_job(int signum, void *arg)
+{
+	struct forward *fwd = arg;
+
+	if (signum)
+		afb_req_common_reply_unavailable_error_hookable(fwd->req);
+	else
+		fwd->lazy->item.itf->process(fwd->lazy->item.closure, fwd->req);
+	afb_req_common_unref(fwd->req);
+	free(fwd);
+}
+
+/* gives the request to the API of the binding, in its group if any */
+static void forward(struct lazy *lazy, struct afb_req_common *req)
+{
+	struct forward *fwd;
+
+	if (lazy->item.group != NULL) {
+		fwd = malloc(sizeof *fwd);
+		if (fwd != NULL) {
+			fwd->lazy = lazy;
+			fwd->req = afb_req_common_addref(req);
+			if (afb_sched_post_job(lazy->item.group, 0, 0, forward_job, fwd, Afb_Sched_Mode_Normal) >= 0)
+				return;
+			afb_req_common_unref(req);
+			free(fwd);
+		}
+	}
+	lazy->item.itf->process(lazy->item.closure, req);
+}
+
+/* job activating the binding and flushing the queued requests */
+static void activate_job(int signum, void *arg)
+{
+	struct lazy *lazy = arg;
+	struct afb_req_common **queue;
+	unsigned idx, count;
+	int rc;
+
+	rc = signum ? -EINTR : activate(lazy);
+
+	pthread_mutex_lock(&lazy->mutex);
+	lazy->state = rc < 0 ? Lazy_Failed : Lazy_Active;
+	if (rc >= 0 && lazy->logmask >= 0 && lazy->item.itf->set_logmask)
+		lazy->item.itf->set_logmask(lazy->item.closure, lazy->logmask);
+	queue = lazy->queue;
+	count = lazy->count;
+	lazy->queue = NULL;
+	lazy->count = lazy->alloc = 0;
+	pthread_mutex_unlock(&lazy->mutex);
+
+	for (idx = 0 ; idx < count ; idx++) {
+		if (rc < 0)
+			afb_req_common_reply_unavailable_error_hookable(queue[idx]);
+		else
+			forward(lazy, queue[idx]);
+		afb_req_common_unref(queue[idx]);
+	}
+	free(queue);
+}
+
+/* queue the request, returns 0 on success or a negative error code */
+static int enqueue(struct lazy *lazy, struct afb_req_common *req)
+{
+	struct afb_req_common **queue;
+	unsigned alloc;
+
+	if (lazy->count == lazy->alloc) {
+		alloc = lazy->alloc ? 2 * lazy->alloc : 8;
+		queue = realloc(lazy->queue, alloc * sizeof *queue);
+		if (queue == NULL)
+			return -ENOMEM;
+		lazy->queue = queue;
+		lazy->alloc = alloc;
+	}
+	lazy->queue[lazy->count++] = afb_req_common_addref(req);
+	return 0;
+}
+
+/* process a request of the placeholder */
+static void lazy_process(void *closure, struct afb_req_common *req)
+{
+	struct lazy *lazy = closure;
+	int rc;
+
+	pthread_mutex_lock(&lazy->mutex);
+	switch (lazy->state) {
+	case Lazy_Active:
+		pthread_mutex_unlock(&lazy->mutex);
+		forward(lazy, req);
+		return;
+
+	case Lazy_Idle:
+		rc = enqueue(lazy, req);
+		if (rc >= 0) {
+			lazy->state = Lazy_Loading;
+			rc = afb_sched_post_job(lazy, 0, 0, activate_job, lazy, Afb_Sched_Mode_Start);
+			if (rc < 0) {
+				LIBAFB_ERROR("can't activate lazy binding %s", lazy->path);
+				lazy->state = Lazy_Idle;
+				afb_req_common_unref(lazy->queue[--lazy->count]);
+			}
+		}
+		break;
+
+	case Lazy_Loading:
+		rc = enqueue(lazy, req);
+		break;
+
+	default:
+		rc = -1;
+		break;
+	}
+	pthread_mutex_unlock(&lazy->mutex);
+	if (rc < 0)
+		afb_req_common_reply_unavailable_error_hookable(req);
+}
+
+/* tells whether the binding is active */
+static int is_active(struct lazy *lazy)
+{
+	enum state state;
+
+	pthread_mutex_lock(&lazy->mutex);
+	state = lazy->state;
+	pthread_mutex_unlock(&lazy->mutex);
+	return state == Lazy_Active;
+}
+
+/* the placeholder is started without loading the binding */
+static int lazy_service_start(void *closure)
+{
+	return 0;
+}
+
+static int lazy_get_logmask(void *closure)
+{
+	struct lazy *lazy = closure;
+
+	if (is_active(lazy) && lazy->item.itf->get_logmask)
+		return lazy->item.itf->get_logmask(lazy->item.closure);
+	return lazy->logmask < 0 ? afb_verbose_get() : lazy->logmask;
+}
+
+static void lazy_set_logmask(void *closure, int level)
+{
+	struct lazy *lazy = closure;
+
+	pthread_mutex_lock(&lazy->mutex);
+	lazy->logmask = level;
+	if (lazy->state == Lazy_Active && lazy->item.itf->set_logmask)
+		lazy->item.itf->set_logmask(lazy->item.closure, level);
+	pthread_mutex_unlock(&lazy->mutex);
+}
+
+/* describes the API of the binding when active */
+static void lazy_describe(void *closure, void (*describecb)(void *, struct json_object *), void *clocb)
+{
+	struct lazy *lazy = closure;
+
+	if (is_active(lazy) && lazy->item.itf->describe)
+		lazy->item.itf->describe(lazy->item.closure, describecb, clocb);
+	else
+		describecb(clocb, NULL);
+}
+
+static void lazy_unref(void *closure)
+{
+	struct lazy *lazy = closure;
+
+	if (lazy->set != NULL)
+		afb_apiset_unref(lazy->set);
+	afb_apiset_unref(lazy->call_set);
+	json_object_put(lazy->config);
+	pthread_mutex_destroy(&lazy->mutex);
+	free(lazy->queue);
+	free(lazy->apiname);
+	free(lazy->path);
+	free(lazy);
+}
+
+/* interface of the placeholder */
+static const struct afb_api_itf lazy_itf = {
+	.process = lazy_process,
+	.service_start = lazy_service_start,
+	.get_logmask = lazy_get_logmask,
+	.set_logmask = lazy_set_logmask,
+	.describe = lazy_describe,
+	.unref = lazy_unref
+};
+
+/* see afb-binder-lazy.h */
+int afb_binder_lazy_add(const char *apiname, const char *path,
+			struct afb_apiset *declare_set, struct afb_apiset *call_set,
+			struct json_object *config)
+{
+	struct lazy *lazy;
+	struct afb_api_item item;
+	int rc;
+
+	lazy = calloc(1, sizeof *lazy);
+	if (lazy == NULL)
+		goto oom;
+	lazy->apiname = strdup(apiname);
+	lazy->path = strdup(path);
+	if (lazy->apiname == NULL || lazy->path == NULL)
+		goto oom2;
+	pthread_mutex_init(&lazy->mutex, NULL);
+	lazy->state = Lazy_Idle;
+	lazy->logmask = -1;
+	lazy->call_set = afb_apiset_addref(call_set);
+	lazy->config = json_object_get(config);
+
+	item.closure = lazy;
+	item.itf = &lazy_itf;
+	item.group = NULL;
+	rc = afb_apiset_add(declare_set, apiname, item);
+	if (rc < 0) {
+		LIBAFB_ERROR("can't declare API %s of lazy binding %s", apiname, path);
+		lazy_unref(lazy);
+		return rc;
+	}
+	LIBAFB_INFO("API %s declared for lazy binding %s", apiname, path);
+	return 0;
+
+oom2:
+	free(lazy->apiname);
+	free(lazy->path);
+	free(lazy);
+oom:
+	LIBAFB_ERROR("out of memory");
+	return -ENOMEM;
+}
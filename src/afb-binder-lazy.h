@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#pragma once
+
+struct afb_apiset;
+struct json_object;
+
+/**
+ * Declares the API 'apiname' in 'declare_set' as a placeholder of the
+ * binding of 'path' that is loaded lazily.
+ *
+ * The binding is loaded in a private apiset and started on the first
+ * request received by the placeholder. The requests received during its
+ * activation are queued and then given, in order, to the API of the
+ * binding that must be named 'apiname'. Later requests are directly
+ * given to that API. If the activation fails, the requests are replied
+ * with an error.
+ *
+ * @param apiname     name of the API declared by the binding
+ * @param path        path of the binding
+ * @param declare_set the apiset where the placeholder is declared
+ * @param call_set    the apiset used by the binding for its calls
+ * @param config      the configuration of the binding or NULL
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_lazy_add(const char *apiname, const char *path,
+			struct afb_apiset *declare_set, struct afb_apiset *call_set,
+			struct json_object *config);
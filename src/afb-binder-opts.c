@@ -46,6 +46,7 @@
 #include "afb-binder-defaults.h"
 #include "afb-binder-opts.h"
 #include "afb-binder-config.h"
+#include "afb-binder-cache.h"
 #include "afb-binder-utils.h"
 #include <libafb/extend/afb-extend.h>
 #include <libafb/misc/afb-verbose.h>
@@ -102,6 +103,28 @@
 
 #define SET_WSMAXLEN        29
 
+#if WITH_AFB_HOOK
+#define SET_STATS           30
+#endif
+
+#define SET_CONFIG_CACHE    31
+
+#if WITH_DYNAMIC_BINDING
+#define SET_PRELOAD_BINDINGS 32
+#endif
+
+#define SET_STARTUP_PROFILE 33
+#define SET_CALL_PARALLEL   34
+#define SET_THREADS_CPUS    35
+#define SET_NUMA_POLICY     36
+#define ADD_POOL            37
+#define SET_THREADS_AUTOSCALE 38
+#define SET_JOBS_OVERFLOW   39
+#define SET_SESSION_RATE    40
+#define SET_INTERFACE_RATE  41
+#define SET_FAIR_QUEUE      42
+#define SET_STATIC_FILES    43
+
 #define ADD_AUTO_API       'A'
 #if WITH_DYNAMIC_BINDING
 # define ADD_BINDING       'b'
@@ -165,6 +188,7 @@ static const struct argp_option optdefs[] = {
 	{ .name="alias",       .key=ADD_ALIAS,           .arg="ALIAS", .doc="Multiple url map outside of rootdir [eg: --alias=/icons:/usr/share/icons]" },
 	{ .name="uploaddir",   .key=SET_UPLOAD_DIR,      .arg="DIRECTORY", .doc="Directory for uploading files [default: workdir] relative to workdir" },
 	{ .name="cache-eol",   .key=SET_CACHE_TIMEOUT,   .arg="TIMEOUT", .doc="Client cache end of live [default " d2s(DEFAULT_CACHE_TIMEOUT) "]" },
+	{ .name="static-files", .key=SET_STATIC_FILES,   .arg="VALUE", .doc="Serve static files of aliases from memory: on, off, yes, no, true, false, 1, 0 (default: true)" },
 	{ .name="https",       .key=SET_HTTPS,           .arg=0, .doc="Activates HTTPS" },
 	{ .name="https-cert",  .key=SET_HTTPS_CERT,      .arg="FILE", .doc="File containing the certificate (pem)" },
 	{ .name="https-key",   .key=SET_HTTPS_KEY,       .arg="KEY", .doc="File containing the private key (pem)" },
@@ -183,6 +207,10 @@ static const struct argp_option optdefs[] = {
 	{ .name="ldpaths",     .key=ADD_LDPATH,          .arg="PATHSET", .doc="Load bindings from dir1:dir2:..." },
 	{ .name="weak-ldpaths",.key=ADD_WEAK_LDPATH,     .arg="PATHSET", .doc="Same as --ldpaths but errors are not fatal" },
 #endif
+	{ .name="preload-bindings", .key=SET_PRELOAD_BINDINGS, .arg="THREADS", .flags=OPTION_ARG_OPTIONAL,
+	                                                 .doc="Prefetch the bindings and open them on THREADS threads [default " d2s(DEFAULT_PRELOAD_THREADS) "]" },
+	{ .name="pool",        .key=ADD_POOL,            .arg="SPEC", .doc="Create the worker pool of SPEC where SPEC is NAME[:THREADS[:QUEUEMAX]] "
+	                                                                   "[default " d2s(DEFAULT_POOL_THREADS) " thread, queue of " d2s(DEFAULT_POOL_QUEUE_MAX) "]" },
 #endif
 
 #if WITH_EXTENSION
@@ -203,6 +231,10 @@ static const struct argp_option optdefs[] = {
 	{ .name="auto-api",    .key=ADD_AUTO_API,        .arg="DIRECTORY", .doc="Automatic load of api of the given directory" },
 
 	{ .name="session-max", .key=SET_SESSIONMAX,      .arg="COUNT", .doc="Max count of session simultaneously [default " d2s(DEFAULT_MAX_SESSION_COUNT) "]" },
+	{ .name="session-rate", .key=SET_SESSION_RATE,   .arg="RATE[:BURST]", .doc="Max count of requests per second of a session" },
+	{ .name="interface-rate", .key=SET_INTERFACE_RATE, .arg="RATE[:BURST]", .doc="Max count of requests per second of an interface" },
+	{ .name="fair-queue",  .key=SET_FAIR_QUEUE,      .arg="PENDING", .flags=OPTION_ARG_OPTIONAL,
+	                                                 .doc="Serve sessions in round robin above PENDING jobs [default: half of jobs-max]" },
 
 #if WITH_AFB_HOOK
 	{ .name="tracereq",    .key=SET_TRACEREQ,        .arg="VALUE", .doc="Log the requests: none, common, extra, all" },
@@ -210,15 +242,21 @@ static const struct argp_option optdefs[] = {
 	{ .name="traceses",    .key=SET_TRACESES,        .arg="VALUE", .doc="Log the sessions: none, all" },
 	{ .name="traceapi",    .key=SET_TRACEAPI,        .arg="VALUE", .doc="Log the apis: none, common, api, event, all" },
 	{ .name="traceglob",   .key=SET_TRACEGLOB,       .arg="VALUE", .doc="Log the globals: none, all" },
+	{ .name="stats",       .key=SET_STATS,           .arg="EXPORT", .flags=OPTION_ARG_OPTIONAL,
+	                                                 .doc="Provide the API 'stats' of statistics on verbs, EXPORT is private (default) or public" },
 #endif
 
-	{ .name="call",        .key=ADD_CALL,            .arg="CALLSPEC", .doc="Call at start, format of val: API/VERB:json-args" },
+	{ .name="call",        .key=ADD_CALL,            .arg="CALLSPEC", .doc="Call at start, format of val: [after:API/VERB[,...]:]API/VERB:json-args" },
+	{ .name="call-parallel", .key=SET_CALL_PARALLEL, .arg="MAX", .flags=OPTION_ARG_OPTIONAL,
+	                                                 .doc="Run at most MAX calls at start concurrently [default " d2s(DEFAULT_CALL_PARALLEL) "]" },
 
 	{ .name="exec",        .key=SET_EXEC,            .arg=0, .flags=OPTION_NO_USAGE, .doc="Execute the remaining arguments" },
 
 	{ .name="monitoring",  .key=SET_MONITORING,      .arg=0, .doc="OBSOLETE, don't use it" },
 
 	{ .name="config",      .key=SET_CONFIG,          .arg="FILENAME", .doc="Load options from the given config file" },
+	{ .name="startup-profile", .key=SET_STARTUP_PROFILE, .arg="FILENAME", .doc="Write the timeline of the startup to the given file (Chrome trace events)" },
+	{ .name="config-cache", .key=SET_CONFIG_CACHE,   .arg="FILENAME", .doc="Cache the final config in the given file and reuse it while still valid" },
 	{ .name="dump-config", .key=DUMP_CONFIG,         .arg=0, .doc="Dump the config to stdout and exit" },
 	{ .name="dump-final-config", .key=DUMP_CONFIG_FINAL,   .arg=0, .doc="Dump the config after expansion to stdout and exit" },
 
@@ -229,8 +267,13 @@ static const struct argp_option optdefs[] = {
 	{ .name="fail",        .key=SET_NO_TRAP_FAULTS,  .arg=0,       .doc="Shortcut for --trap-faults=no" },
 
 	{ .name="jobs-max",    .key=SET_JOB_MAX,         .arg="VALUE", .doc="Maximum count of jobs that can be queued  [default " d2s(DEFAULT_JOBS_MAX) "]" },
+	{ .name="jobs-overflow", .key=SET_JOBS_OVERFLOW, .arg="POLICY", .doc="Policy when jobs overflow: reject-newest, drop-oldest-expired or codel[:TARGET[:INTERVAL]]" },
 	{ .name="threads-max", .key=SET_THR_MAX,         .arg="VALUE", .doc="Maximum count of parallel threads held [default " d2s(DEFAULT_THREADS_MAX) "]" },
 	{ .name="threads-init", .key=SET_THR_INIT,       .arg="VALUE", .doc="Initial count of threads [default " d2s(DEFAULT_THREADS_INIT) "]" },
+	{ .name="threads-autoscale", .key=SET_THREADS_AUTOSCALE, .arg="MAX", .flags=OPTION_ARG_OPTIONAL,
+	                                                 .doc="Adapt the count of threads to the wait of jobs, from threads-init to MAX [default: from CPUs]" },
+	{ .name="threads-cpus", .key=SET_THREADS_CPUS,   .arg="LIST", .doc="Run the threads on the CPUs of the LIST (example: 0-3,6)" },
+	{ .name="numa-policy", .key=SET_NUMA_POLICY,     .arg="POLICY", .doc="NUMA memory policy of threads: default, local, bind or interleave" },
 
 	{ .name="uuid",        .key=SET_UUID,            .arg="VALUE", .doc="Set the session UUID of the binder, random by default" },
 
@@ -285,6 +328,23 @@ static void *oomchk(void *ptr)
 	return ptr;
 }
 
+/** when not zero, the options are parsed again for reloading the config */
+static int reloading;
+
+/** set when an error occurred while reloading */
+static int reload_failed;
+
+/**
+ * Handles an invalid setting: exits when starting but only fails
+ * the reload when reloading, so that the running binder continues.
+ */
+static void invalid(void)
+{
+	if (!reloading)
+		exit(1);
+	reload_failed = 1;
+}
+
 static const char *name_of_optid(int optid)
 {
 	const struct argp_option *iter = optdefs;
@@ -480,7 +540,9 @@ static void config_add(struct json_object *config, int optid, struct json_object
 	}
 	else if (!json_object_is_type(a, json_type_array)) {
 		LIBAFB_ERROR("The configuration item %s MUST be an array", name_of_optid(optid));
-		exit(1);
+		json_object_put(val);
+		invalid();
+		return;
 	}
 	json_object_array_add(a, val);
 }
@@ -573,7 +635,8 @@ static int get_arg_bool(int optid, char *svalue)
 	if (value < 0) {
 		LIBAFB_ERROR("option --%s needs a boolean value: yes/no, true/false, on/off, 1/0",
 				name_of_optid(optid));
-		exit(1);
+		invalid();
+		return 0;
 	}
 	return value;
 }
@@ -593,12 +656,14 @@ static void config_set_optint_base(struct json_object *config, int optid, char *
 	if (*end || end == beg) {
 		LIBAFB_ERROR("option --%s requires a valid integer (found %s)",
 			name_of_optid(optid), beg);
-		exit(1);
+		invalid();
+		return;
 	}
 	if (val < (long int)mini || val > (long int)maxi) {
 		LIBAFB_ERROR("option --%s value %ld out of bounds (not in [%d , %d])",
 			name_of_optid(optid), val, mini, maxi);
-		exit(1);
+		invalid();
+		return;
 	}
 	config_set_int(config, optid, (int)val);
 }
@@ -616,7 +681,8 @@ static void config_set_optflags(struct json_object *config, int optid,
 	if (func(value, 0) < 0) {
 		LIBAFB_ERROR("option --%s bad value (found %s)",
 			name_of_optid(optid), value);
-		exit(1);
+		invalid();
+		return;
 	}
 	config_set_str(config, optid, value);
 }
@@ -719,7 +785,8 @@ static void set_log(const char *args)
 			i = strdupa(i);
 			*p = s;
 			LIBAFB_ERROR("Bad log name '%s' in %s", i, args);
-			exit(1);
+			invalid();
+			return;
 		}
 		*p = s;
 		i = p;
@@ -790,6 +857,10 @@ static void fulfill_config(struct json_object *config)
 	char *logging;
 	int i;
 
+	/* the samples of autoscaling are jobs: keep threads for synchronous calls */
+	if (config_has(config, SET_THREADS_AUTOSCALE) && !config_has(config, SET_THR_INIT))
+		config_set_int(config, SET_THR_INIT, DEFAULT_THREADS_MAX);
+
 	for (i = 0 ; i < sizeof default_optint_values / sizeof * default_optint_values ; i++)
 		if (!config_has(config, default_optint_values[i].optid))
 			config_set_int(config, default_optint_values[i].optid, default_optint_values[i].valdef);
@@ -901,6 +972,78 @@ static void parse_environment_initial(struct json_object *config)
 
 #endif
 
+/*---------------------------------------------------------
+ |   Manage the config cache
+ +--------------------------------------------------------- */
+
+/* the cache file if any */
+static const char *config_cache;
+
+/* set when the config was read from the cache */
+static int config_from_cache;
+
+/** the log mask before parsing options */
+static int initial_log_mask = -1;
+
+/**
+ * Search the option --config-cache before parsing the arguments,
+ * because it changes how the arguments are processed.
+ * The cache is not used when help, version or dump is requested.
+ */
+static const char *search_config_cache(int argc, char **argv)
+{
+	static const char opt[] = "--config-cache";
+	const char *result = NULL, *arg;
+	int i;
+
+	for (i = 1 ; i < argc ; i++) {
+		arg = argv[i];
+		if (!strcmp(arg, "--") || !strcmp(arg, "--exec") || !strcmp(arg, "-e"))
+			break;
+		if (!strncmp(arg, opt, sizeof opt - 1)) {
+			if (arg[sizeof opt - 1] == '=')
+				result = &arg[sizeof opt];
+			else if (arg[sizeof opt - 1] == 0 && i + 1 < argc)
+				result = argv[++i];
+		}
+		else if (!strcmp(arg, "--help") || !strcmp(arg, "-?") || !strcmp(arg, "--usage")
+		      || !strcmp(arg, "--version") || !strcmp(arg, "-V")
+		      || !strcmp(arg, "--dump-config") || !strcmp(arg, "-Z")
+		      || !strcmp(arg, "--dump-final-config") || !strcmp(arg, "-z"))
+			return NULL;
+	}
+	return result;
+}
+
+/**
+ * Apply the setting "log" of the cached config, that came from config files
+ */
+static void apply_cached_log(struct json_object *config)
+{
+	struct json_object *obj;
+
+	if (json_object_object_get_ex(config, "log", &obj)
+	 && json_object_is_type(obj, json_type_string))
+		set_log(json_object_get_string(obj));
+}
+
+/**
+ * Apply the settings usually applied when parsing initially, except
+ * the logging ones that are applied by parsecb_cached
+ */
+static void apply_cached_config(struct json_object *config)
+{
+	struct json_object *obj;
+	const char *cval;
+
+	if (json_object_object_get_ex(config, "color", &obj)
+	 && json_object_is_type(obj, json_type_string)) {
+		cval = normal_color_value(json_object_get_string(obj));
+		if (cval)
+			set_color_value(cval);
+	}
+}
+
 /*---------------------------------------------------------
  |   Parse options
  +--------------------------------------------------------- */
@@ -920,7 +1063,8 @@ static error_t parsecb_initial(int key, char *value, struct argp_state *state)
 		cval = normal_color_value(value);
 		if (!cval) {
 			LIBAFB_ERROR("Unknown color value %s", value);
-			exit(1);
+			invalid();
+			break;
 		}
 		config_set_optstr(config, SET_COLOR, cval);
 		set_color_value(cval);
@@ -976,7 +1120,8 @@ static error_t parsecb_initial(int key, char *value, struct argp_state *state)
 	case SET_CONFIG:
 		if (read_config_file(&conf, value) < 0) {
 			LIBAFB_ERROR("Can't read config file %s", value);
-			exit(1);
+			invalid();
+			break;
 		}
 		if (json_object_object_get_ex(conf, "log", &val)) {
 			if (json_object_get_type(val) == json_type_string)
@@ -1001,6 +1146,42 @@ static error_t parsecb_initial(int key, char *value, struct argp_state *state)
 	return 0;
 }
 
+/**
+ * Parser of the initial pass when the config comes from the cache.
+ * The config is already final, but the settings of logging that
+ * are not part of it are still applied in the order of the arguments.
+ */
+static error_t parsecb_cached(int key, char *value, struct argp_state *state)
+{
+	struct json_object *config = state->input;
+
+	switch (key) {
+	case SET_VERBOSE:
+		afb_verbose_inc();
+		break;
+
+	case SET_QUIET:
+		afb_verbose_dec();
+		break;
+
+	case SET_LOG:
+		set_log(value);
+		break;
+
+	case SET_CONFIG:
+		apply_cached_log(config);
+		break;
+
+	case SET_EXEC:
+		state->quoted = 1;
+		break;
+
+	default:
+		break;
+	}
+	return 0;
+}
+
 struct children_data {
 	const struct argp_option *options;
 	struct json_object *config;
@@ -1046,6 +1227,7 @@ static error_t parsecb_final(int key, char *value, struct argp_state *state)
 	case SET_TRAP_FAULTS:
 	case SET_NO_TRAP_FAULTS:
 	case SET_CONFIG:
+	case SET_CONFIG_CACHE:
 	case SET_ROOT_DIR:
 	case SET_WORK_DIR:
 	case SET_MONITORING:
@@ -1080,6 +1262,10 @@ static error_t parsecb_final(int key, char *value, struct argp_state *state)
 	case SET_NO_HTTPD:
 		config_set_bool(config, key, 1);
 		break;
+
+	case SET_STATIC_FILES:
+		config_set_bool(config, key, get_arg_bool(key, value));
+		break;
 #endif
 
 	case SET_API_TIMEOUT:
@@ -1095,18 +1281,38 @@ static error_t parsecb_final(int key, char *value, struct argp_state *state)
 		config_set_optint(config, key, value, 1, INT_MAX);
 		break;
 
+	case SET_THREADS_AUTOSCALE:
+	case SET_FAIR_QUEUE:
+		config_set_optint(config, key, value ?: "0", 0, INT_MAX);
+		break;
+
 	case SET_NAME:
+	case SET_STARTUP_PROFILE:
+	case SET_THREADS_CPUS:
+	case SET_NUMA_POLICY:
+	case SET_JOBS_OVERFLOW:
+	case SET_SESSION_RATE:
+	case SET_INTERFACE_RATE:
 		config_set_optstr(config, key, value);
 		break;
 
+	case SET_CALL_PARALLEL:
+		config_set_optint(config, key, value ?: d2s(DEFAULT_CALL_PARALLEL), 1, 256);
+		break;
+
 #if WITH_DYNAMIC_BINDING
 	case ADD_BINDING:
 		config_add_path_conf_uid(config, key, value, 1);
 		break;
+
+	case SET_PRELOAD_BINDINGS:
+		config_set_optint(config, key, value ?: d2s(DEFAULT_PRELOAD_THREADS), 0, 64);
+		break;
 #if WITH_DIRENT
 	case ADD_LDPATH:
 	case ADD_WEAK_LDPATH:
 #endif
+	case ADD_POOL:
 #endif
 	case ADD_CALL:
 	case ADD_WS_CLIENT:
@@ -1122,6 +1328,17 @@ static error_t parsecb_final(int key, char *value, struct argp_state *state)
 		config_mix2_optstr(config, key, value);
 		break;
 
+#if WITH_AFB_HOOK
+	case SET_STATS:
+		if (value != NULL && strcmp(value, "private") && strcmp(value, "public")) {
+			LIBAFB_ERROR("option --%s needs a value: private or public", name_of_optid(key));
+			invalid();
+			break;
+		}
+		config_set_optstr(config, key, value ?: "private");
+		break;
+#endif
+
 #if WITH_TLS
 	case SET_TLS_CERT:
 	case SET_TLS_KEY:
@@ -1198,11 +1415,25 @@ int afb_binder_opts_parse_initial(int argc, char **argv, struct json_object **co
 	struct argp argp;
 	int flags;
 
+	if (initial_log_mask < 0)
+		initial_log_mask = afb_verbose_get();
+	config_cache = reloading ? NULL : search_config_cache(argc, argv);
+	if (config_cache) {
+		afb_binder_cache_begin(config_cache, version, argc, argv);
+		if (afb_binder_cache_load(config) == 0)
+			config_from_cache = 1;
+	}
+
 #if WITH_ENVIRONMENT
-	parse_environment_initial(*config);
+	if (config_from_cache)
+		on_environment_basic("AFB_LOG", set_log);
+	else
+		parse_environment_initial(*config);
 #endif
+	if (config_from_cache)
+		apply_cached_config(*config);
 	argp.options = optdefs;
-	argp.parser = parsecb_initial;
+	argp.parser = config_from_cache ? parsecb_cached : parsecb_initial;
 	argp.args_doc = "[--exec program args...]";
 	argp.doc = docstring;
 	argp.children = 0;
@@ -1211,7 +1442,7 @@ int afb_binder_opts_parse_initial(int argc, char **argv, struct json_object **co
 	argp_program_version = version;
 	flags = ARGP_IN_ORDER | ARGP_SILENT;
 	argp_parse(&argp, argc, argv, flags, 0, *config);
-	return expand_config(config, 1);
+	return config_from_cache ? 0 : expand_config(config, 1);
 }
 
 int afb_binder_opts_parse_final(int argc, char **argv, struct json_object **config)
@@ -1229,10 +1460,18 @@ int afb_binder_opts_parse_final(int argc, char **argv, struct json_object **conf
 	const char **names;
 	const struct argp_option **options;
 	int iext;
+#endif
+
+	/* the cached config is already final */
+	if (config_from_cache)
+		return 0;
+
+#if WITH_EXTENSION
 	next = afb_extend_get_options(&options, &names);
 	if (next < 0) {
 		LIBAFB_ERROR("Can't get options of extensions");
-		exit(1);
+		invalid();
+		return -1;
 	}
 	if (next == 0) {
 		children = 0;
@@ -1264,7 +1503,8 @@ int afb_binder_opts_parse_final(int argc, char **argv, struct json_object **conf
 		}
 		if (rc < 0) {
 			LIBAFB_ERROR("Unable to process options of extensions");
-			exit(1);
+			invalid();
+			goto end;
 		}
 	}
 
@@ -1290,18 +1530,21 @@ int afb_binder_opts_parse_final(int argc, char **argv, struct json_object **conf
 		dump(*config, stdout, NULL, NULL);
 		exit(0);
 	}
-	if (afb_verbose_wants(afb_Log_Level_Info) && !afb_verbose_wants(afb_Log_Level_Debug))
+	if (!reloading && afb_verbose_wants(afb_Log_Level_Info) && !afb_verbose_wants(afb_Log_Level_Debug))
 		dump(*config, stderr, "--", "CONFIG");
 	rc = expand_config(config, 1);
-	if (afb_verbose_wants(afb_Log_Level_Debug))
+	if (!reloading && afb_verbose_wants(afb_Log_Level_Debug))
 		dump(*config, stderr, "--", "CONFIG");
 	if (data.dodump == 2) {
 		dump(*config, stdout, NULL, NULL);
 		exit(0);
 	}
+	if (rc >= 0 && config_cache)
+		afb_binder_cache_save(*config);
 
 #if WITH_EXTENSION
-	for (iext = 0 ; iext < next ; iext++)
+end:
+	for (iext = 0 ; children != NULL && iext < next ; iext++)
 		free((char**)children[iext].header);
 #endif
 	free(children);
@@ -1309,3 +1552,31 @@ int afb_binder_opts_parse_final(int argc, char **argv, struct json_object **conf
 	free(children_data);
 	return rc;
 }
+
+int afb_binder_opts_parse_reload(int argc, char **argv, struct json_object **config)
+{
+	const char *cache = config_cache;
+	int rc, mask = afb_verbose_get(), from_cache = config_from_cache;
+
+	reloading = 1;
+	reload_failed = 0;
+	config_cache = NULL;
+	config_from_cache = 0;
+	afb_verbose_set(initial_log_mask);
+
+	*config = json_object_new_object();
+	rc = afb_binder_opts_parse_initial(argc, argv, config);
+	if (rc >= 0 && !reload_failed)
+		rc = afb_binder_opts_parse_final(argc, argv, config);
+
+	reloading = 0;
+	config_cache = cache;
+	config_from_cache = from_cache;
+	if (rc < 0 || reload_failed) {
+		json_object_put(*config);
+		*config = NULL;
+		afb_verbose_set(mask);
+		return -1;
+	}
+	return 0;
+}
@@ -27,3 +27,12 @@ struct json_object;
 extern int afb_binder_opts_parse_initial(int argc, char **argv, struct json_object **config);
 extern int afb_binder_opts_parse_final(int argc, char **argv, struct json_object **config);
 
+/**
+ * Parses again the options and the config files into a new 'config'
+ * for reloading it. Errors are reported instead of exiting. On success,
+ * the log mask is the one of the new config; on error, it is unchanged.
+ *
+ * @return 0 on success or a negative value on error
+ */
+extern int afb_binder_opts_parse_reload(int argc, char **argv, struct json_object **config);
+
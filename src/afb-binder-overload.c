@@ -0,0 +1,677 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-apis.h>
+#include <libafb/afb-sys.h>
+#if WITH_LIBMICROHTTPD
+#include <libafb/afb-http.h>
+#endif
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-defaults.h"
+#include "afb-binder-overload.h"
+#include "afb-binder-fair.h"
+
+/** period in ms of the sampling of the wait of jobs and of the backlog */
+#define SAMPLE_PERIOD	10
+
+/** the explicit error text */
+#define OVERLOADED	"overloaded"
+
+/** value of the HTTP header Retry-After in seconds */
+#define RETRY_AFTER	"1"
+
+/** the policies */
+enum policy
+{
+	Policy_None,
+	Policy_Reject_Newest,
+	Policy_Drop_Oldest_Expired,
+	Policy_Codel
+};
+
+static const char *policy_names[] = {
+	[Policy_None] = "none",
+	[Policy_Reject_Newest] = "reject-newest",
+	[Policy_Drop_Oldest_Expired] = "drop-oldest-expired",
+	[Policy_Codel] = "codel"
+};
+
+/** an API accessed through a gate */
+struct gated
+{
+	/** the apiset of the API */
+	struct afb_apiset *set;
+
+	/** name of the interface of the gate */
+	const char *intf;
+
+	/** name of the API */
+	char name[];
+};
+
+/** a request of the backlog */
+struct parked
+{
+	/** next request */
+	struct parked *next;
+
+	/** the API */
+	struct gated *api;
+
+	/** the request */
+	struct afb_req_common *req;
+
+	/** time after which the request is expired */
+	uint64_t deadline;
+};
+
+/** a gate */
+struct gate
+{
+	/** next gate */
+	struct gate *next;
+
+	/** the gate */
+	struct afb_apiset *gate;
+
+	/** the apiset of the APIs */
+	struct afb_apiset *set;
+
+	/** name of the interface */
+	char name[];
+};
+
+/** state of the overload policy */
+static struct
+{
+	/** protection of the state */
+	pthread_mutex_t mutex;
+
+	/** the policy */
+	enum policy policy;
+
+	/** is the sampling job posted */
+	int sampling;
+
+	/** CoDel: requests arrived since the last sample */
+	unsigned arrivals;
+
+	/** expected time of the sample */
+	struct timespec due;
+
+	/** last sampled wait of jobs in ns */
+	uint64_t delay;
+
+	/** CoDel: target and interval in ns */
+	uint64_t target, interval;
+
+	/** CoDel: time at which the wait would be above target for an interval */
+	uint64_t first_above;
+
+	/** CoDel: in the dropping state */
+	int dropping;
+
+	/** CoDel: count of drops of the dropping state */
+	unsigned drop_count;
+
+	/** CoDel: time of the next drop */
+	uint64_t drop_next;
+
+	/** backlog of requests */
+	struct parked *head, **tail;
+
+	/** count of requests in the backlog */
+	unsigned count;
+
+	/** counters */
+	unsigned long admitted, shed, expired, queued, http_shed;
+
+	/** the gates */
+	struct gate *gates;
+}
+	overload = { .mutex = PTHREAD_MUTEX_INITIALIZER, .tail = &overload.head };
+
+/* current monotonic time in ns */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* integer square root */
+static unsigned isqrt(unsigned value)
+{
+	unsigned root = 0, bit = 1u << 30;
+
+	while (bit > value)
+		bit >>= 2;
+	while (bit) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+			root >>= 1;
+		bit >>= 2;
+	}
+	return root;
+}
+
+/* tells whether the queue of jobs is full */
+static int queue_full(void)
+{
+	return afb_jobs_get_pending_count() >= afb_jobs_get_max_count();
+}
+
+/* reply the error overloaded to the request */
+static void reply_overloaded(struct afb_req_common *req)
+{
+	struct afb_data *data;
+
+	if (afb_data_create_raw(&data, &afb_type_predefined_stringz, OVERLOADED, sizeof OVERLOADED, NULL, NULL) < 0)
+		afb_req_common_reply_hookable(req, AFB_ERRNO_NOT_AVAILABLE, 0, NULL);
+	else
+		afb_req_common_reply_hookable(req, AFB_ERRNO_NOT_AVAILABLE, 1, &data);
+}
+
+/** a request forwarded to an API of a group */
+struct forward
+{
+	struct afb_api_item item;
+	struct afb_req_common *req;
+};
+
+/* job processing a forwarded request in the group of the API */
+static void forward_job(int signum, void *arg)
+{
+	struct forward *fwd = arg;
+
+	if (signum)
+		afb_req_common_reply_unavailable_error_hookable(fwd->req);
+	else
+		fwd->item.itf->process(fwd->item.closure, fwd->req);
+	afb_req_common_unref(fwd->req);
+	free(fwd);
+}
+
+/* gives the request to the API, in its group if any */
+static void forward(struct gated *api, struct afb_req_common *req)
+{
+	const struct afb_api_item *item;
+	struct forward *fwd;
+
+	if (afb_apiset_get_api(api->set, api->name, 1, 1, &item) < 0) {
+		afb_req_common_reply_unavailable_error_hookable(req);
+		return;
+	}
+	if (item->group != NULL) {
+		fwd = malloc(sizeof *fwd);
+		if (fwd != NULL) {
+			fwd->item = *item;
+			fwd->req = afb_req_common_addref(req);
+			if (afb_sched_post_job(item->group, 0, 0, forward_job, fwd, Afb_Sched_Mode_Normal) >= 0)
+				return;
+			afb_req_common_unref(req);
+			free(fwd);
+		}
+	}
+	item->itf->process(item->closure, req);
+}
+
+/* remove the oldest request of the backlog, must be locked and not empty */
+static struct parked *unpark(void)
+{
+	struct parked *p = overload.head;
+
+	overload.head = p->next;
+	if (overload.head == NULL)
+		overload.tail = &overload.head;
+	overload.count--;
+	p->next = NULL;
+	return p;
+}
+
+/* post the sampling job, must be locked */
+static void schedule(void);
+
+/* job sampling the wait of jobs and flushing the backlog */
+static void sample_job(int signum, void *arg)
+{
+	struct parked *head = NULL, *expired = NULL, **ptail = &head, **etail = &expired, *p;
+	uint64_t now = now_ns(), due;
+
+	pthread_mutex_lock(&overload.mutex);
+	overload.sampling = 0;
+
+	/* the job is late of the time it waited in the queue */
+	due = (uint64_t)overload.due.tv_sec * 1000000000 + (uint64_t)overload.due.tv_nsec;
+	overload.delay = now > due ? now - due : 0;
+
+	/* CoDel: enter the dropping state after an interval above target */
+	if (overload.delay < overload.target) {
+		overload.first_above = 0;
+		overload.dropping = 0;
+	}
+	else if (overload.first_above == 0)
+		overload.first_above = now + overload.interval;
+	else if (now >= overload.first_above && !overload.dropping) {
+		overload.dropping = 1;
+		overload.drop_count = 0;
+		overload.drop_next = now;
+	}
+
+	/* take the requests of the backlog that can be processed */
+	while (overload.head != NULL && (overload.head->deadline <= now || !queue_full())) {
+		p = unpark();
+		if (p->deadline <= now) {
+			overload.expired++;
+			*etail = p;
+			etail = &p->next;
+		}
+		else {
+			overload.admitted++;
+			*ptail = p;
+			ptail = &p->next;
+		}
+	}
+	/* CoDel samples while requests arrive, must_shed restarts it when idle */
+	if (overload.head != NULL || overload.arrivals != 0)
+		schedule();
+	else {
+		overload.first_above = 0;
+		overload.dropping = 0;
+	}
+	overload.arrivals = 0;
+	pthread_mutex_unlock(&overload.mutex);
+
+	while ((p = expired) != NULL) {
+		expired = p->next;
+		reply_overloaded(p->req);
+		afb_req_common_unref(p->req);
+		free(p);
+	}
+	while ((p = head) != NULL) {
+		head = p->next;
+		forward(p->api, p->req);
+		afb_req_common_unref(p->req);
+		free(p);
+	}
+}
+
+/* post the sampling job, must be locked */
+static void schedule(void)
+{
+	if (overload.sampling)
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &overload.due);
+	overload.due.tv_nsec += SAMPLE_PERIOD * 1000000L;
+	overload.due.tv_sec += overload.due.tv_nsec / 1000000000L;
+	overload.due.tv_nsec %= 1000000000L;
+	/* on failure, the queue is full and the next request retries */
+	overload.sampling = afb_sched_post_job(NULL, SAMPLE_PERIOD, 0, sample_job, NULL, Afb_Sched_Mode_Normal) >= 0;
+}
+
+/* tells whether to shed a new request, must be locked */
+static int must_shed(uint64_t now)
+{
+	switch (overload.policy) {
+	case Policy_Reject_Newest:
+		return queue_full();
+
+	case Policy_Drop_Oldest_Expired:
+		return queue_full() && overload.count >= (unsigned)afb_jobs_get_max_count()
+			&& overload.head->deadline > now;
+
+	case Policy_Codel:
+		overload.arrivals++;
+		schedule();
+		if (!overload.dropping || now < overload.drop_next)
+			return 0;
+		overload.drop_count++;
+		overload.drop_next = now + overload.interval / isqrt(overload.drop_count);
+		return 1;
+
+	default:
+		return 0;
+	}
+}
+
+/* admit a request through the overload policy */
+static void admit(void *closure, struct afb_req_common *req)
+{
+	struct gated *api = closure;
+	struct parked *p, *first = NULL, *dropped = NULL;
+	uint64_t now = now_ns();
+	int timeout, shed = 0;
+
+	pthread_mutex_lock(&overload.mutex);
+	if (must_shed(now)) {
+		overload.shed++;
+		pthread_mutex_unlock(&overload.mutex);
+		reply_overloaded(req);
+		return;
+	}
+	if (overload.policy != Policy_Drop_Oldest_Expired || (overload.head == NULL && !queue_full())) {
+		overload.admitted++;
+		pthread_mutex_unlock(&overload.mutex);
+		forward(api, req);
+		return;
+	}
+
+	/* the backlog drains first: its oldest request is processed if the queue has room or dropped if expired */
+	if (overload.head != NULL && (overload.head->deadline <= now || !queue_full())) {
+		first = unpark();
+		if (first->deadline <= now)
+			overload.expired++;
+		else
+			overload.admitted++;
+	}
+
+	/* when the backlog is full, its oldest request is dropped if expired, otherwise the request is shed */
+	if (overload.count >= (unsigned)afb_jobs_get_max_count()) {
+		if (overload.head->deadline > now)
+			shed = 1;
+		else {
+			dropped = unpark();
+			overload.expired++;
+		}
+	}
+
+	/* keep the request in the backlog */
+	p = shed ? NULL : malloc(sizeof *p);
+	if (p == NULL) {
+		overload.shed++;
+		shed = 1;
+	}
+	else {
+		timeout = afb_apiset_timeout_get(api->set);
+		p->next = NULL;
+		p->api = api;
+		p->req = afb_req_common_addref(req);
+		p->deadline = now + (uint64_t)(timeout > 0 ? timeout : DEFAULT_API_TIMEOUT) * 1000000000;
+		*overload.tail = p;
+		overload.tail = &p->next;
+		overload.count++;
+		overload.queued++;
+	}
+	if (overload.head != NULL)
+		schedule();
+	pthread_mutex_unlock(&overload.mutex);
+
+	if (first != NULL) {
+		if (first->deadline <= now)
+			reply_overloaded(first->req);
+		else
+			forward(first->api, first->req);
+		afb_req_common_unref(first->req);
+		free(first);
+	}
+	if (dropped != NULL) {
+		reply_overloaded(dropped->req);
+		afb_req_common_unref(dropped->req);
+		free(dropped);
+	}
+	if (shed)
+		reply_overloaded(req);
+}
+
+/* process a request through the gate */
+static void gated_process(void *closure, struct afb_req_common *req)
+{
+	struct gated *api = closure;
+
+	if (afb_binder_fair_is_active())
+		afb_binder_fair_submit(api->intf, req, admit, api);
+	else
+		admit(api, req);
+}
+
+static int gated_service_start(void *closure)
+{
+	struct gated *api = closure;
+
+	return afb_apiset_start_service(api->set, api->name);
+}
+
+static int gated_get_logmask(void *closure)
+{
+	struct gated *api = closure;
+	const struct afb_api_item *item;
+
+	if (afb_apiset_get_api(api->set, api->name, 1, 0, &item) >= 0 && item->itf->get_logmask)
+		return item->itf->get_logmask(item->closure);
+	return afb_verbose_get();
+}
+
+static void gated_set_logmask(void *closure, int level)
+{
+	struct gated *api = closure;
+	const struct afb_api_item *item;
+
+	if (afb_apiset_get_api(api->set, api->name, 1, 0, &item) >= 0 && item->itf->set_logmask)
+		item->itf->set_logmask(item->closure, level);
+}
+
+static void gated_describe(void *closure, void (*describecb)(void *, struct json_object *), void *clocb)
+{
+	struct gated *api = closure;
+	const struct afb_api_item *item;
+
+	if (afb_apiset_get_api(api->set, api->name, 1, 0, &item) >= 0 && item->itf->describe)
+		item->itf->describe(item->closure, describecb, clocb);
+	else
+		describecb(clocb, NULL);
+}
+
+static void gated_unref(void *closure)
+{
+	struct gated *api = closure;
+
+	afb_apiset_unref(api->set);
+	free(api);
+}
+
+/* interface of the APIs of gates */
+static const struct afb_api_itf gated_itf = {
+	.process = gated_process,
+	.service_start = gated_service_start,
+	.get_logmask = gated_get_logmask,
+	.set_logmask = gated_set_logmask,
+	.describe = gated_describe,
+	.unref = gated_unref
+};
+
+/* get a count of ms from text, returns 0 on success */
+static int get_ms(const char **text, uint64_t *value)
+{
+	char *end;
+	unsigned long ms;
+
+	if (**text != ':')
+		return 0;
+	ms = strtoul(&(*text)[1], &end, 10);
+	if (end == &(*text)[1] || ms == 0 || (*end && *end != ':'))
+		return -1;
+	*value = (uint64_t)ms * 1000000;
+	*text = end;
+	return 0;
+}
+
+/* see afb-binder-overload.h */
+int afb_binder_overload_setup(const char *policy)
+{
+	const char *args;
+	size_t len;
+	int idx;
+
+	args = strchr(policy, ':');
+	len = args ? (size_t)(args - policy) : strlen(policy);
+	for (idx = Policy_Reject_Newest ; idx <= Policy_Codel ; idx++)
+		if (strlen(policy_names[idx]) == len && !memcmp(policy_names[idx], policy, len))
+			break;
+	overload.target = 5 * 1000000;
+	overload.interval = 100 * 1000000;
+	if (idx > Policy_Codel
+	 || (args != NULL && (idx != Policy_Codel
+			|| get_ms(&args, &overload.target) < 0
+			|| get_ms(&args, &overload.interval) < 0
+			|| *args))) {
+		LIBAFB_ERROR("invalid overload policy %s", policy);
+		return -EINVAL;
+	}
+	overload.policy = idx;
+	LIBAFB_INFO("overload policy %s", policy);
+	return 0;
+}
+
+/* see afb-binder-overload.h */
+int afb_binder_overload_is_active(void)
+{
+	return overload.policy != Policy_None;
+}
+
+/* see afb-binder-overload.h */
+struct afb_apiset *afb_binder_overload_gate(const char *name, struct afb_apiset *set)
+{
+	struct gate *gate;
+	size_t len;
+
+	len = strlen(name) + 1;
+	gate = malloc(sizeof *gate + len);
+	if (gate == NULL)
+		goto oom;
+	memcpy(gate->name, name, len);
+	gate->gate = afb_apiset_create(name, afb_apiset_timeout_get(set));
+	if (gate->gate == NULL) {
+		free(gate);
+		goto oom;
+	}
+	afb_apiset_subset_set(gate->gate, set);
+	gate->set = afb_apiset_addref(set);
+	gate->next = overload.gates;
+	overload.gates = gate;
+	return gate->gate;
+oom:
+	LIBAFB_ERROR("out of memory");
+	return NULL;
+}
+
+/* see afb-binder-overload.h */
+int afb_binder_overload_fill(void)
+{
+	struct gate *gate;
+	struct gated *api;
+	const struct afb_api_item *item;
+	struct afb_api_item gitem;
+	const char **names;
+	size_t len;
+	int idx, rc = 0;
+
+	for (gate = overload.gates ; rc >= 0 && gate != NULL ; gate = gate->next) {
+		names = afb_apiset_get_names(gate->set, 1, 1);
+		if (names == NULL) {
+			LIBAFB_ERROR("out of memory");
+			return -ENOMEM;
+		}
+		for (idx = 0 ; rc >= 0 && names[idx] != NULL ; idx++) {
+			if (afb_apiset_get_api(gate->gate, names[idx], 0, 0, &item) >= 0)
+				continue;
+			len = strlen(names[idx]) + 1;
+			api = malloc(sizeof *api + len);
+			if (api == NULL) {
+				LIBAFB_ERROR("out of memory");
+				rc = -ENOMEM;
+				break;
+			}
+			memcpy(api->name, names[idx], len);
+			api->set = afb_apiset_addref(gate->set);
+			api->intf = gate->name;
+			gitem.closure = api;
+			gitem.itf = &gated_itf;
+			gitem.group = NULL;
+			rc = afb_apiset_add(gate->gate, api->name, gitem);
+			if (rc < 0) {
+				LIBAFB_ERROR("can't add API %s to the overload gate", api->name);
+				gated_unref(api);
+			}
+		}
+		free(names);
+	}
+	return rc;
+}
+
+#if WITH_LIBMICROHTTPD
+/* see afb-binder-overload.h */
+int afb_binder_overload_http(struct afb_hreq *hreq, void *closure)
+{
+	int shed;
+
+	pthread_mutex_lock(&overload.mutex);
+	shed = must_shed(now_ns());
+	if (shed)
+		overload.http_shed++;
+	pthread_mutex_unlock(&overload.mutex);
+	if (!shed)
+		return 0;
+	afb_hreq_reply_static(hreq, 503, sizeof OVERLOADED - 1, OVERLOADED, "Retry-After", RETRY_AFTER, NULL);
+	return 1;
+}
+#endif
+
+/* see afb-binder-overload.h */
+struct json_object *afb_binder_overload_metrics(void)
+{
+	struct json_object *obj;
+
+	if (overload.policy == Policy_None)
+		return NULL;
+	obj = json_object_new_object();
+	pthread_mutex_lock(&overload.mutex);
+	json_object_object_add(obj, "policy", json_object_new_string(policy_names[overload.policy]));
+	json_object_object_add(obj, "admitted", json_object_new_int64((int64_t)overload.admitted));
+	json_object_object_add(obj, "shed", json_object_new_int64((int64_t)overload.shed));
+	json_object_object_add(obj, "http-shed", json_object_new_int64((int64_t)overload.http_shed));
+	json_object_object_add(obj, "queued", json_object_new_int64((int64_t)overload.queued));
+	json_object_object_add(obj, "expired", json_object_new_int64((int64_t)overload.expired));
+	json_object_object_add(obj, "backlog", json_object_new_int((int)overload.count));
+	json_object_object_add(obj, "pending", json_object_new_int(afb_jobs_get_pending_count()));
+	json_object_object_add(obj, "delay", json_object_new_int64((int64_t)(overload.delay / 1000)));
+	json_object_object_add(obj, "dropping", json_object_new_boolean(overload.dropping));
+	pthread_mutex_unlock(&overload.mutex);
+	return obj;
+}
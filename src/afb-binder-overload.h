@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#pragma once
+
+struct afb_apiset;
+struct afb_hreq;
+struct json_object;
+
+/**
+ * Sets the policy applied when the scheduler is overloaded:
+ *
+ *  - reject-newest: the requests arriving when the queue of jobs is
+ *    full are replied with the error "overloaded"
+ *  - drop-oldest-expired: the requests arriving when the queue of jobs
+ *    is full are kept in a backlog as large as the queue and given to
+ *    their API when the queue has room again; when the backlog is full,
+ *    its oldest request is dropped if it waited more than the timeout
+ *    of APIs, otherwise the arriving request is rejected
+ *  - codel[:TARGET[:INTERVAL]]: requests are shed as with CoDel when
+ *    the wait of jobs in the queue stays above TARGET milliseconds
+ *    (default 5) during INTERVAL milliseconds (default 100)
+ *
+ * @param policy the policy
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_overload_setup(const char *policy);
+
+/**
+ * Tells whether an overload policy is set
+ *
+ * @return 1 if a policy is set, 0 otherwise
+ */
+extern int afb_binder_overload_is_active(void);
+
+/**
+ * Creates an apiset giving access to the APIs of 'set' through the
+ * fair admission of afb-binder-fair.h, if set, and the overload policy.
+ * The APIs are added to it by afb_binder_overload_fill.
+ *
+ * @param name name of the interface served by the gate
+ * @param set  the apiset of the APIs
+ *
+ * @return the created apiset or NULL on error
+ */
+extern struct afb_apiset *afb_binder_overload_gate(const char *name, struct afb_apiset *set);
+
+/**
+ * Adds to the apisets created by afb_binder_overload_gate the APIs of
+ * their sets, to be called once the APIs are declared.
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_overload_fill(void);
+
+/**
+ * HTTP handler replying 503 with a header Retry-After when the overload
+ * policy sheds requests.
+ *
+ * @param hreq    the HTTP request
+ * @param closure not used
+ *
+ * @return 1 if the request was replied, 0 otherwise
+ */
+extern int afb_binder_overload_http(struct afb_hreq *hreq, void *closure);
+
+/**
+ * Gets the counts of the requests admitted, shed, expired and queued
+ * by the overload policy.
+ *
+ * @return a new JSON object or NULL if no policy is set
+ */
+extern struct json_object *afb_binder_overload_metrics(void);
@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-apis.h>
+#include <libafb/afb-sys.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-defaults.h"
+#include "afb-binder-pool.h"
+
+/** priority classes, in the order of processing */
+enum prio
+{
+	Prio_High,
+	Prio_Normal,
+	Prio_Low,
+	Prio_Count
+};
+
+static const char *prio_names[Prio_Count] = {
+	[Prio_High] = "high",
+	[Prio_Normal] = "normal",
+	[Prio_Low] = "low"
+};
+
+struct pooled;
+
+/** a queued request */
+struct entry
+{
+	/** next queued request of same priority */
+	struct entry *next;
+
+	/** the API of the request */
+	struct pooled *api;
+
+	/** the request */
+	struct afb_req_common *req;
+};
+
+/** a worker pool */
+struct pool
+{
+	/** next pool */
+	struct pool *next;
+
+	/** protection of the queues and counts */
+	pthread_mutex_t mutex;
+
+	/** signaling of queued requests */
+	pthread_cond_t cond;
+
+	/** heads of the queues, by priority */
+	struct entry *heads[Prio_Count];
+
+	/** tails of the queues, by priority */
+	struct entry **tails[Prio_Count];
+
+	/** count of queued requests, parked ones included */
+	unsigned count;
+
+	/** maximum count of queued requests */
+	unsigned queue_max;
+
+	/** count of threads */
+	unsigned threads;
+
+	/** count of started threads */
+	unsigned started;
+
+	/** set when the queue is full (for logging) */
+	int full;
+
+	/** name of the pool */
+	char name[];
+};
+
+/** an API whose requests are processed by a pool */
+struct pooled
+{
+	/** the pool */
+	struct pool *pool;
+
+	/** priority class */
+	enum prio prio;
+
+	/** when the API is not concurrent, is a request being processed */
+	int busy;
+
+	/** when the API is not concurrent, its requests waiting the end of the busy one */
+	struct entry *parked;
+
+	/** tail of the parked requests */
+	struct entry **parked_tail;
+
+	/** the apiset of the real API */
+	struct afb_apiset *set;
+
+	/** the real API */
+	struct afb_api_item item;
+};
+
+/** the declared pools */
+static struct pool *pools;
+
+/* search the pool of name */
+static struct pool *search(const char *name)
+{
+	struct pool *pool = pools;
+
+	while (pool != NULL && strcmp(pool->name, name))
+		pool = pool->next;
+	return pool;
+}
+
+/* search the priority class of name */
+static int prio_of_name(const char *name)
+{
+	int prio = 0;
+
+	while (prio < Prio_Count && strcmp(prio_names[prio], name))
+		prio++;
+	return prio < Prio_Count ? prio : -1;
+}
+
+/* process the request of the entry under the signal monitor */
+static void process(int signum, void *closure)
+{
+	struct entry *entry = closure;
+	struct pooled *api = entry->api;
+
+	if (signum == 0)
+		api->item.itf->process(api->item.closure, entry->req);
+	else
+		afb_req_common_reply_hookable(entry->req, AFB_ERRNO_INTERNAL_ERROR, 0, NULL);
+}
+
+/*
+ * dequeue the next request to process, must be locked. The requests of
+ * a not concurrent API received while it is busy are parked until the
+ * end of the busy request, so that they never hold a thread.
+ */
+static struct entry *dequeue(struct pool *pool)
+{
+	struct entry *entry;
+	struct pooled *api;
+	int prio;
+
+	for (prio = 0 ; prio < Prio_Count ; prio++) {
+		while ((entry = pool->heads[prio]) != NULL) {
+			pool->heads[prio] = entry->next;
+			if (entry->next == NULL)
+				pool->tails[prio] = &pool->heads[prio];
+			entry->next = NULL;
+			api = entry->api;
+			if (api->item.group == NULL || !api->busy) {
+				api->busy = api->item.group != NULL;
+				pool->count--;
+				pool->full = 0;
+				return entry;
+			}
+			*api->parked_tail = entry;
+			api->parked_tail = &entry->next;
+		}
+	}
+	return NULL;
+}
+
+/* end the busy request of the not concurrent API, must be locked */
+static void release(struct pool *pool, struct pooled *api)
+{
+	struct entry *entry = api->parked;
+
+	api->busy = 0;
+	if (entry != NULL) {
+		/* the oldest parked request comes first in its queue */
+		api->parked = entry->next;
+		if (entry->next == NULL)
+			api->parked_tail = &api->parked;
+		entry->next = pool->heads[api->prio];
+		if (entry->next == NULL)
+			pool->tails[api->prio] = &entry->next;
+		pool->heads[api->prio] = entry;
+	}
+}
+
+/* thread of a pool */
+static void *worker(void *arg)
+{
+	struct pool *pool = arg;
+	struct entry *entry;
+	struct pooled *api;
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;) {
+		entry = dequeue(pool);
+		if (entry == NULL)
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+		else {
+			pthread_mutex_unlock(&pool->mutex);
+			api = entry->api;
+			afb_sig_monitor_run(afb_apiset_timeout_get(api->set), process, entry);
+			afb_req_common_unref(entry->req);
+			free(entry);
+			pthread_mutex_lock(&pool->mutex);
+			if (api->item.group != NULL)
+				release(pool, api);
+		}
+	}
+	return NULL;
+}
+
+/* start the threads of the pool, must be locked */
+static int start_threads(struct pool *pool)
+{
+	pthread_t tid;
+
+	while (pool->started < pool->threads) {
+		if (pthread_create(&tid, NULL, worker, pool) != 0) {
+			LIBAFB_ERROR("can't start thread of pool %s", pool->name);
+			return pool->started ? 0 : -1;
+		}
+		pthread_detach(tid);
+		pool->started++;
+	}
+	return 0;
+}
+
+/* queue a request of the API */
+static void pooled_process(void *closure, struct afb_req_common *req)
+{
+	struct pooled *api = closure;
+	struct pool *pool = api->pool;
+	struct entry *entry;
+
+	entry = malloc(sizeof *entry);
+	if (entry == NULL)
+		goto unavailable;
+	entry->next = NULL;
+	entry->api = api;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->count >= pool->queue_max) {
+		if (!pool->full) {
+			pool->full = 1;
+			LIBAFB_WARNING("queue of pool %s is full", pool->name);
+		}
+	}
+	else if (start_threads(pool) >= 0) {
+		entry->req = afb_req_common_addref(req);
+		*pool->tails[api->prio] = entry;
+		pool->tails[api->prio] = &entry->next;
+		pool->count++;
+		pthread_cond_signal(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+		return;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	free(entry);
+unavailable:
+	afb_req_common_reply_unavailable_error_hookable(req);
+}
+
+static int pooled_service_start(void *closure)
+{
+	struct pooled *api = closure;
+
+	return api->item.itf->service_start ? api->item.itf->service_start(api->item.closure) : 0;
+}
+
+#if WITH_AFB_HOOK
+static void pooled_update_hooks(void *closure)
+{
+	struct pooled *api = closure;
+
+	if (api->item.itf->update_hooks)
+		api->item.itf->update_hooks(api->item.closure);
+}
+#endif
+
+static int pooled_get_logmask(void *closure)
+{
+	struct pooled *api = closure;
+
+	return api->item.itf->get_logmask ? api->item.itf->get_logmask(api->item.closure) : afb_verbose_get();
+}
+
+static void pooled_set_logmask(void *closure, int level)
+{
+	struct pooled *api = closure;
+
+	if (api->item.itf->set_logmask)
+		api->item.itf->set_logmask(api->item.closure, level);
+}
+
+static void pooled_describe(void *closure, void (*describecb)(void *, struct json_object *), void *clocb)
+{
+	struct pooled *api = closure;
+
+	if (api->item.itf->describe)
+		api->item.itf->describe(api->item.closure, describecb, clocb);
+	else
+		describecb(clocb, NULL);
+}
+
+static void pooled_unref(void *closure)
+{
+	struct pooled *api = closure;
+
+	afb_apiset_unref(api->set);
+	free(api);
+}
+
+/* interface of the APIs of pools */
+static const struct afb_api_itf pooled_itf = {
+	.process = pooled_process,
+	.service_start = pooled_service_start,
+#if WITH_AFB_HOOK
+	.update_hooks = pooled_update_hooks,
+#endif
+	.get_logmask = pooled_get_logmask,
+	.set_logmask = pooled_set_logmask,
+	.describe = pooled_describe,
+	.unref = pooled_unref
+};
+
+/* get a positive integer from a string or an object */
+static int get_count(const char *text, struct json_object *obj, unsigned *count)
+{
+	char *end;
+	long value;
+
+	if (obj != NULL) {
+		if (!json_object_is_type(obj, json_type_int))
+			return -1;
+		value = json_object_get_int(obj);
+	}
+	else {
+		value = strtol(text, &end, 10);
+		if (end == text || (*end && *end != ':'))
+			return -1;
+	}
+	if (value < 1 || value > 65536)
+		return -1;
+	*count = (unsigned)value;
+	return 0;
+}
+
+/* see afb-binder-pool.h */
+int afb_binder_pool_create(struct json_object *spec)
+{
+	struct pool *pool;
+	struct json_object *obj;
+	const char *name, *sep;
+	size_t len;
+	unsigned threads = DEFAULT_POOL_THREADS;
+	unsigned queue_max = DEFAULT_POOL_QUEUE_MAX;
+	int prio;
+
+	if (json_object_is_type(spec, json_type_object)) {
+		if (!json_object_object_get_ex(spec, "uid", &obj)
+		 || !json_object_is_type(obj, json_type_string))
+			goto invalid;
+		name = json_object_get_string(obj);
+		len = strlen(name);
+		if ((json_object_object_get_ex(spec, "threads", &obj)
+				&& get_count(NULL, obj, &threads) < 0)
+		 || (json_object_object_get_ex(spec, "queue-max", &obj)
+				&& get_count(NULL, obj, &queue_max) < 0))
+			goto invalid;
+	}
+	else if (json_object_is_type(spec, json_type_string)) {
+		name = json_object_get_string(spec);
+		sep = strchr(name, ':');
+		len = sep ? (size_t)(sep - name) : strlen(name);
+		if (sep != NULL) {
+			if (get_count(&sep[1], NULL, &threads) < 0)
+				goto invalid;
+			sep = strchr(&sep[1], ':');
+			if (sep != NULL && get_count(&sep[1], NULL, &queue_max) < 0)
+				goto invalid;
+		}
+	}
+	else
+		goto invalid;
+	if (len == 0)
+		goto invalid;
+
+	pool = malloc(sizeof *pool + len + 1);
+	if (pool == NULL) {
+		LIBAFB_ERROR("out of memory");
+		return -ENOMEM;
+	}
+	memcpy(pool->name, name, len);
+	pool->name[len] = 0;
+	if (search(pool->name) != NULL) {
+		LIBAFB_ERROR("pool %s already exists", pool->name);
+		free(pool);
+		return -EEXIST;
+	}
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	for (prio = 0 ; prio < Prio_Count ; prio++) {
+		pool->heads[prio] = NULL;
+		pool->tails[prio] = &pool->heads[prio];
+	}
+	pool->count = 0;
+	pool->queue_max = queue_max;
+	pool->threads = threads;
+	pool->started = 0;
+	pool->full = 0;
+	pool->next = pools;
+	pools = pool;
+	LIBAFB_INFO("pool %s created with %u threads and queue of %u", pool->name, threads, queue_max);
+	return 0;
+
+invalid:
+	LIBAFB_ERROR("invalid pool specification %s", json_object_get_string(spec));
+	return -EINVAL;
+}
+
+/* see afb-binder-pool.h */
+int afb_binder_pool_is_priority(const char *priority)
+{
+	return prio_of_name(priority) >= 0;
+}
+
+/* see afb-binder-pool.h */
+int afb_binder_pool_declare(const char *name, const char *priority,
+			struct afb_apiset *from_set, struct afb_apiset *declare_set)
+{
+	struct pool *pool;
+	struct pooled *api;
+	const struct afb_api_item *item;
+	struct afb_api_item pitem;
+	const char **names;
+	int prio, idx, rc;
+
+	pool = search(name);
+	if (pool == NULL) {
+		LIBAFB_ERROR("unknown pool %s", name);
+		return -ENOENT;
+	}
+	prio = priority == NULL ? Prio_Normal : prio_of_name(priority);
+	if (prio < 0) {
+		LIBAFB_ERROR("invalid priority %s", priority);
+		return -EINVAL;
+	}
+	names = afb_apiset_get_names(from_set, 0, 1);
+	if (names == NULL) {
+		LIBAFB_ERROR("out of memory");
+		return -ENOMEM;
+	}
+	for (rc = idx = 0 ; rc >= 0 && names[idx] != NULL ; idx++) {
+		rc = afb_apiset_get_api(from_set, names[idx], 0, 0, &item);
+		if (rc < 0)
+			break;
+		api = malloc(sizeof *api);
+		if (api == NULL) {
+			LIBAFB_ERROR("out of memory");
+			rc = -ENOMEM;
+			break;
+		}
+		api->pool = pool;
+		api->prio = prio;
+		api->busy = 0;
+		api->parked = NULL;
+		api->parked_tail = &api->parked;
+		api->set = afb_apiset_addref(from_set);
+		api->item = *item;
+		pitem.closure = api;
+		pitem.itf = &pooled_itf;
+		pitem.group = NULL;
+		rc = afb_apiset_add(declare_set, names[idx], pitem);
+		if (rc < 0) {
+			LIBAFB_ERROR("can't declare API %s of pool %s", names[idx], pool->name);
+			pooled_unref(api);
+		}
+		else
+			LIBAFB_INFO("API %s runs in pool %s with priority %s", names[idx], pool->name, prio_names[prio]);
+	}
+	free(names);
+	return rc;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#pragma once
+
+struct afb_apiset;
+struct json_object;
+
+/**
+ * Creates the worker pool described by 'spec'. The specification is
+ * either a string NAME[:THREADS[:QUEUEMAX]] or an object with the keys
+ * "uid" (the name, mandatory), "threads" and "queue-max".
+ *
+ * A pool has its own threads, started on its first request, and its own
+ * queue of at most QUEUEMAX requests: requests received when the queue
+ * is full are replied with an error.
+ *
+ * @param spec the specification of the pool
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_pool_create(struct json_object *spec);
+
+/**
+ * Tells whether 'priority' names a priority class: high, normal or low.
+ *
+ * @param priority the name to check
+ *
+ * @return 1 if valid, 0 otherwise
+ */
+extern int afb_binder_pool_is_priority(const char *priority);
+
+/**
+ * Declares in 'declare_set' the APIs of 'from_set' so that their
+ * requests are processed by the threads of the pool 'name'. Within a
+ * pool, queued requests of APIs of priority high are processed before
+ * the ones of priority normal, these before the ones of priority low.
+ * Requests are processed under the signal monitor with the timeout of
+ * 'from_set'. The requests of an API that is not concurrent are processed
+ * one at a time; while one is processed, the next ones are parked
+ * without holding a thread of the pool.
+ *
+ * @param name        name of the pool
+ * @param priority    priority class of the APIs or NULL for normal
+ * @param from_set    the apiset where the APIs are really declared
+ * @param declare_set the apiset where the APIs are made available
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_pool_declare(const char *name, const char *priority,
+			struct afb_apiset *from_set, struct afb_apiset *declare_set);
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-preload.h"
+
+/** a preloaded object */
+struct item
+{
+	const char *path;	/**< path of the object */
+	void *handle;		/**< handle of dlopen */
+};
+
+/** the preloading */
+struct afb_binder_preload
+{
+	unsigned count;		/**< count of items */
+	unsigned next;		/**< next item to open */
+	unsigned nthreads;	/**< count of started threads */
+	pthread_t *tids;	/**< the started threads */
+	struct item items[];	/**< the items */
+};
+
+/** request the reading of the file of 'path' */
+static void prefetch(const char *path)
+{
+	int fd;
+
+	/* without directory, dlopen searches it */
+	if (strchr(path, '/') == NULL)
+		return;
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+}
+
+/** open the items in order until none remains */
+static void *opener(void *closure)
+{
+	struct afb_binder_preload *preload = closure;
+	struct item *item;
+	unsigned idx;
+
+	while ((idx = __atomic_fetch_add(&preload->next, 1, __ATOMIC_RELAXED)) < preload->count) {
+		item = &preload->items[idx];
+		/* same flags than libafb, errors are reported when registering */
+		item->handle = dlopen(item->path, RTLD_NOW | RTLD_LOCAL);
+		if (item->handle == NULL)
+			LIBAFB_DEBUG("preloading of %s failed: %s", item->path, dlerror());
+	}
+	return NULL;
+}
+
+struct afb_binder_preload *afb_binder_preload_start(const char * const *paths, unsigned count, unsigned threads)
+{
+	struct afb_binder_preload *preload;
+	unsigned idx;
+
+	preload = malloc(sizeof *preload + count * sizeof *preload->items);
+	if (preload == NULL)
+		return NULL;
+	if (threads > count)
+		threads = count;
+	preload->tids = threads ? malloc(threads * sizeof *preload->tids) : NULL;
+	if (threads && preload->tids == NULL) {
+		free(preload);
+		return NULL;
+	}
+	preload->count = count;
+	preload->next = 0;
+	for (idx = 0 ; idx < count ; idx++) {
+		preload->items[idx].path = paths[idx];
+		preload->items[idx].handle = NULL;
+		prefetch(paths[idx]);
+	}
+	for (preload->nthreads = 0 ; preload->nthreads < threads ; preload->nthreads++)
+		if (pthread_create(&preload->tids[preload->nthreads], NULL, opener, preload) != 0)
+			break;
+	return preload;
+}
+
+void afb_binder_preload_end(struct afb_binder_preload *preload)
+{
+	unsigned idx;
+
+	if (preload != NULL) {
+		/* stop the threads as soon as possible */
+		__atomic_store_n(&preload->next, preload->count, __ATOMIC_RELAXED);
+		while (preload->nthreads)
+			pthread_join(preload->tids[--preload->nthreads], NULL);
+		for (idx = 0 ; idx < preload->count ; idx++)
+			if (preload->items[idx].handle != NULL)
+				dlclose(preload->items[idx].handle);
+		free(preload->tids);
+		free(preload);
+	}
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+
+#pragma once
+
+struct afb_binder_preload;
+
+/**
+ * Starts preloading the shared objects of 'paths'.
+ *
+ * The reading of the files that are given with a directory is first
+ * requested to the kernel (posix_fadvise) for all of them. Then 'threads'
+ * threads open them (dlopen) in the given order, so that their loading
+ * and relocation is done when the binder registers them.
+ *
+ * The strings of 'paths' must stay valid until 'afb_binder_preload_end'.
+ *
+ * @param paths   the paths of the shared objects
+ * @param count   the count of paths
+ * @param threads the count of threads opening the objects
+ *
+ * @return the preload handle or NULL on error
+ */
+extern struct afb_binder_preload *afb_binder_preload_start(const char * const *paths, unsigned count, unsigned threads);
+
+/**
+ * Waits the end of the preloading and releases the preloaded objects,
+ * the ones registered since then remain loaded.
+ *
+ * @param preload the preload handle, can be NULL
+ */
+extern void afb_binder_preload_end(struct afb_binder_preload *preload);
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-apis.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-profile.h"
+
+/** a span of the timeline */
+struct span
+{
+	const char *cat;	/**< category */
+	char *name;		/**< name */
+	uint64_t begin;		/**< begin time in ns */
+	uint64_t end;		/**< end time in ns, 0 if running or instant */
+	int instant;		/**< is an instant event */
+	int tid;		/**< recording thread */
+};
+
+/** recording state */
+static struct {
+	pthread_mutex_t mutex;	/**< protection */
+	int stopped;		/**< recording is stopped */
+	char *filename;		/**< output file */
+	struct span *spans;	/**< the spans */
+	int count;		/**< count of spans */
+	int alloc;		/**< allocated count */
+} profile = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void release(void)
+{
+	while (profile.count)
+		free(profile.spans[--profile.count].name);
+	free(profile.spans);
+	free(profile.filename);
+	profile.spans = NULL;
+	profile.filename = NULL;
+	profile.alloc = 0;
+	profile.stopped = 1;
+}
+
+/* add a span, must be called locked */
+static int add(const char *cat, const char *name, int instant)
+{
+	struct span *spans;
+	int alloc;
+
+	if (profile.stopped)
+		return -1;
+	if (profile.count == profile.alloc) {
+		alloc = profile.alloc ? 2 * profile.alloc : 256;
+		spans = realloc(profile.spans, (size_t)alloc * sizeof *spans);
+		if (spans == NULL)
+			return -1;
+		profile.spans = spans;
+		profile.alloc = alloc;
+	}
+	spans = &profile.spans[profile.count];
+	spans->name = strdup(name);
+	if (spans->name == NULL)
+		return -1;
+	spans->cat = cat;
+	spans->begin = now_ns();
+	spans->end = 0;
+	spans->instant = instant;
+	spans->tid = (int)syscall(SYS_gettid);
+	return profile.count++;
+}
+
+void afb_binder_profile_enable(const char *filename)
+{
+	pthread_mutex_lock(&profile.mutex);
+	if (filename == NULL)
+		release();
+	else {
+		free(profile.filename);
+		profile.filename = strdup(filename);
+	}
+	pthread_mutex_unlock(&profile.mutex);
+}
+
+int afb_binder_profile_begin(const char *cat, const char *name)
+{
+	int span;
+
+	pthread_mutex_lock(&profile.mutex);
+	span = add(cat, name, 0);
+	pthread_mutex_unlock(&profile.mutex);
+	return span;
+}
+
+void afb_binder_profile_end(int span)
+{
+	uint64_t end = now_ns();
+
+	pthread_mutex_lock(&profile.mutex);
+	if (span >= 0 && span < profile.count)
+		profile.spans[span].end = end;
+	pthread_mutex_unlock(&profile.mutex);
+}
+
+void afb_binder_profile_mark(const char *cat, const char *name)
+{
+	pthread_mutex_lock(&profile.mutex);
+	add(cat, name, 1);
+	pthread_mutex_unlock(&profile.mutex);
+}
+
+/******************************************************************************/
+/* starts of APIs                                                             */
+/******************************************************************************/
+
+#if WITH_AFB_HOOK
+
+static void on_start_before(void *closure, const struct afb_hookid *hookid, const struct afb_api_common *comapi)
+{
+	afb_binder_profile_begin("service", afb_api_common_apiname(comapi));
+}
+
+static void on_start_after(void *closure, const struct afb_hookid *hookid, const struct afb_api_common *comapi, int status)
+{
+	const char *name = afb_api_common_apiname(comapi);
+	int span;
+
+	/* search the running span, starts can be nested */
+	pthread_mutex_lock(&profile.mutex);
+	for (span = profile.count ; span > 0 ; span--)
+		if (profile.spans[span - 1].end == 0
+		 && !profile.spans[span - 1].instant
+		 && !strcmp(profile.spans[span - 1].cat, "service")
+		 && !strcmp(profile.spans[span - 1].name, name))
+			break;
+	pthread_mutex_unlock(&profile.mutex);
+	afb_binder_profile_end(span - 1);
+}
+
+static struct afb_hook_api_itf hook_itf = {
+	.hook_api_start_before = on_start_before,
+	.hook_api_start_after = on_start_after
+};
+
+static struct afb_hook_api *hook;
+
+int afb_binder_profile_hook_services(void)
+{
+	if (profile.stopped || hook != NULL)
+		return 0;
+	hook = afb_hook_create_api(NULL, afb_hook_flag_api_start, &hook_itf, NULL);
+	return hook == NULL ? -ENOMEM : 0;
+}
+
+#else
+
+int afb_binder_profile_hook_services(void)
+{
+	return -ENOTSUP;
+}
+
+#endif
+
+/******************************************************************************/
+/* output                                                                     */
+/******************************************************************************/
+
+static uint64_t duration(const struct span *span)
+{
+	return span->end > span->begin ? span->end - span->begin : 0;
+}
+
+static int cmp_duration(const void *a, const void *b)
+{
+	uint64_t da = duration(*(const struct span * const *)a);
+	uint64_t db = duration(*(const struct span * const *)b);
+	return da < db ? 1 : da > db ? -1 : 0;
+}
+
+static int write_trace(uint64_t origin)
+{
+	struct json_object *root, *events, *event;
+	struct span *span;
+	FILE *file;
+	int idx, rc;
+	pid_t pid = getpid();
+
+	root = json_object_new_object();
+	events = json_object_new_array();
+	json_object_object_add(root, "traceEvents", events);
+	json_object_object_add(root, "displayTimeUnit", json_object_new_string("ms"));
+	for (idx = 0 ; idx < profile.count ; idx++) {
+		span = &profile.spans[idx];
+		event = json_object_new_object();
+		json_object_object_add(event, "name", json_object_new_string(span->name));
+		json_object_object_add(event, "cat", json_object_new_string(span->cat));
+		json_object_object_add(event, "ph", json_object_new_string(span->instant ? "i" : "X"));
+		json_object_object_add(event, "ts", json_object_new_int64((int64_t)((span->begin - origin) / 1000)));
+		if (span->instant)
+			json_object_object_add(event, "s", json_object_new_string("g"));
+		else
+			json_object_object_add(event, "dur", json_object_new_int64((int64_t)(duration(span) / 1000)));
+		json_object_object_add(event, "pid", json_object_new_int(pid));
+		json_object_object_add(event, "tid", json_object_new_int(span->tid));
+		json_object_array_add(events, event);
+	}
+
+	file = fopen(profile.filename, "w");
+	if (file == NULL)
+		rc = -errno;
+	else {
+		rc = fputs(json_object_to_json_string_ext(root, JSON_C_TO_STRING_PLAIN), file) < 0 ? -EIO : 0;
+		if (fclose(file) != 0 && rc == 0)
+			rc = -errno;
+	}
+	json_object_put(root);
+	return rc;
+}
+
+static void log_summary(uint64_t origin)
+{
+	struct span **sorted;
+	int idx, count;
+
+	sorted = malloc((size_t)profile.count * sizeof *sorted);
+	if (sorted == NULL)
+		return;
+	for (idx = count = 0 ; idx < profile.count ; idx++)
+		if (!profile.spans[idx].instant)
+			sorted[count++] = &profile.spans[idx];
+	qsort(sorted, (size_t)count, sizeof *sorted, cmp_duration);
+
+	LIBAFB_NOTICE("startup profile: %.3f ms, %d spans, written to %s",
+			(double)(now_ns() - origin) / 1e6, count, profile.filename);
+	for (idx = 0 ; idx < count ; idx++)
+		LIBAFB_NOTICE("startup profile: %10.3f ms  at %10.3f ms  %-8s %s",
+			(double)duration(sorted[idx]) / 1e6,
+			(double)(sorted[idx]->begin - origin) / 1e6,
+			sorted[idx]->cat, sorted[idx]->name);
+	free(sorted);
+}
+
+void afb_binder_profile_done(void)
+{
+	uint64_t origin;
+	int rc;
+
+	pthread_mutex_lock(&profile.mutex);
+	if (!profile.stopped && profile.filename != NULL && profile.count > 0) {
+		origin = profile.spans[0].begin;
+		rc = write_trace(origin);
+		if (rc < 0)
+			LIBAFB_ERROR("can't write startup profile %s: %s", profile.filename, strerror(-rc));
+		log_summary(origin);
+	}
+	release();
+	pthread_mutex_unlock(&profile.mutex);
+#if WITH_AFB_HOOK
+	if (hook != NULL) {
+		afb_hook_unref_api(hook);
+		hook = NULL;
+	}
+#endif
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+
+#pragma once
+
+/*
+ * Timeline of the startup of the binder.
+ *
+ * Spans are recorded from the start of the process. When enabled, they
+ * are written at the end of the startup as Chrome trace events (see
+ * chrome://tracing or https://ui.perfetto.dev) and a summary sorted by
+ * duration is logged.
+ */
+
+/**
+ * Sets the file receiving the timeline, NULL stops the recording.
+ *
+ * @param filename the path of the file to write or NULL
+ */
+extern void afb_binder_profile_enable(const char *filename);
+
+/**
+ * Starts a span of the timeline
+ *
+ * @param cat  the category of the span (static string)
+ * @param name the name of the span (copied)
+ *
+ * @return the index of the span for afb_binder_profile_end
+ */
+extern int afb_binder_profile_begin(const char *cat, const char *name);
+
+/**
+ * Ends the span of index 'span'
+ *
+ * @param span the index returned by afb_binder_profile_begin
+ */
+extern void afb_binder_profile_end(int span);
+
+/**
+ * Records an instant event of the timeline
+ *
+ * @param cat  the category of the event (static string)
+ * @param name the name of the event (copied)
+ */
+extern void afb_binder_profile_mark(const char *cat, const char *name);
+
+/**
+ * Records the starts of APIs (requires hooks)
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_profile_hook_services(void);
+
+/**
+ * Writes the timeline and its summary if enabled, then stops recording
+ */
+extern void afb_binder_profile_done(void);
@@ -0,0 +1,692 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include "binder-settings.h"
+
+#if WITH_LIBMICROHTTPD
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <microhttpd.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-http.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-defaults.h"
+#include "afb-binder-static.h"
+
+/** size of the hash table of files */
+#define FILES_HASH	256
+
+/** the variants of a file */
+enum variant
+{
+	Variant_Identity,
+	Variant_Brotli,
+	Variant_Gzip,
+	Variant_Count
+};
+
+static const char *variant_suffix[Variant_Count] = { "", ".br", ".gz" };
+static const char *variant_encoding[Variant_Count] = { NULL, "br", "gzip" };
+
+/** a served directory */
+struct root
+{
+	/** the directory */
+	int fd;
+};
+
+/** an immutable variant of a file, shared by the replies sending it */
+struct content
+{
+	/** count of references, the file and each reply sending it */
+	unsigned refcount;
+
+	/** whether the variant can be served */
+	int usable;
+
+	/** size of the file */
+	size_t size;
+
+	/** validators */
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+	char etag[64];
+	char lastmod[32];
+
+	/** the data when usable */
+	char data[];
+};
+
+/** a cached file */
+struct file
+{
+	/** next file of the hash chain */
+	struct file *next;
+
+	/** the directory of the file */
+	struct root *root;
+
+	/** time of the last check of changes in ns, accessed atomically */
+	uint64_t checked;
+
+	/** content type */
+	const char *type;
+
+	/** the variants, NULL when not existing */
+	struct content *variants[Variant_Count];
+
+	/** path of the file in root */
+	char path[];
+};
+
+/** state of the serving of static files */
+static struct
+{
+	/** protection of the table and of cachectl */
+	pthread_rwlock_t lock;
+
+	/** is serving enabled */
+	int enabled;
+
+	/** value of Cache-Control */
+	char cachectl[32];
+
+	/** the files */
+	struct file *files[FILES_HASH];
+
+	/** total of the loaded sizes, accessed atomically */
+	size_t loaded;
+}
+	statics = { .lock = PTHREAD_RWLOCK_INITIALIZER, .enabled = 1 };
+
+/** the served content types */
+static const struct { const char *ext, *type; } types[] = {
+	{ "html", "text/html; charset=utf-8" },
+	{ "htm", "text/html; charset=utf-8" },
+	{ "js", "text/javascript; charset=utf-8" },
+	{ "mjs", "text/javascript; charset=utf-8" },
+	{ "css", "text/css; charset=utf-8" },
+	{ "json", "application/json" },
+	{ "map", "application/json" },
+	{ "txt", "text/plain; charset=utf-8" },
+	{ "xml", "application/xml" },
+	{ "svg", "image/svg+xml" },
+	{ "png", "image/png" },
+	{ "jpg", "image/jpeg" },
+	{ "jpeg", "image/jpeg" },
+	{ "gif", "image/gif" },
+	{ "webp", "image/webp" },
+	{ "ico", "image/x-icon" },
+	{ "woff", "font/woff" },
+	{ "woff2", "font/woff2" },
+	{ "ttf", "font/ttf" },
+	{ "wasm", "application/wasm" },
+};
+
+/* current monotonic time in ns */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* get the content type of the path or NULL if not served */
+static const char *type_of(const char *path)
+{
+	const char *ext = strrchr(path, '.');
+	size_t idx;
+
+	if (ext == NULL || strchr(ext, '/'))
+		return NULL;
+	for (idx = 0 ; idx < sizeof types / sizeof *types ; idx++)
+		if (!strcasecmp(&ext[1], types[idx].ext))
+			return types[idx].type;
+	return NULL;
+}
+
+/* check that the path is a file relative to its root */
+static int valid_path(const char *path, size_t length)
+{
+	const char *iter, *end = &path[length];
+
+	if (length == 0 || length >= PATH_MAX || path[length - 1] == '/' || memchr(path, 0, length))
+		return 0;
+	for (iter = path ; iter < end ; iter++) {
+		if (*iter == '.' && (iter == path || iter[-1] == '/')
+		 && (&iter[1] == end || iter[1] == '/' || (iter[1] == '.' && (&iter[2] == end || iter[2] == '/'))))
+			return 0;
+	}
+	return 1;
+}
+
+/* add a reference to the content */
+static struct content *content_addref(struct content *content)
+{
+	if (content != NULL)
+		__atomic_add_fetch(&content->refcount, 1, __ATOMIC_RELAXED);
+	return content;
+}
+
+/* release a reference to the content, freeing it when the last */
+static void content_unref(struct content *content)
+{
+	if (content != NULL && __atomic_sub_fetch(&content->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+		if (content->usable)
+			__atomic_sub_fetch(&statics.loaded, content->size, __ATOMIC_RELAXED);
+		free(content);
+	}
+}
+
+/* free callback of the responses */
+static void release_content(void *closure)
+{
+	content_unref(closure);
+}
+
+/* release the references to the variants */
+static void variants_unref(struct content **variants)
+{
+	int variant;
+
+	for (variant = 0 ; variant < Variant_Count ; variant++)
+		content_unref(variants[variant]);
+}
+
+/* release the file and its variants */
+static void file_free(struct file *file)
+{
+	if (file != NULL) {
+		variants_unref(file->variants);
+		free(file);
+	}
+}
+
+/* reserve size bytes of the budget of loaded files, returns 1 if reserved */
+static int reserve(size_t size)
+{
+	if (size > DEFAULT_STATIC_FILE_MAX)
+		return 0;
+	if (__atomic_add_fetch(&statics.loaded, size, __ATOMIC_RELAXED) <= DEFAULT_STATIC_CACHE_MAX)
+		return 1;
+	__atomic_sub_fetch(&statics.loaded, size, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/* tells whether the time a is before the time b */
+static int older(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/* tells whether the file changed since it was loaded */
+static int changed(const struct content *content, const struct stat *st)
+{
+	return content->ino != st->st_ino
+		|| content->dev != st->st_dev
+		|| content->size != (size_t)st->st_size
+		|| content->mtime.tv_sec != st->st_mtim.tv_sec
+		|| content->mtime.tv_nsec != st->st_mtim.tv_nsec;
+}
+
+/* read the size bytes of fd in data, returns 0 on success, negative on error */
+static int read_content(int fd, char *data, size_t size)
+{
+	ssize_t rc;
+	size_t done = 0;
+
+	while (done < size) {
+		rc = read(fd, &data[done], size - done);
+		if (rc < 0) {
+			if (errno != EINTR)
+				return -errno;
+		}
+		else if (rc == 0)
+			return -EAGAIN; /* the file shrank while read */
+		else
+			done += (size_t)rc;
+	}
+	return 0;
+}
+
+/* load the variant of the file, returns 1 if loaded, 0 if not existing, negative on error */
+static int load_variant(struct file *file, enum variant variant)
+{
+	const struct content *identity = variant == Variant_Identity ? NULL : file->variants[Variant_Identity];
+	struct content *content;
+	char path[PATH_MAX];
+	struct stat st;
+	struct tm tm;
+	size_t size;
+	int fd, rc, usable;
+
+	rc = snprintf(path, sizeof path, "%s%s", file->path, variant_suffix[variant]);
+	if (rc < 0 || rc >= (int)sizeof path)
+		return 0;
+	fd = openat(file->root->fd, path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	rc = fstat(fd, &st);
+	if (rc < 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return 0;
+	}
+	size = (size_t)st.st_size;
+
+	/* a compressed sibling older or bigger than allowed keeps only its validators */
+	usable = identity == NULL || !older(&st.st_mtim, &identity->mtime);
+	if (usable && !reserve(size)) {
+		if (identity == NULL) {
+			close(fd);
+			return -EFBIG;
+		}
+		usable = 0;
+	}
+	content = malloc(sizeof *content + (usable ? size : 0));
+	rc = content == NULL ? -ENOMEM : usable ? read_content(fd, content->data, size) : 0;
+	close(fd);
+	if (rc < 0) {
+		if (usable)
+			__atomic_sub_fetch(&statics.loaded, size, __ATOMIC_RELAXED);
+		free(content);
+		return rc;
+	}
+	content->refcount = 1;
+	content->usable = usable;
+	content->size = size;
+
+	/* compute the validators */
+	content->dev = st.st_dev;
+	content->ino = st.st_ino;
+	content->mtime = st.st_mtim;
+	snprintf(content->etag, sizeof content->etag, "\"%lx-%zx-%llx%s\"",
+		(unsigned long)st.st_ino, size,
+		(unsigned long long)st.st_mtim.tv_sec * 1000000000ULL + (unsigned long long)st.st_mtim.tv_nsec,
+		variant_suffix[variant]);
+	gmtime_r(&st.st_mtim.tv_sec, &tm);
+	strftime(content->lastmod, sizeof content->lastmod, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	file->variants[variant] = content;
+	return 1;
+}
+
+/* read the file of path in root and its variants, returns NULL if it is not served */
+static struct file *load_file(struct root *root, const char *path, size_t length, const char *type)
+{
+	struct file *file;
+	int variant;
+
+	file = calloc(1, sizeof *file + length + 1);
+	if (file == NULL)
+		return NULL;
+	file->root = root;
+	memcpy(file->path, path, length);
+	file->path[length] = 0;
+	file->type = type;
+	if (load_variant(file, Variant_Identity) <= 0) {
+		free(file);
+		return NULL;
+	}
+	for (variant = Variant_Identity + 1 ; variant < Variant_Count ; variant++)
+		load_variant(file, variant);
+	file->checked = now_ns();
+	return file;
+}
+
+/* tells whether the loaded variants of path in root differ from the disk */
+static int outdated(struct root *root, const char *path, struct content **variants)
+{
+	char vpath[PATH_MAX];
+	struct stat st;
+	int variant, rc;
+
+	for (variant = 0 ; variant < Variant_Count ; variant++) {
+		snprintf(vpath, sizeof vpath, "%s%s", path, variant_suffix[variant]);
+		rc = fstatat(root->fd, vpath, &st, 0);
+		if (rc < 0 || !S_ISREG(st.st_mode)
+				? variants[variant] != NULL
+				: variants[variant] == NULL || changed(variants[variant], &st))
+			return 1;
+	}
+	return 0;
+}
+
+/* claim the check of changes of the file when due, returns 1 if claimed */
+static int claim_check(struct file *file)
+{
+	uint64_t now = now_ns();
+	uint64_t checked = __atomic_load_n(&file->checked, __ATOMIC_RELAXED);
+
+	return now - checked >= (uint64_t)DEFAULT_STATIC_CHECK_PERIOD * 1000000
+		&& __atomic_compare_exchange_n(&file->checked, &checked, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+/* get the hash slot of path in root */
+static struct file **slot_of(struct root *root, const char *path, size_t length)
+{
+	uint32_t hash = (uint32_t)(uintptr_t)root;
+	size_t idx;
+
+	for (idx = 0 ; idx < length ; idx++)
+		hash = (hash ^ (unsigned char)path[idx]) * 16777619;
+	return &statics.files[hash % FILES_HASH];
+}
+
+/* search the pointer to the file of path in root, must be locked */
+static struct file **search(struct root *root, const char *path, size_t length)
+{
+	struct file *file, **pfile = slot_of(root, path, length);
+
+	while ((file = *pfile) != NULL && (file->root != root || strcmp(file->path, path)))
+		pfile = &file->next;
+	return pfile;
+}
+
+/*
+ * get references to the variants of path in root, loading them when not
+ * loaded or changed, returns 0 on success or -1 if the file is not served.
+ * The disk is only read out of the lock.
+ */
+static int get_variants(struct root *root, const char *path, size_t length, const char *type,
+			struct content **variants, char *cachectl)
+{
+	struct file *file, *previous, **pfile;
+	int variant, found, check = 0;
+
+	pthread_rwlock_rdlock(&statics.lock);
+	memcpy(cachectl, statics.cachectl, sizeof statics.cachectl);
+	file = *search(root, path, length);
+	for (variant = 0 ; variant < Variant_Count ; variant++)
+		variants[variant] = file == NULL ? NULL : content_addref(file->variants[variant]);
+	found = file != NULL;
+	if (found)
+		check = claim_check(file);
+	pthread_rwlock_unlock(&statics.lock);
+
+	if (found && (!check || !outdated(root, path, variants)))
+		return 0;
+
+	/* load out of the lock, then replace or remove the cached file */
+	variants_unref(variants);
+	file = load_file(root, path, length, type);
+	if (file == NULL && !found)
+		return -1;
+	pthread_rwlock_wrlock(&statics.lock);
+	pfile = search(root, path, length);
+	previous = *pfile;
+	if (previous != NULL)
+		*pfile = previous->next;
+	if (file != NULL) {
+		file->next = *pfile;
+		*pfile = file;
+		for (variant = 0 ; variant < Variant_Count ; variant++)
+			variants[variant] = content_addref(file->variants[variant]);
+	}
+	pthread_rwlock_unlock(&statics.lock);
+	file_free(previous);
+	return file == NULL ? -1 : 0;
+}
+
+/* tells whether the comma separated list of the header accepts the coding */
+static int accepts(const char *header, const char *coding)
+{
+	size_t len = strlen(coding), n;
+
+	while (header != NULL && *header) {
+		header += strspn(header, " \t,");
+		n = strcspn(header, " \t,;");
+		if (n == len && !strncasecmp(header, coding, len)) {
+			/* a quality of zero among the parameters of the coding refuses it */
+			header += n;
+			for (;;) {
+				header += strspn(header, " \t");
+				if (*header != ';')
+					return 1;
+				header += 1 + strspn(&header[1], " \t");
+				if ((header[0] == 'q' || header[0] == 'Q') && header[1] == '=')
+					return strtod(&header[2], NULL) > 0;
+				header += strcspn(header, ";,");
+			}
+		}
+		header = strchr(header, ',');
+	}
+	return 0;
+}
+
+/* tells whether the list of entity tags of If-None-Match matches etag */
+static int matches(const char *header, const char *etag)
+{
+	size_t len = strlen(etag), n;
+
+	while (header != NULL && *header) {
+		header += strspn(header, " \t,");
+		if (*header == '*')
+			return 1;
+		/* the weak comparison applies: W/ is ignored */
+		if (header[0] == 'W' && header[1] == '/')
+			header += 2;
+		if (*header != '"')
+			return 0;
+		n = strcspn(&header[1], "\"");
+		if (header[n + 1] != '"')
+			return 0;
+		n += 2;
+		if (n == len && !memcmp(header, etag, len))
+			return 1;
+		header += n;
+	}
+	return 0;
+}
+
+/* parse the single range of header, returns 1 if valid, 0 if to be ignored, -1 if not satisfiable */
+static int get_range(const char *header, size_t size, size_t *start, size_t *length)
+{
+	unsigned long long first, last;
+	char *end;
+
+	if (strncmp(header, "bytes=", 6) || strchr(header, ','))
+		return 0;
+	header += 6;
+	if (*header == '-') {
+		/* suffix */
+		last = strtoull(&header[1], &end, 10);
+		if (end == &header[1] || *end)
+			return 0;
+		if (last == 0 || size == 0)
+			return -1;
+		first = last >= size ? 0 : size - last;
+		last = size - 1;
+	}
+	else {
+		first = strtoull(header, &end, 10);
+		if (end == header || *end != '-')
+			return 0;
+		if (end[1] == 0)
+			last = size - 1;
+		else {
+			last = strtoull(&end[1], &end, 10);
+			if (*end || last < first)
+				return 0;
+			if (last >= size)
+				last = size - 1;
+		}
+		if (first >= size)
+			return -1;
+	}
+	*start = (size_t)first;
+	*length = (size_t)(last - first + 1);
+	return 1;
+}
+
+/* handler of static files */
+static int serve(struct afb_hreq *hreq, void *data)
+{
+	struct root *root = data;
+	struct content *variants[Variant_Count], *content;
+	struct MHD_Response *response;
+	const char *header, *range, *ifrange, *type, *encoding;
+	char path[PATH_MAX], cachectl[sizeof statics.cachectl], contrange[64];
+	size_t start, length;
+	unsigned status;
+	int variant, idx, rc;
+
+	/* only GET and HEAD of files of known types */
+	if (strcasecmp(hreq->method, "GET") && strcasecmp(hreq->method, "HEAD"))
+		return 0;
+	if (hreq->lentail == 0 || hreq->tail[0] != '/' || !valid_path(&hreq->tail[1], hreq->lentail - 1))
+		return 0;
+	memcpy(path, &hreq->tail[1], hreq->lentail - 1);
+	path[hreq->lentail - 1] = 0;
+	type = type_of(path);
+	if (type == NULL || get_variants(root, path, hreq->lentail - 1, type, variants, cachectl) < 0)
+		return 0;
+
+	/* a Range applies to the file itself, not to its compressed siblings */
+	range = afb_hreq_get_header(hreq, "Range");
+	variant = Variant_Identity;
+	if (range == NULL) {
+		header = afb_hreq_get_header(hreq, "Accept-Encoding");
+		if (variants[Variant_Brotli] != NULL && variants[Variant_Brotli]->usable && accepts(header, "br"))
+			variant = Variant_Brotli;
+		else if (variants[Variant_Gzip] != NULL && variants[Variant_Gzip]->usable && accepts(header, "gzip"))
+			variant = Variant_Gzip;
+	}
+	content = variants[variant];
+	for (idx = 0 ; idx < Variant_Count ; idx++)
+		if (idx != variant)
+			content_unref(variants[idx]);
+	encoding = variant_encoding[variant];
+
+	/* not modified */
+	if (matches(afb_hreq_get_header(hreq, "If-None-Match"), content->etag)) {
+		afb_hreq_reply_empty(hreq, 304,
+			"ETag", content->etag,
+			"Cache-Control", cachectl,
+			"Vary", "Accept-Encoding",
+			NULL);
+		content_unref(content);
+		return 1;
+	}
+
+	/* range, ignored if If-Range does not match */
+	start = 0;
+	length = content->size;
+	rc = 0;
+	if (range != NULL) {
+		ifrange = afb_hreq_get_header(hreq, "If-Range");
+		if (ifrange == NULL || !strcmp(ifrange, content->etag) || !strcmp(ifrange, content->lastmod))
+			rc = get_range(range, content->size, &start, &length);
+	}
+	if (rc < 0) {
+		snprintf(contrange, sizeof contrange, "bytes */%zu", content->size);
+		afb_hreq_reply_empty(hreq, 416, "Content-Range", contrange, NULL);
+		content_unref(content);
+		return 1;
+	}
+
+	/* the response sends from the content and releases it when done */
+	response = MHD_create_response_from_buffer_with_free_callback_cls(length,
+				&content->data[start], release_content, content);
+	if (response == NULL) {
+		content_unref(content);
+		afb_hreq_reply_error(hreq, 500);
+		return 1;
+	}
+	if (rc > 0) {
+		status = 206;
+		snprintf(contrange, sizeof contrange, "bytes %zu-%zu/%zu",
+			start, start + length - 1, content->size);
+		header = "Content-Range";
+	}
+	else {
+		status = 200;
+		header = "Accept-Ranges";
+		strcpy(contrange, "bytes");
+	}
+	afb_hreq_reply(hreq, status, response,
+		"Content-Type", type,
+		header, contrange,
+		"ETag", content->etag,
+		"Last-Modified", content->lastmod,
+		"Cache-Control", cachectl,
+		"Vary", "Accept-Encoding",
+		encoding ? "Content-Encoding" : NULL, encoding,
+		NULL);
+	return 1;
+}
+
+/* see afb-binder-static.h */
+void afb_binder_static_setup(int enable, int cache_timeout)
+{
+	statics.enabled = enable;
+	afb_binder_static_set_cache_timeout(cache_timeout);
+}
+
+/* see afb-binder-static.h */
+void afb_binder_static_set_cache_timeout(int cache_timeout)
+{
+	pthread_rwlock_wrlock(&statics.lock);
+	snprintf(statics.cachectl, sizeof statics.cachectl, "max-age=%d", cache_timeout);
+	pthread_rwlock_unlock(&statics.lock);
+}
+
+/* see afb-binder-static.h */
+int afb_binder_static_add(struct afb_hsrv *hsrv, const char *prefix, int dirfd, const char *path, int priority)
+{
+	struct root *root;
+	int fd;
+
+	if (!statics.enabled)
+		return 0;
+	fd = openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	root = malloc(sizeof *root);
+	if (root == NULL) {
+		close(fd);
+		return -ENOMEM;
+	}
+	root->fd = fd;
+	if (!afb_hsrv_add_handler(hsrv, prefix, serve, root, priority)) {
+		close(fd);
+		free(root);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#pragma once
+
+struct afb_hsrv;
+
+/**
+ * Sets the serving of static files
+ *
+ * @param enable        0 to disable it, not zero to enable it
+ * @param cache_timeout the max-age of Cache-Control in seconds
+ */
+extern void afb_binder_static_setup(int enable, int cache_timeout);
+
+/**
+ * Changes the max-age of Cache-Control of the next replies
+ *
+ * @param cache_timeout the max-age of Cache-Control in seconds
+ */
+extern void afb_binder_static_set_cache_timeout(int cache_timeout);
+
+/**
+ * Adds to the HTTP server a handler serving from memory the static files
+ * of the directory 'path' for the URLs starting with 'prefix'. The files
+ * are read once and their validators (ETag, Last-Modified) computed
+ * when read. The replies send from that content without copying it and
+ * release it when sent. The handler honors If-None-Match, Range and
+ * selects the siblings .br and .gz of files following Accept-Encoding.
+ *
+ * Requests for files it does not handle (directories, big files, unknown
+ * types) are left to the next handlers, so the handler is expected to
+ * come before an alias of the same directory with a lower priority.
+ *
+ * @param hsrv     the HTTP server
+ * @param prefix   the prefix of the URLs
+ * @param dirfd    the directory of relative paths
+ * @param path     the path of the directory of files
+ * @param priority the priority of the handler
+ *
+ * @return 0 on success or when disabled, a negative error code otherwise
+ */
+extern int afb_binder_static_add(struct afb_hsrv *hsrv, const char *prefix, int dirfd, const char *path, int priority);
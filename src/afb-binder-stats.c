@@ -0,0 +1,662 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#include "binder-settings.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+
+#include <libafb/afb-core.h>
+#include <libafb/afb-apis.h>
+#include <libafb/misc/afb-verbose.h>
+
+#include "afb-binder-stats.h"
+#include "afb-binder-autoscale.h"
+#include "afb-binder-overload.h"
+#include "afb-binder-fair.h"
+
+#if WITH_AFB_HOOK
+
+/** count of latency buckets, bucket i counts latencies of [2^(i-1), 2^i[ ns */
+#define LATENCY_BUCKETS  48
+
+/** size (power of 2) of the table of pending requests */
+#define PENDING_SIZE     4096
+
+/** maximum probing in the table of pending requests */
+#define PENDING_PROBES   8
+
+/** size (power of 2) of the per thread table of verbs */
+#define VERBS_SIZE       1024
+
+/**
+ * increments a counter that is read concurrently, the calling thread
+ * being its only writer: no atomic read-modify-write is needed
+ */
+#define ADD(counter,value) __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+
+/** reads a counter updated by an other thread */
+#define GET(counter)       __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/** counters of one verb */
+struct counters
+{
+	uint64_t count;		/**< count of replies */
+	uint64_t errors;	/**< count of replies with a negative status */
+	uint64_t untimed;	/**< count of replies without known begin */
+	uint64_t bytes;		/**< cumulated size of replied data */
+	uint64_t latsum;	/**< cumulated latencies in ns */
+	uint64_t latmax;	/**< maximal latency in ns */
+	uint64_t buckets[LATENCY_BUCKETS]; /**< histogram of latencies */
+};
+
+/** statistics of one verb recorded by one thread */
+struct entry
+{
+	uint32_t hash;		/**< hash of api and verb */
+	const char *verb;	/**< name of the verb, stored after the api */
+	struct counters counters; /**< the counters */
+	char api[];		/**< name of the api then name of the verb */
+};
+
+/** table of verbs recorded by one thread */
+struct thread_stats
+{
+	struct thread_stats *next;	/**< link of the tables */
+	int busy;			/**< not zero when owned by a thread */
+	struct entry *entries[VERBS_SIZE]; /**< open addressing table */
+};
+
+/** a pending request */
+struct pending
+{
+	const struct afb_req_common *req; /**< the request or NULL if free */
+	struct timespec start;		/**< time of its begin */
+};
+
+/** sum of the counters of one verb */
+struct sum
+{
+	uint32_t hash;		/**< hash of api and verb */
+	const char *api;	/**< name of the api */
+	const char *verb;	/**< name of the verb */
+	struct counters counters; /**< the counters */
+};
+
+/** table of sums */
+struct sums
+{
+	unsigned count;		/**< count of sums */
+	unsigned size;		/**< size (power of 2) of the array */
+	struct sum *array;	/**< open addressing table */
+};
+
+/** the hook of requests */
+static struct afb_hook_req *hook;
+
+/** the tables of threads */
+static struct thread_stats *all_stats;
+
+/** the table of the current thread */
+static __thread struct thread_stats *current_stats;
+
+/** key for releasing the table of the thread when it exits */
+static pthread_key_t stats_key;
+
+/** the pending requests */
+static struct pending pendings[PENDING_SIZE];
+
+/** the values at last reset */
+static struct sums baseline;
+
+/** serialize the verbs of the API */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/******************************************************************************/
+/** recording                                                                 */
+/******************************************************************************/
+
+/** hash of the api and verb names (FNV-1a) */
+static uint32_t hash_names(const char *api, const char *verb)
+{
+	uint32_t h = 2166136261u;
+	while (*api)
+		h = (h ^ (uint8_t)*api++) * 16777619u;
+	h = (h ^ (uint8_t)'/') * 16777619u;
+	while (*verb)
+		h = (h ^ (uint8_t)*verb++) * 16777619u;
+	return h;
+}
+
+/** index in pendings of the request */
+static unsigned pending_index(const struct afb_req_common *req)
+{
+	uintptr_t x = (uintptr_t)req;
+	x ^= x >> 17;
+	x *= (uintptr_t)0x9E3779B97F4A7C15ull;
+	return (unsigned)(x >> 20) & (PENDING_SIZE - 1);
+}
+
+/** removes the pending request and get its begin time if start isn't NULL */
+static int pending_take(const struct afb_req_common *req, struct timespec *start)
+{
+	unsigned i = pending_index(req), n = PENDING_PROBES;
+	struct pending *p;
+
+	do {
+		p = &pendings[i];
+		if (__atomic_load_n(&p->req, __ATOMIC_RELAXED) == req) {
+			if (start != NULL)
+				*start = p->start;
+			__atomic_store_n(&p->req, NULL, __ATOMIC_RELEASE);
+			return 1;
+		}
+		i = (i + 1) & (PENDING_SIZE - 1);
+	} while (--n);
+	return 0;
+}
+
+/** release the table of an exiting thread for a later reuse */
+static void release_thread_stats(void *closure)
+{
+	struct thread_stats *ts = closure;
+	__atomic_store_n(&ts->busy, 0, __ATOMIC_RELEASE);
+}
+
+/** get the table of the current thread */
+static struct thread_stats *get_thread_stats(void)
+{
+	struct thread_stats *ts = current_stats;
+
+	if (ts == NULL) {
+		/* reuse the table of an exited thread */
+		ts = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE);
+		while (ts != NULL && __atomic_exchange_n(&ts->busy, 1, __ATOMIC_ACQUIRE))
+			ts = ts->next;
+		if (ts == NULL) {
+			/* or create a new one */
+			ts = calloc(1, sizeof *ts);
+			if (ts == NULL)
+				return NULL;
+			ts->busy = 1;
+			ts->next = __atomic_load_n(&all_stats, __ATOMIC_RELAXED);
+			while (!__atomic_compare_exchange_n(&all_stats, &ts->next, ts, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		}
+		pthread_setspecific(stats_key, ts);
+		current_stats = ts;
+	}
+	return ts;
+}
+
+/** get the entry of the verb for the current thread, creating it if needed */
+static struct entry *get_entry(const char *api, const char *verb)
+{
+	struct thread_stats *ts;
+	struct entry *e;
+	uint32_t h;
+	unsigned i, n;
+	size_t lapi, lverb;
+
+	ts = get_thread_stats();
+	if (ts == NULL)
+		return NULL;
+
+	h = hash_names(api, verb);
+	i = h & (VERBS_SIZE - 1);
+	n = VERBS_SIZE;
+	while ((e = ts->entries[i]) != NULL) {
+		if (e->hash == h && !strcmp(e->verb, verb) && !strcmp(e->api, api))
+			return e;
+		if (--n == 0)
+			return NULL;
+		i = (i + 1) & (VERBS_SIZE - 1);
+	}
+
+	lapi = strlen(api) + 1;
+	lverb = strlen(verb) + 1;
+	e = calloc(1, sizeof *e + lapi + lverb);
+	if (e == NULL)
+		return NULL;
+	e->hash = h;
+	memcpy(e->api, api, lapi);
+	e->verb = memcpy(&e->api[lapi], verb, lverb);
+	__atomic_store_n(&ts->entries[i], e, __ATOMIC_RELEASE);
+	return e;
+}
+
+/** hook of the begin of requests: record the begin time */
+static void on_begin(void *closure, const struct afb_hookid *hookid, const struct afb_req_common *req)
+{
+	unsigned i = pending_index(req), n = PENDING_PROBES;
+	struct pending *p;
+	const struct afb_req_common *expected;
+
+	do {
+		p = &pendings[i];
+		expected = NULL;
+		if (__atomic_compare_exchange_n(&p->req, &expected, req, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			p->start = hookid->time;
+			return;
+		}
+		i = (i + 1) & (PENDING_SIZE - 1);
+	} while (--n);
+	/* table full, the reply will be untimed */
+}
+
+/** hook of the reply of requests: update the counters of the verb */
+static void on_reply(void *closure, const struct afb_hookid *hookid, const struct afb_req_common *req, int status, unsigned nreplies, struct afb_data * const replies[])
+{
+	struct entry *e;
+	struct timespec start;
+	uint64_t latency, bytes;
+	unsigned i;
+
+	e = get_entry(req->apiname ?: "", req->verbname ?: "");
+	if (e == NULL) {
+		pending_take(req, NULL);
+		return;
+	}
+
+	for (bytes = 0, i = 0 ; i < nreplies ; i++)
+		if (replies[i] != NULL)
+			bytes += afb_data_size(replies[i]);
+
+	ADD(e->counters.count, 1);
+	ADD(e->counters.bytes, bytes);
+	if (status < 0)
+		ADD(e->counters.errors, 1);
+
+	if (!pending_take(req, &start))
+		ADD(e->counters.untimed, 1);
+	else {
+		if (hookid->time.tv_sec < start.tv_sec
+		 || (hookid->time.tv_sec == start.tv_sec && hookid->time.tv_nsec < start.tv_nsec))
+			latency = 0;
+		else
+			latency = (uint64_t)(hookid->time.tv_sec - start.tv_sec) * 1000000000u
+				+ (uint64_t)(hookid->time.tv_nsec - start.tv_nsec);
+		i = latency ? (unsigned)(64 - __builtin_clzll(latency)) : 0;
+		if (i >= LATENCY_BUCKETS)
+			i = LATENCY_BUCKETS - 1;
+		ADD(e->counters.buckets[i], 1);
+		ADD(e->counters.latsum, latency);
+		if (latency > e->counters.latmax)
+			__atomic_store_n(&e->counters.latmax, latency, __ATOMIC_RELAXED);
+	}
+}
+
+/** hook of the end of requests: forget requests never replied */
+static void on_end(void *closure, const struct afb_hookid *hookid, const struct afb_req_common *req)
+{
+	pending_take(req, NULL);
+}
+
+/** interface of the hook */
+static struct afb_hook_req_itf hook_itf = {
+	.hook_req_begin = on_begin,
+	.hook_req_end = on_end,
+	.hook_req_reply = on_reply
+};
+
+/******************************************************************************/
+/** summing                                                                   */
+/******************************************************************************/
+
+/** search the sum of api/verb, adding it if add isn't zero */
+static struct sum *sums_get(struct sums *sums, uint32_t hash, const char *api, const char *verb, int add)
+{
+	struct sum *s, *array;
+	unsigned i, size;
+
+	if (add && 2 * (sums->count + 1) > sums->size) {
+		/* grow */
+		size = sums->size ? 2 * sums->size : 64;
+		array = calloc(size, sizeof *array);
+		if (array == NULL)
+			return NULL;
+		for (i = 0 ; i < sums->size ; i++) {
+			s = &sums->array[i];
+			if (s->api != NULL) {
+				unsigned j = s->hash & (size - 1);
+				while (array[j].api != NULL)
+					j = (j + 1) & (size - 1);
+				array[j] = *s;
+			}
+		}
+		free(sums->array);
+		sums->array = array;
+		sums->size = size;
+	}
+
+	if (sums->size == 0)
+		return NULL;
+	i = hash & (sums->size - 1);
+	for (;;) {
+		s = &sums->array[i];
+		if (s->api == NULL)
+			break;
+		if (s->hash == hash && !strcmp(s->verb, verb) && !strcmp(s->api, api))
+			return s;
+		i = (i + 1) & (sums->size - 1);
+	}
+	if (!add)
+		return NULL;
+	s->hash = hash;
+	s->api = api;
+	s->verb = verb;
+	sums->count++;
+	return s;
+}
+
+/** release the memory of sums */
+static void sums_clear(struct sums *sums)
+{
+	free(sums->array);
+	sums->array = NULL;
+	sums->count = sums->size = 0;
+}
+
+/** sum the counters of all threads, optionnaly only for the given api */
+static int sums_collect(struct sums *sums, const char *api)
+{
+	struct thread_stats *ts;
+	struct entry *e;
+	struct sum *s;
+	unsigned i, b;
+	uint64_t max;
+
+	for (ts = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE) ; ts != NULL ; ts = ts->next) {
+		for (i = 0 ; i < VERBS_SIZE ; i++) {
+			e = __atomic_load_n(&ts->entries[i], __ATOMIC_ACQUIRE);
+			if (e == NULL || (api != NULL && strcmp(api, e->api)))
+				continue;
+			s = sums_get(sums, e->hash, e->api, e->verb, 1);
+			if (s == NULL)
+				return -ENOMEM;
+			s->counters.count += GET(e->counters.count);
+			s->counters.errors += GET(e->counters.errors);
+			s->counters.untimed += GET(e->counters.untimed);
+			s->counters.bytes += GET(e->counters.bytes);
+			s->counters.latsum += GET(e->counters.latsum);
+			max = GET(e->counters.latmax);
+			if (max > s->counters.latmax)
+				s->counters.latmax = max;
+			for (b = 0 ; b < LATENCY_BUCKETS ; b++)
+				s->counters.buckets[b] += GET(e->counters.buckets[b]);
+		}
+	}
+	return 0;
+}
+
+/** subtract the baseline from the counters */
+static void sums_subtract(struct sums *sums, struct sums *base)
+{
+	struct sum *s, *r;
+	unsigned i, b;
+
+	for (i = 0 ; i < sums->size ; i++) {
+		s = &sums->array[i];
+		if (s->api == NULL)
+			continue;
+		r = sums_get(base, s->hash, s->api, s->verb, 0);
+		if (r == NULL)
+			continue;
+		s->counters.count -= r->counters.count;
+		s->counters.errors -= r->counters.errors;
+		s->counters.untimed -= r->counters.untimed;
+		s->counters.bytes -= r->counters.bytes;
+		s->counters.latsum -= r->counters.latsum;
+		for (b = 0 ; b < LATENCY_BUCKETS ; b++)
+			s->counters.buckets[b] -= r->counters.buckets[b];
+		/* the maximum can't be reset: when not exceeded since the reset,
+		 * it is bounded by the highest not empty bucket */
+		if (s->counters.latmax <= r->counters.latmax) {
+			for (b = LATENCY_BUCKETS ; b && !s->counters.buckets[b - 1] ; b--);
+			if (b <= 1)
+				s->counters.latmax = 0;
+			else if ((UINT64_C(1) << (b - 1)) < s->counters.latmax)
+				s->counters.latmax = UINT64_C(1) << (b - 1);
+		}
+	}
+}
+
+/******************************************************************************/
+/** API                                                                       */
+/******************************************************************************/
+
+/** converts nanoseconds to microseconds */
+static json_object *usec(uint64_t ns)
+{
+	return json_object_new_double((double)ns / 1000.0);
+}
+
+/** upper bound of the latency at percent */
+static uint64_t percentile(const struct counters *c, unsigned percent)
+{
+	uint64_t total, cumul, target;
+	unsigned b;
+
+	total = c->count - c->untimed;
+	if (total == 0)
+		return 0;
+	target = (total * percent + 99) / 100;
+	for (cumul = 0, b = 0 ; b < LATENCY_BUCKETS ; b++) {
+		cumul += c->buckets[b];
+		if (cumul >= target)
+			break;
+	}
+	if (b == 0)
+		return 0;
+	if ((UINT64_C(1) << b) > c->latmax)
+		return c->latmax;
+	return UINT64_C(1) << b;
+}
+
+/** make the JSON description of one verb */
+static json_object *make_verb(const struct sum *s)
+{
+	const struct counters *c = &s->counters;
+	json_object *obj, *lat, *histo;
+	uint64_t timed;
+	unsigned b, n;
+
+	timed = c->count - c->untimed;
+	obj = json_object_new_object();
+	json_object_object_add(obj, "api", json_object_new_string(s->api));
+	json_object_object_add(obj, "verb", json_object_new_string(s->verb));
+	json_object_object_add(obj, "count", json_object_new_int64((int64_t)c->count));
+	json_object_object_add(obj, "errors", json_object_new_int64((int64_t)c->errors));
+	json_object_object_add(obj, "bytes", json_object_new_int64((int64_t)c->bytes));
+	if (c->untimed)
+		json_object_object_add(obj, "untimed", json_object_new_int64((int64_t)c->untimed));
+
+	lat = json_object_new_object();
+	json_object_object_add(lat, "mean", usec(timed ? c->latsum / timed : 0));
+	json_object_object_add(lat, "p50", usec(percentile(c, 50)));
+	json_object_object_add(lat, "p90", usec(percentile(c, 90)));
+	json_object_object_add(lat, "p99", usec(percentile(c, 99)));
+	json_object_object_add(lat, "max", usec(c->latmax));
+	json_object_object_add(obj, "latency", lat);
+
+	/* histogram is trimmed after its last not null bucket */
+	for (n = LATENCY_BUCKETS ; n && !c->buckets[n - 1] ; n--);
+	histo = json_object_new_array();
+	for (b = 0 ; b < n ; b++)
+		json_object_array_add(histo, json_object_new_int64((int64_t)c->buckets[b]));
+	json_object_object_add(obj, "histogram", histo);
+	return obj;
+}
+
+/** release the replied JSON object */
+static void put_json(void *closure)
+{
+	json_object_put(closure);
+}
+
+/** reply the JSON object to the request */
+static void reply_json(struct afb_req_v4 *req, int status, json_object *obj)
+{
+	struct afb_data *data;
+	int rc;
+
+	rc = afb_data_create_raw(&data, &afb_type_predefined_json_c, obj, 0, put_json, obj);
+	if (rc < 0)
+		afb_req_v4_reply_hookable(req, AFB_ERRNO_OUT_OF_MEMORY, 0, NULL);
+	else
+		afb_req_v4_reply_hookable(req, status, 1, &data);
+}
+
+/** verb get: reply the statistics {"api":name} restricts to one api */
+static void verb_get(struct afb_req_v4 *req, unsigned nparams, struct afb_data * const params[])
+{
+	struct sums sums = { 0, 0, NULL };
+	struct afb_data *arg = NULL;
+	json_object *argJ, *apiJ, *resJ, *verbsJ, *autoscaleJ, *overloadJ, *fairJ;
+	const char *api = NULL;
+	unsigned i;
+	int rc;
+
+	if (nparams > 0 && afb_data_convert(params[0], &afb_type_predefined_json_c, &arg) >= 0) {
+		argJ = (json_object*)afb_data_ro_pointer(arg);
+		if (json_object_object_get_ex(argJ, "api", &apiJ))
+			api = json_object_get_string(apiJ);
+	}
+
+	pthread_mutex_lock(&mutex);
+	rc = sums_collect(&sums, api);
+	if (rc >= 0)
+		sums_subtract(&sums, &baseline);
+	pthread_mutex_unlock(&mutex);
+
+	if (rc < 0)
+		afb_req_v4_reply_hookable(req, AFB_ERRNO_OUT_OF_MEMORY, 0, NULL);
+	else {
+		verbsJ = json_object_new_array();
+		for (i = 0 ; i < sums.size ; i++)
+			if (sums.array[i].api != NULL)
+				json_object_array_add(verbsJ, make_verb(&sums.array[i]));
+		resJ = json_object_new_object();
+		json_object_object_add(resJ, "unit", json_object_new_string("us"));
+		json_object_object_add(resJ, "verbs", verbsJ);
+		autoscaleJ = afb_binder_autoscale_metrics();
+		if (autoscaleJ != NULL)
+			json_object_object_add(resJ, "autoscale", autoscaleJ);
+		overloadJ = afb_binder_overload_metrics();
+		if (overloadJ != NULL)
+			json_object_object_add(resJ, "overload", overloadJ);
+		fairJ = afb_binder_fair_metrics();
+		if (fairJ != NULL)
+			json_object_object_add(resJ, "fairness", fairJ);
+		reply_json(req, 0, resJ);
+	}
+	sums_clear(&sums);
+	if (arg != NULL)
+		afb_data_unref(arg);
+}
+
+/** verb reset: record the current values as baseline */
+static void verb_reset(struct afb_req_v4 *req, unsigned nparams, struct afb_data * const params[])
+{
+	struct sums sums = { 0, 0, NULL };
+	int rc;
+
+	pthread_mutex_lock(&mutex);
+	rc = sums_collect(&sums, NULL);
+	if (rc >= 0) {
+		sums_clear(&baseline);
+		baseline = sums;
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if (rc < 0) {
+		sums_clear(&sums);
+		afb_req_v4_reply_hookable(req, AFB_ERRNO_OUT_OF_MEMORY, 0, NULL);
+	}
+	else
+		afb_req_v4_reply_hookable(req, 0, 0, NULL);
+}
+
+/** add the verbs to the api */
+static int preinit(struct afb_api_v4 *api, void *closure)
+{
+	int rc;
+
+	rc = afb_api_v4_add_verb_hookable(api, "get", "get statistics of verbs", verb_get, NULL, NULL, 0, 0);
+	if (rc >= 0)
+		rc = afb_api_v4_add_verb_hookable(api, "reset", "reset statistics of verbs", verb_reset, NULL, NULL, 0, 0);
+	if (rc >= 0)
+		afb_api_v4_seal_hookable(api);
+	return rc;
+}
+
+int afb_binder_stats_init(const char *apiname, struct afb_apiset *declare_set, struct afb_apiset *call_set)
+{
+	struct afb_api_v4 *api;
+	int rc;
+
+	if (hook != NULL) {
+		LIBAFB_ERROR("statistics already activated");
+		return -EEXIST;
+	}
+
+	rc = pthread_key_create(&stats_key, release_thread_stats);
+	if (rc != 0) {
+		LIBAFB_ERROR("can't create key of statistics");
+		return -rc;
+	}
+
+	rc = afb_api_v4_create(&api, declare_set, call_set,
+				apiname, Afb_String_Copy,
+				"statistics of verbs", Afb_String_Const,
+				0, preinit, NULL,
+				NULL, Afb_String_Const);
+	if (rc < 0) {
+		LIBAFB_ERROR("can't create API %s", apiname);
+		return rc;
+	}
+
+	hook = afb_hook_create_req(NULL, NULL, NULL,
+			afb_hook_flag_req_begin | afb_hook_flag_req_end | afb_hook_flag_req_reply,
+			&hook_itf, NULL);
+	if (hook == NULL) {
+		LIBAFB_ERROR("can't hook requests for statistics");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+#else
+
+int afb_binder_stats_init(const char *apiname, struct afb_apiset *declare_set, struct afb_apiset *call_set)
+{
+	LIBAFB_ERROR("statistics require hooks that aren't available");
+	return -ENOTSUP;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+#pragma once
+
+struct afb_apiset;
+
+/**
+ * Activates the collection of per verb statistics of requests and
+ * declares the API that exposes them.
+ *
+ * The API has 2 verbs:
+ *  - get: returns the counters, latencies and histograms of verbs,
+ *         optionnaly filtered by the name of an api ({"api":"name"}),
+ *         and the metrics of the autoscaling of threads, of the
+ *         overload policy and of the fair admission when active
+ *  - reset: resets the counters (values are kept as a baseline)
+ *
+ * @param apiname   name of the declared API
+ * @param declare_set the apiset where the API is declared
+ * @param call_set  the apiset used by the API for its calls
+ *
+ * @return 0 on success or a negative error code
+ */
+extern int afb_binder_stats_init(const char *apiname, struct afb_apiset *declare_set, struct afb_apiset *call_set);
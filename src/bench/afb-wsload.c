@@ -0,0 +1,978 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+/*
+ * Load generator for binders speaking the websocket protocol x-afb-ws-json1
+ * (see docs/protocol-x-afb-ws-json1.md).
+ *
+ * It reads a script of commands of the form "API VERB [ARGS]", one per
+ * line, as afb-client does, and plays it on N connections, looping.
+ * Each connection can have several pending calls (pipelining).
+ *
+ * In closed-loop mode (the default), a connection sends a new call as soon
+ * as one of its pending calls is replied. In open-loop mode (--rate), calls
+ * are sent at the given global rate on a fixed schedule and latencies are
+ * measured from the scheduled send time, not from the actual send time.
+ * This way, calls delayed because the connection was full are accounted
+ * with their waiting time (no coordinated omission).
+ *
+ * Latencies are recorded in histograms per API/VERB.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <json-c/json.h>
+
+#include "bench-histo.h"
+
+#define PROTOCOL      "x-afb-ws-json1"
+#define MAX_EVENTS    64
+#define DRAIN_NS      (2 * 1000000000ull)
+
+/* websocket opcodes */
+#define OP_CONTINUATION 0
+#define OP_TEXT         1
+#define OP_BINARY       2
+#define OP_CLOSE        8
+#define OP_PING         9
+#define OP_PONG         10
+
+/* a growable buffer */
+struct buffer
+{
+	char *data;
+	size_t begin;
+	size_t end;
+	size_t size;
+};
+
+/* a procedure called: API/VERB */
+struct proc
+{
+	char *name;
+	bench_histo_t *histo;
+	uint64_t errors;
+};
+
+/* a line of the script */
+struct command
+{
+	/** index of the called procedure */
+	unsigned proc;
+
+	/** text following the id: ","api/verb",ARGS] */
+	char *tail;
+	size_t taillen;
+};
+
+/* a pending call */
+struct pending
+{
+	/** time origin of the measure */
+	uint64_t start;
+
+	/** index of the procedure */
+	unsigned proc;
+};
+
+/* a connection */
+struct conn
+{
+	int fd;
+	unsigned index;
+	unsigned next_command;
+	unsigned npending;
+	unsigned *freeslots;
+	unsigned nfree;
+	struct pending *pendings;
+	uint64_t next_due;
+	uint64_t events;
+	int wants_out;
+	int closed;
+	struct buffer in;
+	struct buffer out;
+	struct buffer msg;
+};
+
+/* settings */
+static const char *url = "localhost:12345/api";
+static const char *script = NULL;
+static unsigned nconns = 1;
+static unsigned depth = 1;
+static double rate = 0;
+static double duration = 10;
+static uint64_t maxcount = 0;
+static double warmup = 0;
+static int percentiles = 0;
+
+/* state */
+static struct proc *procs;
+static unsigned nprocs;
+static struct command *commands;
+static unsigned ncommands;
+static struct conn *conns;
+static int epfd;
+static int timerfd;
+static uint64_t interval;
+static uint64_t start_time;
+static uint64_t warmup_time;
+static uint64_t stop_time;
+static uint64_t sent;
+static uint64_t received;
+static uint64_t late;
+static uint32_t rndstate = 0x2545f491;
+static json_tokener *tokener;
+
+/* get current time in nanoseconds */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* pseudo random generator for masks (xorshift) */
+static uint32_t rnd(void)
+{
+	rndstate ^= rndstate << 13;
+	rndstate ^= rndstate >> 17;
+	rndstate ^= rndstate << 5;
+	return rndstate;
+}
+
+static void oom(void)
+{
+	fprintf(stderr, "out of memory\n");
+	exit(EXIT_FAILURE);
+}
+
+/******************************************************************************/
+/* buffers                                                                    */
+/******************************************************************************/
+
+/* ensure that size bytes can be added at end of the buffer */
+static char *buffer_reserve(struct buffer *buf, size_t size)
+{
+	size_t nsz;
+	char *data;
+
+	if (buf->begin == buf->end)
+		buf->begin = buf->end = 0;
+	if (buf->end + size > buf->size) {
+		if (buf->begin > 0) {
+			memmove(buf->data, &buf->data[buf->begin], buf->end - buf->begin);
+			buf->end -= buf->begin;
+			buf->begin = 0;
+		}
+		if (buf->end + size > buf->size) {
+			nsz = buf->size ? buf->size : 4096;
+			while (buf->end + size > nsz)
+				nsz <<= 1;
+			data = realloc(buf->data, nsz);
+			if (data == NULL)
+				oom();
+			buf->data = data;
+			buf->size = nsz;
+		}
+	}
+	return &buf->data[buf->end];
+}
+
+static void buffer_add(struct buffer *buf, const void *data, size_t size)
+{
+	memcpy(buffer_reserve(buf, size), data, size);
+	buf->end += size;
+}
+
+/******************************************************************************/
+/* script                                                                     */
+/******************************************************************************/
+
+static unsigned get_proc(const char *api, const char *verb)
+{
+	unsigned idx;
+	char *name;
+	struct proc *p;
+
+	if (asprintf(&name, "%s/%s", api, verb) < 0)
+		oom();
+	for (idx = 0 ; idx < nprocs ; idx++)
+		if (!strcmp(procs[idx].name, name)) {
+			free(name);
+			return idx;
+		}
+	p = realloc(procs, (nprocs + 1) * sizeof *procs);
+	if (p == NULL)
+		oom();
+	procs = p;
+	p = &procs[nprocs];
+	p->name = name;
+	p->errors = 0;
+	p->histo = bench_histo_create();
+	if (p->histo == NULL)
+		oom();
+	return nprocs++;
+}
+
+/* add the command of the line (modified) */
+static void add_command(char *line, unsigned lino)
+{
+	char *api, *verb, *args, *end;
+	json_object *obj;
+	struct command *cmd;
+	int len;
+
+	/* split API VERB ARGS */
+	api = line + strspn(line, " \t");
+	if (*api == 0 || *api == '#')
+		return;
+	verb = api + strcspn(api, " \t");
+	if (*verb)
+		*verb++ = 0;
+	verb += strspn(verb, " \t");
+	args = verb + strcspn(verb, " \t");
+	if (*args)
+		*args++ = 0;
+	args += strspn(args, " \t");
+	for (end = args + strlen(args) ; end != args && (end[-1] == ' ' || end[-1] == '\t') ; *--end = 0);
+	if (*verb == 0) {
+		fprintf(stderr, "line %u: missing verb\n", lino);
+		exit(EXIT_FAILURE);
+	}
+
+	/* check arguments */
+	if (*args == 0)
+		args = "null";
+	else {
+		obj = json_tokener_parse(args);
+		if (obj == NULL && strcmp(args, "null")) {
+			fprintf(stderr, "line %u: invalid JSON %s\n", lino, args);
+			exit(EXIT_FAILURE);
+		}
+		json_object_put(obj);
+	}
+
+	/* record */
+	cmd = realloc(commands, (ncommands + 1) * sizeof *commands);
+	if (cmd == NULL)
+		oom();
+	commands = cmd;
+	cmd = &commands[ncommands++];
+	cmd->proc = get_proc(api, verb);
+	len = asprintf(&cmd->tail, "\",\"%s/%s\",%s]", api, verb, args);
+	if (len < 0)
+		oom();
+	cmd->taillen = (size_t)len;
+}
+
+static void read_script(const char *path)
+{
+	FILE *file;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	unsigned lino = 0;
+
+	file = path == NULL || !strcmp(path, "-") ? stdin : fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "can't open %s: %s\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((len = getline(&line, &size, file)) >= 0) {
+		lino++;
+		while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = 0;
+		add_command(line, lino);
+	}
+	free(line);
+	if (file != stdin)
+		fclose(file);
+	if (ncommands == 0) {
+		fprintf(stderr, "no command to play\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/******************************************************************************/
+/* websocket                                                                  */
+/******************************************************************************/
+
+static void base64(const unsigned char *in, size_t len, char *out)
+{
+	static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t i;
+	unsigned v;
+
+	for (i = 0 ; i + 2 < len ; i += 3) {
+		v = (unsigned)in[i] << 16 | (unsigned)in[i + 1] << 8 | in[i + 2];
+		*out++ = tbl[(v >> 18) & 63];
+		*out++ = tbl[(v >> 12) & 63];
+		*out++ = tbl[(v >> 6) & 63];
+		*out++ = tbl[v & 63];
+	}
+	if (i < len) {
+		v = (unsigned)in[i] << 16 | (i + 1 < len ? (unsigned)in[i + 1] << 8 : 0);
+		*out++ = tbl[(v >> 18) & 63];
+		*out++ = tbl[(v >> 12) & 63];
+		*out++ = i + 1 < len ? tbl[(v >> 6) & 63] : '=';
+		*out++ = '=';
+	}
+	*out = 0;
+}
+
+/* queue a frame of opcode with the given data */
+static void ws_queue_frame(struct conn *conn, int opcode, const char *head, size_t headlen, const char *data, size_t datalen)
+{
+	unsigned char hdr[14];
+	size_t hlen, len, i;
+	uint32_t mask;
+	unsigned char *m, *p;
+
+	len = headlen + datalen;
+	hdr[0] = (unsigned char)(0x80 | opcode);
+	if (len < 126) {
+		hdr[1] = (unsigned char)(0x80 | len);
+		hlen = 2;
+	}
+	else if (len < 65536) {
+		hdr[1] = 0x80 | 126;
+		hdr[2] = (unsigned char)(len >> 8);
+		hdr[3] = (unsigned char)len;
+		hlen = 4;
+	}
+	else {
+		hdr[1] = 0x80 | 127;
+		for (i = 0 ; i < 8 ; i++)
+			hdr[2 + i] = (unsigned char)(len >> (56 - 8 * i));
+		hlen = 10;
+	}
+	mask = rnd();
+	m = &hdr[hlen];
+	memcpy(m, &mask, 4);
+	hlen += 4;
+
+	buffer_add(&conn->out, hdr, hlen);
+	p = (unsigned char*)buffer_reserve(&conn->out, len);
+	memcpy(p, head, headlen);
+	memcpy(p + headlen, data, datalen);
+	for (i = 0 ; i < len ; i++)
+		p[i] ^= m[i & 3];
+	conn->out.end += len;
+}
+
+static void conn_close(struct conn *conn, const char *reason)
+{
+	if (!conn->closed) {
+		fprintf(stderr, "connection %u closed: %s\n", conn->index, reason);
+		epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+		close(conn->fd);
+		conn->closed = 1;
+	}
+}
+
+/* write as much as possible of the output buffer */
+static void conn_flush(struct conn *conn)
+{
+	ssize_t rc;
+	struct epoll_event ev;
+	int wants;
+
+	while (conn->out.begin < conn->out.end) {
+		rc = write(conn->fd, &conn->out.data[conn->out.begin], conn->out.end - conn->out.begin);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN) {
+				conn_close(conn, strerror(errno));
+				return;
+			}
+			break;
+		}
+		conn->out.begin += (size_t)rc;
+	}
+	wants = conn->out.begin < conn->out.end;
+	if (wants != conn->wants_out) {
+		conn->wants_out = wants;
+		ev.events = EPOLLIN | (wants ? EPOLLOUT : 0);
+		ev.data.ptr = conn;
+		epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+	}
+}
+
+/* connect to host:port and do the websocket handshake */
+static int conn_open(struct conn *conn, const char *host, const char *port, const char *path)
+{
+	struct addrinfo hints, *res, *ai;
+	unsigned char nonce[16];
+	char key[32], req[1024], *hend;
+	struct epoll_event ev;
+	ssize_t rc;
+	int fd, one, i;
+
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0)
+		return -1;
+	fd = -1;
+	for (ai = res ; ai != NULL && fd < 0 ; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+		if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+	if (fd < 0)
+		return -1;
+	one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+	/* handshake */
+	for (i = 0 ; i < 16 ; i++)
+		nonce[i] = (unsigned char)rnd();
+	base64(nonce, sizeof nonce, key);
+	rc = snprintf(req, sizeof req,
+		"GET %s HTTP/1.1\r\n"
+		"Host: %s:%s\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Key: %s\r\n"
+		"Sec-WebSocket-Protocol: " PROTOCOL "\r\n"
+		"Sec-WebSocket-Version: 13\r\n"
+		"Content-Length: 0\r\n"
+		"\r\n", path, host, port, key);
+	if (rc < 0 || (size_t)rc >= sizeof req || write(fd, req, (size_t)rc) != rc)
+		goto error;
+
+	/* read the reply header */
+	for (;;) {
+		rc = read(fd, buffer_reserve(&conn->in, 1024), 1024);
+		if (rc <= 0)
+			goto error;
+		conn->in.end += (size_t)rc;
+		buffer_add(&conn->in, "", 1);
+		conn->in.end--;
+		hend = strstr(&conn->in.data[conn->in.begin], "\r\n\r\n");
+		if (hend != NULL)
+			break;
+	}
+	if (strncmp(&conn->in.data[conn->in.begin], "HTTP/1.1 101", 12)) {
+		*hend = 0;
+		fprintf(stderr, "upgrade refused: %s\n", &conn->in.data[conn->in.begin]);
+		goto error;
+	}
+	conn->in.begin = (size_t)(hend + 4 - conn->in.data);
+
+	/* nonblocking mode */
+	fcntl(fd, F_SETFL, O_NONBLOCK | fcntl(fd, F_GETFL));
+	conn->fd = fd;
+	ev.events = EPOLLIN;
+	ev.data.ptr = conn;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		goto error;
+	return 0;
+
+error:
+	close(fd);
+	return -1;
+}
+
+/******************************************************************************/
+/* calls                                                                      */
+/******************************************************************************/
+
+/* send the next command of the script on the connection */
+static void conn_send(struct conn *conn, uint64_t origin)
+{
+	struct command *cmd;
+	struct pending *pend;
+	unsigned slot;
+	char head[32];
+	int len;
+
+	slot = conn->freeslots[--conn->nfree];
+	cmd = &commands[conn->next_command];
+	if (++conn->next_command >= ncommands)
+		conn->next_command = 0;
+	pend = &conn->pendings[slot];
+	pend->start = origin;
+	pend->proc = cmd->proc;
+	conn->npending++;
+	sent++;
+
+	len = snprintf(head, sizeof head, "[2,\"%u", slot);
+	ws_queue_frame(conn, OP_TEXT, head, (size_t)len, cmd->tail, cmd->taillen);
+}
+
+/* can the connection send a new call? */
+static int conn_can_send(struct conn *conn)
+{
+	return !conn->closed
+		&& conn->nfree > 0
+		&& (maxcount == 0 || sent < maxcount)
+		&& (stop_time == 0 || conn->next_due < stop_time);
+}
+
+/* send the calls that are due */
+static void conn_send_due(struct conn *conn, uint64_t now)
+{
+	if (rate > 0) {
+		while (conn_can_send(conn) && conn->next_due <= now) {
+			if (now - conn->next_due > interval)
+				late++;
+			conn_send(conn, conn->next_due);
+			conn->next_due += interval;
+		}
+	}
+	else {
+		while (conn_can_send(conn) && now < stop_time)
+			conn_send(conn, now);
+	}
+	conn_flush(conn);
+}
+
+/* process the received message */
+static void conn_message(struct conn *conn, char *data, size_t len, uint64_t now)
+{
+	json_object *obj, *item;
+	struct pending *pend;
+	struct proc *proc;
+	unsigned long slot;
+	const char *id;
+	char *end;
+	int code;
+
+	json_tokener_reset(tokener);
+	obj = json_tokener_parse_ex(tokener, data, (int)len);
+	if (obj == NULL || !json_object_is_type(obj, json_type_array) || json_object_array_length(obj) < 2) {
+		fprintf(stderr, "connection %u: unexpected message %.*s\n", conn->index, (int)len, data);
+		json_object_put(obj);
+		return;
+	}
+
+	code = json_object_get_int(json_object_array_get_idx(obj, 0));
+	if (code == 5)
+		conn->events++;
+	else if (code == 3 || code == 4) {
+		item = json_object_array_get_idx(obj, 1);
+		id = json_object_get_string(item);
+		slot = id ? strtoul(id, &end, 10) : depth;
+		if (slot >= depth || *end || conn->pendings[slot].proc == UINT32_MAX)
+			fprintf(stderr, "connection %u: unexpected reply id %s\n", conn->index, id ?: "?");
+		else {
+			pend = &conn->pendings[slot];
+			proc = &procs[pend->proc];
+			if (pend->start >= warmup_time)
+				bench_histo_record(proc->histo, now - pend->start);
+			if (code == 4)
+				proc->errors++;
+			pend->proc = UINT32_MAX;
+			conn->freeslots[conn->nfree++] = (unsigned)slot;
+			conn->npending--;
+			received++;
+		}
+	}
+	json_object_put(obj);
+}
+
+/* decode the received websocket frames */
+static void conn_decode(struct conn *conn, uint64_t now)
+{
+	unsigned char *p, *mask;
+	size_t avail, hlen, len, i;
+	int opcode, fin;
+
+	while (!conn->closed) {
+		p = (unsigned char*)&conn->in.data[conn->in.begin];
+		avail = conn->in.end - conn->in.begin;
+		if (avail < 2)
+			return;
+		fin = p[0] & 0x80;
+		opcode = p[0] & 15;
+		len = p[1] & 127;
+		hlen = 2;
+		if (len == 126) {
+			if (avail < 4)
+				return;
+			len = (size_t)p[2] << 8 | p[3];
+			hlen = 4;
+		}
+		else if (len == 127) {
+			if (avail < 10)
+				return;
+			for (len = 0, i = 0 ; i < 8 ; i++)
+				len = len << 8 | p[2 + i];
+			hlen = 10;
+		}
+		mask = NULL;
+		if (p[1] & 0x80) {
+			mask = &p[hlen];
+			hlen += 4;
+		}
+		if (avail < hlen + len)
+			return;
+		p += hlen;
+		if (mask != NULL)
+			for (i = 0 ; i < len ; i++)
+				p[i] ^= mask[i & 3];
+		conn->in.begin += hlen + len;
+
+		switch (opcode) {
+		case OP_TEXT:
+		case OP_BINARY:
+		case OP_CONTINUATION:
+			buffer_add(&conn->msg, p, len);
+			if (fin) {
+				buffer_add(&conn->msg, "", 1);
+				conn_message(conn, &conn->msg.data[conn->msg.begin], conn->msg.end - conn->msg.begin - 1, now);
+				conn->msg.begin = conn->msg.end = 0;
+			}
+			break;
+		case OP_PING:
+			ws_queue_frame(conn, OP_PONG, (char*)p, len, NULL, 0);
+			break;
+		case OP_CLOSE:
+			conn_close(conn, "closed by server");
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void conn_read(struct conn *conn)
+{
+	ssize_t rc;
+	uint64_t now;
+
+	for (;;) {
+		rc = read(conn->fd, buffer_reserve(&conn->in, 65536), 65536);
+		if (rc > 0) {
+			conn->in.end += (size_t)rc;
+			continue;
+		}
+		if (rc == 0)
+			conn_close(conn, "end of stream");
+		else if (errno == EINTR)
+			continue;
+		else if (errno != EAGAIN)
+			conn_close(conn, strerror(errno));
+		break;
+	}
+	now = now_ns();
+	conn_decode(conn, now);
+	if (!conn->closed)
+		conn_send_due(conn, now);
+}
+
+/******************************************************************************/
+/* main loop                                                                  */
+/******************************************************************************/
+
+/* arm the timer for the next due call of open loop */
+static void arm_timer(void)
+{
+	struct itimerspec its;
+	uint64_t next = UINT64_MAX;
+	unsigned idx;
+
+	for (idx = 0 ; idx < nconns ; idx++)
+		if (conn_can_send(&conns[idx]) && conns[idx].next_due < next)
+			next = conns[idx].next_due;
+	memset(&its, 0, sizeof its);
+	if (next != UINT64_MAX) {
+		its.it_value.tv_sec = (time_t)(next / 1000000000ull);
+		its.it_value.tv_nsec = (long)(next % 1000000000ull);
+		if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+			its.it_value.tv_nsec = 1;
+	}
+	timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void run(void)
+{
+	struct epoll_event events[MAX_EVENTS];
+	struct epoll_event ev;
+	uint64_t now, expirations, pending, drain;
+	unsigned idx;
+	int n, i, timeout, alive;
+
+	timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, timerfd, &ev);
+
+	start_time = now_ns();
+	warmup_time = start_time + (uint64_t)(warmup * 1e9);
+	stop_time = duration > 0 ? start_time + (uint64_t)((duration + warmup) * 1e9) : UINT64_MAX;
+	if (rate > 0) {
+		interval = (uint64_t)((double)nconns * 1e9 / rate);
+		for (idx = 0 ; idx < nconns ; idx++)
+			conns[idx].next_due = start_time + idx * interval / nconns;
+	}
+	for (idx = 0 ; idx < nconns ; idx++)
+		conn_send_due(&conns[idx], start_time);
+
+	drain = 0;
+	for (;;) {
+		now = now_ns();
+		alive = 0;
+		pending = 0;
+		for (idx = 0 ; idx < nconns ; idx++) {
+			if (!conns[idx].closed) {
+				alive++;
+				pending += conns[idx].npending;
+			}
+		}
+		if (!drain && ((maxcount && sent >= maxcount) || now >= stop_time))
+			drain = now + DRAIN_NS;
+		if (!alive || (drain && (pending == 0 || now >= drain)))
+			break;
+
+		if (rate > 0 && !drain)
+			arm_timer();
+		if (drain)
+			timeout = (int)((drain - now) / 1000000 + 1);
+		else if (stop_time - now < 1000000000ull)
+			timeout = (int)((stop_time - now) / 1000000 + 1);
+		else
+			timeout = 1000;
+		n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+		for (i = 0 ; i < n ; i++) {
+			if (events[i].data.ptr == NULL) {
+				if (read(timerfd, &expirations, sizeof expirations) < 0)
+					expirations = 0;
+				now = now_ns();
+				for (idx = 0 ; idx < nconns ; idx++)
+					conn_send_due(&conns[idx], now);
+			}
+			else {
+				struct conn *conn = events[i].data.ptr;
+				if (events[i].events & (EPOLLERR | EPOLLHUP))
+					conn_close(conn, "error or hang up");
+				else {
+					if (events[i].events & EPOLLIN)
+						conn_read(conn);
+					if (!conn->closed && (events[i].events & EPOLLOUT))
+						conn_flush(conn);
+				}
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+/* report                                                                     */
+/******************************************************************************/
+
+static void report(void)
+{
+	bench_histo_t *total;
+	uint64_t events, errors;
+	unsigned idx;
+	double elapsed;
+
+	total = bench_histo_create();
+	if (total == NULL)
+		oom();
+	events = errors = 0;
+	for (idx = 0 ; idx < nconns ; idx++)
+		events += conns[idx].events;
+
+	bench_histo_print_header(stdout, "us");
+	for (idx = 0 ; idx < nprocs ; idx++) {
+		bench_histo_merge(total, procs[idx].histo);
+		errors += procs[idx].errors;
+		bench_histo_print_summary(procs[idx].histo, stdout, procs[idx].name, 1000.0);
+	}
+	bench_histo_print_summary(total, stdout, "*", 1000.0);
+
+	elapsed = (double)(now_ns() - start_time) / 1e9;
+	printf("\nsent %llu, replied %llu, errors %llu, events %llu, late %llu in %.3f s: %.0f replies/s\n",
+		(unsigned long long)sent, (unsigned long long)received,
+		(unsigned long long)errors, (unsigned long long)events,
+		(unsigned long long)late, elapsed, elapsed > 0 ? (double)received / elapsed : 0.0);
+
+	if (percentiles) {
+		for (idx = 0 ; idx < nprocs ; idx++) {
+			printf("\n# %s\n", procs[idx].name);
+			bench_histo_print_percentiles(procs[idx].histo, stdout, 1000.0);
+		}
+		printf("\n# *\n");
+		bench_histo_print_percentiles(total, stdout, 1000.0);
+	}
+	bench_histo_destroy(total);
+}
+
+/******************************************************************************/
+/* main                                                                       */
+/******************************************************************************/
+
+static const char short_options[] = "c:d:r:D:n:W:f:Ph";
+static const struct option long_options[] = {
+	{ "connections", required_argument, NULL, 'c' },
+	{ "depth",       required_argument, NULL, 'd' },
+	{ "rate",        required_argument, NULL, 'r' },
+	{ "duration",    required_argument, NULL, 'D' },
+	{ "count",       required_argument, NULL, 'n' },
+	{ "warmup",      required_argument, NULL, 'W' },
+	{ "file",        required_argument, NULL, 'f' },
+	{ "percentiles", no_argument,       NULL, 'P' },
+	{ "help",        no_argument,       NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void usage(const char *prog, FILE *file)
+{
+	fprintf(file,
+		"usage: %s [options] [HOST:PORT/PATH]\n"
+		"\n"
+		"Plays the commands of the script (lines 'API VERB [ARGS]') on binder\n"
+		"at HOST:PORT/PATH (default %s) using protocol " PROTOCOL ".\n"
+		"\n"
+		"  -c, --connections=N  count of connections (default %u)\n"
+		"  -d, --depth=N        pending calls per connection (default %u)\n"
+		"  -r, --rate=R         open loop at R calls per second for all\n"
+		"                       connections (default: closed loop)\n"
+		"  -D, --duration=S     duration of the measure in seconds (default %g)\n"
+		"  -n, --count=N        stops after N calls\n"
+		"  -W, --warmup=S       unmeasured seconds before the measure\n"
+		"  -f, --file=FILE      the script (default: standard input)\n"
+		"  -P, --percentiles    also print percentile distributions\n"
+		"  -h, --help           print this help\n",
+		prog, url, nconns, depth, duration);
+}
+
+static double get_number(const char *prog, const char *arg, double min)
+{
+	char *end;
+	double value = strtod(arg, &end);
+
+	if (*arg == 0 || *end != 0 || value < min) {
+		fprintf(stderr, "invalid number %s\n", arg);
+		usage(prog, stderr);
+		exit(EXIT_FAILURE);
+	}
+	return value;
+}
+
+int main(int ac, char **av)
+{
+	char *host, *port, *path, *spec;
+	struct conn *conn;
+	unsigned idx, slot;
+	int opt;
+
+	while ((opt = getopt_long(ac, av, short_options, long_options, NULL)) >= 0) {
+		switch (opt) {
+		case 'c': nconns = (unsigned)get_number(av[0], optarg, 1); break;
+		case 'd': depth = (unsigned)get_number(av[0], optarg, 1); break;
+		case 'r': rate = get_number(av[0], optarg, 0); break;
+		case 'D': duration = get_number(av[0], optarg, 0); break;
+		case 'n': maxcount = (uint64_t)get_number(av[0], optarg, 1); break;
+		case 'W': warmup = get_number(av[0], optarg, 0); break;
+		case 'f': script = optarg; break;
+		case 'P': percentiles = 1; break;
+		case 'h': usage(av[0], stdout); return EXIT_SUCCESS;
+		default: usage(av[0], stderr); return EXIT_FAILURE;
+		}
+	}
+	if (optind < ac)
+		url = av[optind++];
+	if (optind < ac) {
+		usage(av[0], stderr);
+		return EXIT_FAILURE;
+	}
+	if (maxcount && duration == 10)
+		duration = 0;
+
+	/* split the url */
+	spec = strdup(strncmp(url, "ws://", 5) ? url : &url[5]);
+	if (spec == NULL)
+		oom();
+	host = spec;
+	path = strchr(spec, '/');
+	if (path == NULL)
+		path = "/api";
+	else {
+		path = strdup(path);
+		if (path == NULL)
+			oom();
+		*strchr(spec, '/') = 0;
+	}
+	port = strrchr(host, ':');
+	if (port == NULL)
+		port = "80";
+	else
+		*port++ = 0;
+
+	read_script(script);
+	tokener = json_tokener_new();
+	if (tokener == NULL)
+		oom();
+	rndstate ^= (uint32_t)now_ns() ^ (uint32_t)getpid();
+
+	/* connect */
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	conns = calloc(nconns, sizeof *conns);
+	if (conns == NULL)
+		oom();
+	for (idx = 0 ; idx < nconns ; idx++) {
+		conn = &conns[idx];
+		conn->index = idx;
+		conn->pendings = malloc(depth * sizeof *conn->pendings);
+		conn->freeslots = malloc(depth * sizeof *conn->freeslots);
+		if (conn->pendings == NULL || conn->freeslots == NULL)
+			oom();
+		for (slot = 0 ; slot < depth ; slot++) {
+			conn->pendings[slot].proc = UINT32_MAX;
+			conn->freeslots[slot] = depth - 1 - slot;
+		}
+		conn->nfree = depth;
+		if (conn_open(conn, host, port, path) < 0) {
+			fprintf(stderr, "can't connect to %s:%s%s\n", host, port, path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	run();
+	report();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,551 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+/*
+ * In-process benchmark of the verb dispatch of libafb-binder.
+ *
+ * A binder is created using AfbBinderConfig, synthetic APIs are declared
+ * using AfbApiCreate and calls are driven from the main thread
+ * through AfbBinderEnter + AfbPollRunJobs. No transport is involved, so
+ * the figures measure the cost of the binder itself.
+ *
+ * Scenarios:
+ *  - sync:    the verb replies immediately
+ *  - async:   the verb replies later from a posted job
+ *  - subcall: the verb subcalls 'sync' and replies its result
+ *  - event:   an event is broadcasted and received by an other API
+ *
+ * The options --threads-cpus and --numa-policy place the binder like the
+ * binder settings of the same name. With --busy, spinning threads that
+ * are started before are left free to run on any CPU: comparing p99 and
+ * p999 with and without --threads-cpus then shows the effect of the
+ * placement on the tail latency.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <json-c/json.h>
+#include <rp-utils/rp-jsonc.h>
+
+#include "libafb-binder.h"
+#include "bench-histo.h"
+
+#define BENCH_API	"bench"
+#define BENCH_EVENT	"tick"
+#define STALL_NS	(5 * 1000000000ull)
+
+/* a scenario */
+struct scenario
+{
+	/** name of the scenario */
+	const char *name;
+
+	/** name of the called verb or NULL for events */
+	const char *verb;
+};
+
+static const struct scenario scenarios[] = {
+	{ .name = "sync",    .verb = "sync" },
+	{ .name = "async",   .verb = "async" },
+	{ .name = "subcall", .verb = "subcall" },
+	{ .name = "event",   .verb = NULL },
+	{ .name = NULL }
+};
+
+struct run;
+
+/* an in-flight slot */
+struct slot
+{
+	/** the run */
+	struct run *run;
+
+	/** index of the slot */
+	unsigned index;
+
+	/** start time of the pending operation */
+	uint64_t start;
+
+	/** is issue running for the slot */
+	int issuing;
+
+	/** operation completed during issue, issue the next one */
+	int again;
+};
+
+/* state of one run of a scenario */
+struct run
+{
+	const struct scenario *scenario;
+	uint64_t total;
+	uint64_t warmup;
+	uint64_t issued;
+	uint64_t done;
+	uint64_t errors;
+	uint64_t start;
+	uint64_t stop;
+	bench_histo_t *histo;
+	unsigned window;
+	struct slot *slots;
+};
+
+/* global settings */
+static uint64_t count = 100000;
+static uint64_t warmup = 1000;
+static unsigned window = 1;
+static size_t payload_size = 16;
+static int verbose = 0;
+static int percentiles = 0;
+static const char *thread_cpus = NULL;
+static const char *numa_policy = NULL;
+static unsigned busy = 0;
+
+/* the binder items */
+static AfbBinderHandleT *binder;
+static afb_api_t caller_api;
+static afb_api_t bench_api;
+static afb_api_t listener_api;
+static afb_data_t payload;
+
+/* the current run */
+static struct run *current;
+
+/* get current time in nanoseconds */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/******************************************************************************/
+/* implementation of the verbs                                                */
+/******************************************************************************/
+
+static void verb_sync(afb_req_t req, unsigned nparams, afb_data_t const params[])
+{
+	afb_data_array_addref(nparams, params);
+	afb_req_reply(req, 0, nparams, params);
+}
+
+static void async_reply(int signum, void *arg)
+{
+	afb_req_t req = arg;
+	afb_req_reply(req, signum ? AFB_ERRNO_INTERNAL_ERROR : 0, 0, NULL);
+	afb_req_unref(req);
+}
+
+static void verb_async(afb_req_t req, unsigned nparams, afb_data_t const params[])
+{
+	afb_req_addref(req);
+	if (afb_job_post(0, 0, async_reply, req, NULL) < 0)
+		async_reply(-1, req);
+}
+
+static void subcall_reply(void *closure, int status, unsigned nreplies, afb_data_t const replies[], afb_req_t req)
+{
+	afb_data_array_addref(nreplies, replies);
+	afb_req_reply(req, status, nreplies, replies);
+}
+
+static void verb_subcall(afb_req_t req, unsigned nparams, afb_data_t const params[])
+{
+	afb_data_array_addref(nparams, params);
+	afb_req_subcall(req, BENCH_API, "sync", nparams, params, 0, subcall_reply, NULL);
+}
+
+/* the verbs of the benched API */
+static const struct {
+	const char *name;
+	afb_req_callback_t callback;
+} verbs[] = {
+	{ "sync", verb_sync },
+	{ "async", verb_async },
+	{ "subcall", verb_subcall },
+};
+
+/*
+ * The verbs are declared with the API, that is sealed at creation, so
+ * they share one callback. It dispatches to the implementation of the
+ * verb, that is searched on first call and then kept in the userdata
+ * of the verb.
+ */
+static void verb_dispatch(afb_req_t req, unsigned nparams, afb_data_t const params[])
+{
+	AfbVcbDataT *vcb = afb_req_get_vcbdata(req);
+	afb_req_callback_t callback = (afb_req_callback_t)vcb->userdata;
+	unsigned idx;
+
+	if (callback == NULL) {
+		for (idx = 0 ; strcmp(verbs[idx].name, vcb->uid) ; idx++);
+		callback = verbs[idx].callback;
+		vcb->userdata = (void*)callback;
+	}
+	callback(req, nparams, params);
+}
+
+/******************************************************************************/
+/* driving the runs                                                           */
+/******************************************************************************/
+
+static void issue(struct slot *slot);
+
+/*
+ * records completion of the operation of the slot and issue the next one,
+ * or let issue do it when the completion happens within it
+ */
+static void complete(struct slot *slot, int status)
+{
+	struct run *run = slot->run;
+	uint64_t stop = now_ns();
+
+	if (status < 0)
+		run->errors++;
+	if (run->done == run->warmup)
+		run->start = slot->start;
+	if (run->done >= run->warmup)
+		bench_histo_record(run->histo, stop - slot->start);
+	run->done++;
+	run->stop = stop;
+	if (run->issued < run->total) {
+		if (slot->issuing)
+			slot->again = 1;
+		else
+			issue(slot);
+	}
+}
+
+static void on_reply(void *closure, int status, unsigned nreplies, afb_data_t const replies[], afb_api_t api)
+{
+	complete(closure, status);
+}
+
+static void on_event(void *closure, const char *name, unsigned nparams, afb_data_t const params[], afb_api_t api)
+{
+	const unsigned *index;
+
+	if (current != NULL && nparams == 1) {
+		index = afb_data_ro_pointer(params[0]);
+		if (index != NULL && *index < current->window)
+			complete(&current->slots[*index], 0);
+	}
+}
+
+/* starts operations of the slot until one is pending */
+static void issue(struct slot *slot)
+{
+	struct run *run = slot->run;
+	afb_data_t data;
+
+	slot->issuing = 1;
+	do {
+		slot->again = 0;
+		run->issued++;
+		slot->start = now_ns();
+		if (run->scenario->verb != NULL) {
+			afb_data_addref(payload);
+			afb_api_call(caller_api, BENCH_API, run->scenario->verb, 1, &payload, on_reply, slot);
+		}
+		else if (afb_create_data_copy(&data, AFB_PREDEFINED_TYPE_BYTEARRAY, &slot->index, sizeof slot->index) < 0
+		      || afb_api_broadcast_event(bench_api, BENCH_EVENT, 1, &data) < 0) {
+			/* not delivered, count it as an error */
+			complete(slot, -1);
+		}
+	} while (slot->again);
+	slot->issuing = 0;
+}
+
+/* run the scenario and print its summary */
+static int run_scenario(const struct scenario *scenario)
+{
+	struct run run;
+	unsigned idx;
+	uint64_t last, lastdone, now;
+	unsigned loops;
+	double elapsed;
+
+	memset(&run, 0, sizeof run);
+	run.scenario = scenario;
+	run.warmup = warmup;
+	run.total = count + warmup;
+	run.window = window;
+	run.histo = bench_histo_create();
+	run.slots = calloc(window, sizeof *run.slots);
+	if (run.histo == NULL || run.slots == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	current = &run;
+	for (idx = 0 ; idx < window && run.issued < run.total ; idx++) {
+		run.slots[idx].run = &run;
+		run.slots[idx].index = idx;
+		issue(&run.slots[idx]);
+	}
+
+	/*
+	 * poll until done, detecting stalls; the operations still pending
+	 * on a stall can't be cancelled and would complete on the freed run,
+	 * so the process is aborted
+	 */
+	last = now_ns();
+	lastdone = run.done;
+	loops = 0;
+	while (run.done < run.total) {
+		AfbPollRunJobs();
+		if ((++loops & 1023) == 0) {
+			now = now_ns();
+			if (run.done != lastdone) {
+				lastdone = run.done;
+				last = now;
+			}
+			else if (now - last > STALL_NS) {
+				fprintf(stderr, "scenario %s stalled after %llu operations\n",
+					scenario->name, (unsigned long long)run.done);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	current = NULL;
+
+	elapsed = (double)(run.stop - run.start) / 1e9;
+	bench_histo_print_summary(run.histo, stdout, scenario->name, 1000.0);
+	fprintf(stdout, "%-24s %10.0f calls/s, %llu errors\n", "",
+		elapsed > 0 ? (double)run.histo->count / elapsed : 0.0,
+		(unsigned long long)run.errors);
+	if (percentiles) {
+		bench_histo_print_percentiles(run.histo, stdout, 1000.0);
+		fprintf(stdout, "\n");
+	}
+
+	bench_histo_destroy(run.histo);
+	free(run.slots);
+	return run.errors ? -1 : 0;
+}
+
+/******************************************************************************/
+/* setup                                                                      */
+/******************************************************************************/
+
+static void setup(void)
+{
+	const char *errmsg;
+	json_object *config;
+	char *text;
+
+	/* create the binder without HTTP */
+	rp_jsonc_pack(&config, "{ss si}", "uid", "bench-afb-binder", "verbose", verbose);
+	if (thread_cpus != NULL)
+		json_object_object_add(config, "threads-cpus", json_object_new_string(thread_cpus));
+	if (numa_policy != NULL)
+		json_object_object_add(config, "numa-policy", json_object_new_string(numa_policy));
+	errmsg = AfbBinderConfig(config, &binder, NULL);
+	if (errmsg != NULL)
+		goto error;
+	caller_api = AfbBinderGetApi(binder);
+
+	/* create the benched API and its verbs */
+	rp_jsonc_pack(&config, "{ss ss ss s[{ss} {ss} {ss}]}",
+			"uid", BENCH_API, "api", BENCH_API, "info", "benched api",
+			"verbs", "uid", "sync", "uid", "async", "uid", "subcall");
+	errmsg = AfbApiCreate(binder, config, &bench_api, NULL, NULL, verb_dispatch, NULL, NULL);
+	if (errmsg != NULL)
+		goto error;
+
+	/* create the API listening the events */
+	rp_jsonc_pack(&config, "{ss s{ss ss}}",
+			"uid", "bench-listener",
+			"events", "uid", BENCH_EVENT, "pattern", BENCH_API "/*");
+	errmsg = AfbApiCreate(binder, config, &listener_api, NULL, NULL, NULL, on_event, NULL);
+	if (errmsg != NULL)
+		goto error;
+
+	/* the payload of calls */
+	text = malloc(payload_size + 3);
+	if (text == NULL) {
+		errmsg = "out of memory";
+		goto error;
+	}
+	text[0] = '"';
+	memset(&text[1], 'x', payload_size);
+	text[payload_size + 1] = '"';
+	text[payload_size + 2] = 0;
+	if (afb_create_data_raw(&payload, AFB_PREDEFINED_TYPE_JSON, text, payload_size + 3, free, text) < 0) {
+		errmsg = "can't create payload";
+		goto error;
+	}
+
+	/* start services without scheduler */
+	if (AfbBinderEnter(binder, NULL, NULL, NULL) < 0) {
+		errmsg = "can't start binder";
+		goto error;
+	}
+	return;
+
+error:
+	fprintf(stderr, "setup failed: %s\n", errmsg);
+	exit(EXIT_FAILURE);
+}
+
+/* a competing thread */
+static void *spin(void *arg)
+{
+	volatile uint64_t *counter = arg;
+
+	for (;;)
+		(*counter)++;
+	return NULL;
+}
+
+/* start the competing threads, before placing the binder */
+static void start_busy(void)
+{
+	static uint64_t counter;
+	pthread_t tid;
+	unsigned i;
+
+	for (i = 0 ; i < busy ; i++) {
+		if (pthread_create(&tid, NULL, spin, &counter) != 0) {
+			fprintf(stderr, "can't start busy thread\n");
+			exit(EXIT_FAILURE);
+		}
+		pthread_detach(tid);
+	}
+}
+
+/******************************************************************************/
+/* main                                                                       */
+/******************************************************************************/
+
+#define OPT_NUMA	256
+
+static const char short_options[] = "n:w:W:s:p:c:b:Pvh";
+static const struct option long_options[] = {
+	{ "count",       required_argument, NULL, 'n' },
+	{ "window",      required_argument, NULL, 'w' },
+	{ "warmup",      required_argument, NULL, 'W' },
+	{ "scenario",    required_argument, NULL, 's' },
+	{ "payload",     required_argument, NULL, 'p' },
+	{ "threads-cpus", required_argument, NULL, 'c' },
+	{ "numa-policy", required_argument, NULL, OPT_NUMA },
+	{ "busy",        required_argument, NULL, 'b' },
+	{ "percentiles", no_argument,       NULL, 'P' },
+	{ "verbose",     no_argument,       NULL, 'v' },
+	{ "help",        no_argument,       NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void usage(const char *prog, FILE *file)
+{
+	fprintf(file,
+		"usage: %s [options]\n"
+		"\n"
+		"  -n, --count=N        measured operations per scenario (default %llu)\n"
+		"  -w, --window=N       operations kept in flight (default %u)\n"
+		"  -W, --warmup=N       unmeasured operations before measure (default %llu)\n"
+		"  -s, --scenario=LIST  comma separated list of scenarios among\n"
+		"                       sync, async, subcall, event (default all)\n"
+		"  -p, --payload=SIZE   size of the JSON string sent to verbs (default %zu)\n"
+		"  -c, --threads-cpus=LIST  run the binder on the CPUs of LIST (example: 0-3,6)\n"
+		"      --numa-policy=POLICY  NUMA policy: default, local, bind or interleave\n"
+		"  -b, --busy=N         run N competing spinning threads on any CPU (default 0)\n"
+		"  -P, --percentiles    also print percentile distributions\n"
+		"  -v, --verbose        increase verbosity of the binder\n"
+		"  -h, --help           print this help\n",
+		prog, (unsigned long long)count, window,
+		(unsigned long long)warmup, payload_size);
+}
+
+static uint64_t get_number(const char *prog, const char *arg, uint64_t min)
+{
+	char *end;
+	unsigned long long value = strtoull(arg, &end, 10);
+
+	if (*arg == 0 || *end != 0 || value < min) {
+		fprintf(stderr, "invalid number %s\n", arg);
+		usage(prog, stderr);
+		exit(EXIT_FAILURE);
+	}
+	return (uint64_t)value;
+}
+
+/* check if name is in the comma separated list (NULL meaning all) */
+static int in_list(const char *list, const char *name)
+{
+	size_t len = strlen(name);
+
+	if (list == NULL)
+		return 1;
+	while (list != NULL) {
+		if (!strncmp(list, name, len) && (list[len] == ',' || list[len] == 0))
+			return 1;
+		list = strchr(list, ',');
+		if (list != NULL)
+			list++;
+	}
+	return 0;
+}
+
+int main(int ac, char **av)
+{
+	const char *list = NULL;
+	const struct scenario *scenario;
+	int opt, rc;
+
+	while ((opt = getopt_long(ac, av, short_options, long_options, NULL)) >= 0) {
+		switch (opt) {
+		case 'n': count = get_number(av[0], optarg, 1); break;
+		case 'w': window = (unsigned)get_number(av[0], optarg, 1); break;
+		case 'W': warmup = get_number(av[0], optarg, 0); break;
+		case 's': list = optarg; break;
+		case 'p': payload_size = (size_t)get_number(av[0], optarg, 0); break;
+		case 'c': thread_cpus = optarg; break;
+		case OPT_NUMA: numa_policy = optarg; break;
+		case 'b': busy = (unsigned)get_number(av[0], optarg, 0); break;
+		case 'P': percentiles = 1; break;
+		case 'v': verbose++; break;
+		case 'h': usage(av[0], stdout); return EXIT_SUCCESS;
+		default: usage(av[0], stderr); return EXIT_FAILURE;
+		}
+	}
+
+	start_busy();
+	setup();
+
+	printf("count %llu, window %u, warmup %llu, payload %zu, busy %u, cpus %s\n\n",
+		(unsigned long long)count, window, (unsigned long long)warmup, payload_size,
+		busy, thread_cpus ?: "all");
+	bench_histo_print_header(stdout, "us");
+
+	rc = EXIT_SUCCESS;
+	for (scenario = scenarios ; scenario->name != NULL ; scenario++) {
+		if (in_list(list, scenario->name) && run_scenario(scenario) < 0)
+			rc = EXIT_FAILURE;
+	}
+	return rc;
+}
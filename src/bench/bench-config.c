@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+/*
+ * Config expansion benchmark of afb-binder.
+ *
+ * Writes a synthetic tree of YAML fragments, one per binding, then
+ * measures the time taken by expand_config to load and merge all of
+ * them through a "$ref" listing them.
+ *
+ * The fragments are read by several threads, limited by the CPUs
+ * allowed to the process: run it under "taskset -c 0" to get the
+ * sequential reference.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <limits.h>
+#include <time.h>
+#include <sched.h>
+
+#include <json-c/json.h>
+
+#include "afb-binder-config.h"
+
+/* global settings */
+static unsigned nfrags = 500;
+static unsigned nrepeat = 5;
+static int keep = 0;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* write the fragment of index 'idx' in the directory 'dir' */
+static int make_fragment(const char *dir, unsigned idx, json_object *refs)
+{
+	char path[PATH_MAX];
+	FILE *file;
+	unsigned i;
+
+	snprintf(path, sizeof path, "%s/%04u-binding.yml", dir, idx);
+	file = fopen(path, "w");
+	if (file == NULL)
+		return -1;
+	fprintf(file,
+		"binding-%u:\n"
+		"  uid: binding-%u\n"
+		"  path: /usr/redpesk/binding-%u/lib/binding-%u.so\n"
+		"  info: synthetic binding number %u for benchmarking\n"
+		"  config:\n"
+		"    enabled: true\n"
+		"    timeout: %u\n"
+		"    ratio: 0.%u\n"
+		"    permissions:\n",
+		idx, idx, idx, idx, idx, 10 + idx % 50, idx);
+	for (i = 0 ; i < 8 ; i++)
+		fprintf(file, "      - urn:bench:binding-%u:permission-%u\n", idx, i);
+	fprintf(file, "    verbs:\n");
+	for (i = 0 ; i < 16 ; i++)
+		fprintf(file,
+			"      - verb: verb-%u\n"
+			"        info: verb %u of binding %u\n"
+			"        auth: urn:bench:binding-%u:permission-%u\n",
+			i, i, idx, idx, i % 8);
+	fclose(file);
+	json_object_array_add(refs, json_object_new_string(path));
+	return 0;
+}
+
+/* remove the tree */
+static void remove_tree(const char *dir)
+{
+	char path[PATH_MAX];
+	unsigned idx;
+
+	for (idx = 0 ; idx < nfrags ; idx++) {
+		snprintf(path, sizeof path, "%s/%04u-binding.yml", dir, idx);
+		unlink(path);
+	}
+	rmdir(dir);
+}
+
+static const char short_options[] = "n:r:kh";
+static const struct option long_options[] = {
+	{ "fragments", required_argument, NULL, 'n' },
+	{ "repeat",    required_argument, NULL, 'r' },
+	{ "keep",      no_argument,       NULL, 'k' },
+	{ "help",      no_argument,       NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void usage(const char *prog, FILE *file)
+{
+	fprintf(file,
+		"usage: %s [options]\n"
+		"\n"
+		"  -n, --fragments=N    count of YAML fragments (default %u)\n"
+		"  -r, --repeat=N       count of measures (default %u)\n"
+		"  -k, --keep           keep the generated tree\n"
+		"  -h, --help           print this help\n",
+		prog, nfrags, nrepeat);
+}
+
+static unsigned get_number(const char *prog, const char *arg, unsigned min)
+{
+	char *end;
+	unsigned long value = strtoul(arg, &end, 10);
+
+	if (*arg == 0 || *end != 0 || value < min || value > 100000) {
+		fprintf(stderr, "invalid number %s\n", arg);
+		usage(prog, stderr);
+		exit(EXIT_FAILURE);
+	}
+	return (unsigned)value;
+}
+
+int main(int ac, char **av)
+{
+	char dir[] = "/tmp/bench-config-XXXXXX";
+	json_object *refs, *config, *bindings;
+	uint64_t t0, t, tmin, tsum;
+	unsigned idx;
+	int opt, rc;
+	cpu_set_t cpus;
+
+	while ((opt = getopt_long(ac, av, short_options, long_options, NULL)) >= 0) {
+		switch (opt) {
+		case 'n': nfrags = get_number(av[0], optarg, 1); break;
+		case 'r': nrepeat = get_number(av[0], optarg, 1); break;
+		case 'k': keep = 1; break;
+		case 'h': usage(av[0], stdout); return EXIT_SUCCESS;
+		default: usage(av[0], stderr); return EXIT_FAILURE;
+		}
+	}
+
+	/* make the tree */
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return EXIT_FAILURE;
+	}
+	refs = json_object_new_array();
+	for (idx = 0 ; idx < nfrags ; idx++) {
+		if (make_fragment(dir, idx, refs) < 0) {
+			perror("fragment");
+			remove_tree(dir);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* measure */
+	tmin = UINT64_MAX;
+	tsum = 0;
+	for (idx = 0 ; idx < nrepeat ; idx++) {
+		config = json_object_new_object();
+		bindings = json_object_new_object();
+		json_object_object_add(bindings, "$ref", json_object_get(refs));
+		json_object_object_add(config, "bindings", bindings);
+		t0 = now_ns();
+		rc = expand_config(&config, 1);
+		t = now_ns() - t0;
+		if (rc < 0
+		 || !json_object_object_get_ex(config, "bindings", &bindings)
+		 || json_object_object_length(bindings) != (int)nfrags) {
+			fprintf(stderr, "expansion failed\n");
+			json_object_put(config);
+			break;
+		}
+		json_object_put(config);
+		tsum += t;
+		if (t < tmin)
+			tmin = t;
+	}
+
+	if (keep)
+		printf("tree kept in %s\n", dir);
+	else
+		remove_tree(dir);
+	json_object_put(refs);
+	if (idx < nrepeat)
+		return EXIT_FAILURE;
+
+	CPU_ZERO(&cpus);
+	sched_getaffinity(0, sizeof cpus, &cpus);
+	printf("fragments %u, allowed CPUs %d\n", nfrags, CPU_COUNT(&cpus));
+	printf("expansion min  %10.3f ms  (%.3f us/fragment)\n",
+		(double)tmin / 1e6, (double)tmin / 1e3 / nfrags);
+	printf("expansion mean %10.3f ms\n", (double)tsum / 1e6 / nrepeat);
+	return EXIT_SUCCESS;
+}
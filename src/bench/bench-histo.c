@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "bench-histo.h"
+
+/* get the index of the bucket of the value */
+static unsigned index_of(uint64_t value)
+{
+	unsigned shift;
+
+	if (value < BENCH_HISTO_SUB_BUCKETS)
+		return (unsigned)value;
+
+	/* shift is such that (value >> shift) is in [HALF, SUB) */
+	shift = (unsigned)(64 - __builtin_clzll(value)) - BENCH_HISTO_SUB_BITS;
+	return ((shift + 1) << (BENCH_HISTO_SUB_BITS - 1))
+		+ (unsigned)((value >> shift) & (BENCH_HISTO_HALF_BUCKETS - 1));
+}
+
+/* get the lowest value of the bucket of index */
+static uint64_t lowest_of(unsigned index)
+{
+	unsigned shift;
+	uint64_t sub;
+
+	if (index < BENCH_HISTO_SUB_BUCKETS)
+		return index;
+
+	shift = (index >> (BENCH_HISTO_SUB_BITS - 1)) - 1;
+	sub = BENCH_HISTO_HALF_BUCKETS + (index & (BENCH_HISTO_HALF_BUCKETS - 1));
+	return sub << shift;
+}
+
+/* get the highest value of the bucket of index */
+static uint64_t highest_of(unsigned index)
+{
+	return index + 1 < BENCH_HISTO_COUNT ? lowest_of(index + 1) - 1 : UINT64_MAX;
+}
+
+void bench_histo_reset(bench_histo_t *histo)
+{
+	memset(histo, 0, sizeof *histo);
+	histo->min = UINT64_MAX;
+}
+
+bench_histo_t *bench_histo_create(void)
+{
+	bench_histo_t *histo = malloc(sizeof *histo);
+	if (histo != NULL)
+		bench_histo_reset(histo);
+	return histo;
+}
+
+void bench_histo_destroy(bench_histo_t *histo)
+{
+	free(histo);
+}
+
+void bench_histo_record(bench_histo_t *histo, uint64_t value)
+{
+	histo->counts[index_of(value)]++;
+	histo->count++;
+	histo->sum += (long double)value;
+	if (value < histo->min)
+		histo->min = value;
+	if (value > histo->max)
+		histo->max = value;
+}
+
+void bench_histo_merge(bench_histo_t *dest, const bench_histo_t *src)
+{
+	unsigned idx;
+
+	for (idx = 0 ; idx < BENCH_HISTO_COUNT ; idx++)
+		dest->counts[idx] += src->counts[idx];
+	dest->count += src->count;
+	dest->sum += src->sum;
+	if (src->min < dest->min)
+		dest->min = src->min;
+	if (src->max > dest->max)
+		dest->max = src->max;
+}
+
+uint64_t bench_histo_percentile(const bench_histo_t *histo, double percentile)
+{
+	uint64_t target, acc, value;
+	unsigned idx;
+
+	if (histo->count == 0)
+		return 0;
+
+	if (percentile >= 100.0)
+		return histo->max;
+	target = (uint64_t)((percentile / 100.0) * (double)histo->count + 0.5);
+	if (target == 0)
+		target = 1;
+
+	for (acc = 0, idx = 0 ; idx < BENCH_HISTO_COUNT ; idx++) {
+		acc += histo->counts[idx];
+		if (acc >= target) {
+			/* report the highest equivalent value, clipped by extrema */
+			value = highest_of(idx);
+			if (value > histo->max)
+				value = histo->max;
+			if (value < histo->min)
+				value = histo->min;
+			return value;
+		}
+	}
+	return histo->max;
+}
+
+double bench_histo_mean(const bench_histo_t *histo)
+{
+	return histo->count ? (double)(histo->sum / (long double)histo->count) : 0.0;
+}
+
+void bench_histo_print_header(FILE *file, const char *unitname)
+{
+	fprintf(file, "%-24s %10s %10s %10s %10s %10s %10s %10s %10s   (%s)\n",
+		"name", "count", "min", "mean", "p50", "p90",
+		"p99", "p999", "max", unitname);
+}
+
+void bench_histo_print_summary(const bench_histo_t *histo, FILE *file, const char *name, double unit)
+{
+	fprintf(file, "%-24s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+		name, (unsigned long long)histo->count,
+		histo->count ? (double)histo->min / unit : 0.0,
+		bench_histo_mean(histo) / unit,
+		(double)bench_histo_percentile(histo, 50.0) / unit,
+		(double)bench_histo_percentile(histo, 90.0) / unit,
+		(double)bench_histo_percentile(histo, 99.0) / unit,
+		(double)bench_histo_percentile(histo, 99.9) / unit,
+		(double)histo->max / unit);
+}
+
+void bench_histo_print_percentiles(const bench_histo_t *histo, FILE *file, double unit)
+{
+	uint64_t acc;
+	unsigned idx;
+	double pct;
+
+	fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+	for (acc = 0, idx = 0 ; idx < BENCH_HISTO_COUNT ; idx++) {
+		if (histo->counts[idx] == 0)
+			continue;
+		acc += histo->counts[idx];
+		pct = (double)acc / (double)histo->count;
+		if (acc < histo->count)
+			fprintf(file, "%12.3f %14.12f %10llu %14.2f\n",
+				(double)highest_of(idx) / unit, pct,
+				(unsigned long long)acc, 1.0 / (1.0 - pct));
+		else
+			fprintf(file, "%12.3f %14.12f %10llu\n",
+				(double)histo->max / unit, pct,
+				(unsigned long long)acc);
+	}
+	fprintf(file, "#[Mean = %.3f, Max = %.3f, Total count = %llu]\n",
+		bench_histo_mean(histo) / unit, (double)histo->max / unit,
+		(unsigned long long)histo->count);
+}
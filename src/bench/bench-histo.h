@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief log-linear histogram of values
+ *
+ * Values are recorded in buckets of exponentially growing magnitude,
+ * each one split in BENCH_HISTO_SUB_BUCKETS linear sub-buckets. This
+ * gives a relative precision better than 2/BENCH_HISTO_SUB_BUCKETS on
+ * the whole range of uint64_t (same principle than HDR histograms).
+ */
+#define BENCH_HISTO_SUB_BITS       7
+#define BENCH_HISTO_SUB_BUCKETS    (1 << BENCH_HISTO_SUB_BITS)
+#define BENCH_HISTO_HALF_BUCKETS   (BENCH_HISTO_SUB_BUCKETS >> 1)
+#define BENCH_HISTO_COUNT          ((64 - BENCH_HISTO_SUB_BITS + 2) * BENCH_HISTO_HALF_BUCKETS)
+
+typedef struct bench_histo bench_histo_t;
+
+struct bench_histo
+{
+	/** count of recorded values */
+	uint64_t count;
+
+	/** smallest recorded value */
+	uint64_t min;
+
+	/** greatest recorded value */
+	uint64_t max;
+
+	/** sum of recorded values (for the mean) */
+	long double sum;
+
+	/** the counters */
+	uint64_t counts[BENCH_HISTO_COUNT];
+};
+
+/** reset the histogram */
+extern void bench_histo_reset(bench_histo_t *histo);
+
+/** allocates a new cleared histogram, returns NULL when out of memory */
+extern bench_histo_t *bench_histo_create(void);
+
+/** releases a histogram created by bench_histo_create */
+extern void bench_histo_destroy(bench_histo_t *histo);
+
+/** records the value */
+extern void bench_histo_record(bench_histo_t *histo, uint64_t value);
+
+/** adds the values of histogram src to histogram dest */
+extern void bench_histo_merge(bench_histo_t *dest, const bench_histo_t *src);
+
+/** get the value at the given percentile (0.0 .. 100.0) */
+extern uint64_t bench_histo_percentile(const bench_histo_t *histo, double percentile);
+
+/** get the mean of recorded values */
+extern double bench_histo_mean(const bench_histo_t *histo);
+
+/**
+ * print on one line the summary of the histogram: count, min, mean,
+ * p50, p90, p99, p999 and max, values being divided by 'unit'
+ */
+extern void bench_histo_print_summary(const bench_histo_t *histo, FILE *file, const char *name, double unit);
+
+/** print the header line matching bench_histo_print_summary */
+extern void bench_histo_print_header(FILE *file, const char *unitname);
+
+/**
+ * print the distribution in the percentile format of HdrHistogram
+ * (columns Value, Percentile, TotalCount, 1/(1-Percentile))
+ * so that it can be plotted with the usual HDR tools
+ */
+extern void bench_histo_print_percentiles(const bench_histo_t *histo, FILE *file, double unit);
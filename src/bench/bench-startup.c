@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2015-2026 IoT.bzh Company
+ *
+ * $RP_BEGIN_LICENSE$
+ * Commercial License Usage
+ *  Licensees holding valid commercial IoT.bzh licenses may use this file in
+ *  accordance with the commercial license agreement provided with the
+ *  Software or, alternatively, in accordance with the terms contained in
+ *  a written agreement between you and The IoT.bzh Company. For licensing terms
+ *  and conditions see https://www.iot.bzh/terms-conditions. For further
+ *  information use the contact form at https://www.iot.bzh/contact.
+ *
+ * GNU General Public License Usage
+ *  Alternatively, this file may be used under the terms of the GNU General
+ *  Public license version 3. This license is as published by the Free Software
+ *  Foundation and appearing in the file LICENSE.GPLv3 included in the packaging
+ *  of this file. Please review the following information to ensure the GNU
+ *  General Public License requirements will be met
+ *  https://www.gnu.org/licenses/gpl-3.0.html.
+ * $RP_END_LICENSE$
+ */
+
+
+/*
+ * Startup benchmark of libafb-binder.
+ *
+ * Measures the time taken by the creation of a binder whose configuration
+ * declares many ACLs (AfbBinderConfig) and by the creation of an API
+ * declaring many verbs protected by these ACLs (AfbApiCreate). Each ACL
+ * refers to the previous one so that cross references are resolved too.
+ *
+ * With --static, the verbs are added to the created API from a static
+ * table using AfbAddVerbsStatic instead of the JSON field "verbs".
+ *
+ * The binder state being global, one process makes one measure.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <json-c/json.h>
+#include <rp-utils/rp-jsonc.h>
+
+#include "libafb-binder.h"
+
+/* global settings */
+static unsigned nverbs = 10000;
+static unsigned nacls = 500;
+static int verbose = 0;
+static int use_static = 0;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void verb_null(afb_req_t req, unsigned nparams, afb_data_t const params[])
+{
+	afb_req_reply(req, 0, 0, NULL);
+}
+
+/* make the ACLs: acl-0 is a permission, acl-N is (acl-(N-1) or permission) */
+static json_object *make_acls(void)
+{
+	json_object *acls, *perm;
+	char name[32], text[64];
+	unsigned idx;
+
+	acls = json_object_new_object();
+	for (idx = 0 ; idx < nacls ; idx++) {
+		snprintf(name, sizeof name, "acl-%u", idx);
+		snprintf(text, sizeof text, "urn:bench:permission:%u", idx);
+		if (idx == 0)
+			perm = json_object_new_string(text);
+		else {
+			perm = json_object_new_array();
+			json_object_array_add(perm, json_object_new_string(text));
+			snprintf(text, sizeof text, "#acl-%u", idx - 1);
+			json_object_array_add(perm, json_object_new_string(text));
+			rp_jsonc_pack(&perm, "{so}", "or", perm);
+		}
+		json_object_object_add(acls, name, perm);
+	}
+	return acls;
+}
+
+/* make the verbs, spreading the ACLs */
+static json_object *make_verbs(void)
+{
+	json_object *verbs, *verb;
+	char name[32], auth[32];
+	unsigned idx;
+
+	verbs = json_object_new_array();
+	for (idx = 0 ; idx < nverbs ; idx++) {
+		snprintf(name, sizeof name, "verb-%u", idx);
+		snprintf(auth, sizeof auth, "acl-%u", idx % nacls);
+		rp_jsonc_pack(&verb, "{ss ss}", "verb", name, "auth", auth);
+		json_object_array_add(verbs, verb);
+	}
+	return verbs;
+}
+
+/* make the static table of verbs, spreading the ACLs */
+static AfbVerbDescT *make_table(AfbBinderHandleT *binder)
+{
+	AfbVerbDescT *table;
+	char name[32];
+	unsigned idx;
+
+	table = calloc(nverbs, sizeof *table);
+	if (table == NULL)
+		return NULL;
+	for (idx = 0 ; idx < nverbs ; idx++) {
+		snprintf(name, sizeof name, "verb-%u", idx);
+		table[idx].verb = strdup(name);
+		table[idx].callback = verb_null;
+		if (idx < nacls) {
+			snprintf(name, sizeof name, "acl-%u", idx);
+			table[idx].acl = AfbBinderAclIndex(binder, name);
+		}
+		else
+			table[idx].acl = table[idx % nacls].acl;
+	}
+	return table;
+}
+
+static const char short_options[] = "V:a:Svh";
+static const struct option long_options[] = {
+	{ "verbs",   required_argument, NULL, 'V' },
+	{ "acls",    required_argument, NULL, 'a' },
+	{ "static",  no_argument,       NULL, 'S' },
+	{ "verbose", no_argument,       NULL, 'v' },
+	{ "help",    no_argument,       NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void usage(const char *prog, FILE *file)
+{
+	fprintf(file,
+		"usage: %s [options]\n"
+		"\n"
+		"  -V, --verbs=N        count of verbs of the API (default %u)\n"
+		"  -a, --acls=N         count of ACLs of the binder (default %u)\n"
+		"  -S, --static         add verbs from a static table (AfbAddVerbsStatic)\n"
+		"  -v, --verbose        increase verbosity of the binder\n"
+		"  -h, --help           print this help\n",
+		prog, nverbs, nacls);
+}
+
+static unsigned get_number(const char *prog, const char *arg, unsigned min)
+{
+	char *end;
+	unsigned long value = strtoul(arg, &end, 10);
+
+	if (*arg == 0 || *end != 0 || value < min || value > 100000000) {
+		fprintf(stderr, "invalid number %s\n", arg);
+		usage(prog, stderr);
+		exit(EXIT_FAILURE);
+	}
+	return (unsigned)value;
+}
+
+int main(int ac, char **av)
+{
+	AfbBinderHandleT *binder;
+	afb_api_t api;
+	AfbVerbDescT *table;
+	json_object *config;
+	const char *errmsg;
+	uint64_t t0, t1, t2, tconf;
+	int opt;
+
+	while ((opt = getopt_long(ac, av, short_options, long_options, NULL)) >= 0) {
+		switch (opt) {
+		case 'V': nverbs = get_number(av[0], optarg, 1); break;
+		case 'a': nacls = get_number(av[0], optarg, 1); break;
+		case 'S': use_static = 1; break;
+		case 'v': verbose++; break;
+		case 'h': usage(av[0], stdout); return EXIT_SUCCESS;
+		default: usage(av[0], stderr); return EXIT_FAILURE;
+		}
+	}
+
+	/* binder with its ACLs */
+	rp_jsonc_pack(&config, "{ss si so}",
+			"uid", "bench-startup",
+			"verbose", verbose,
+			"acls", make_acls());
+	t0 = now_ns();
+	errmsg = AfbBinderConfig(config, &binder, NULL);
+	tconf = now_ns() - t0;
+	if (errmsg != NULL)
+		goto error;
+
+	/* API with its verbs */
+	if (!use_static) {
+		rp_jsonc_pack(&config, "{ss ss so}",
+				"uid", "bench",
+				"api", "bench",
+				"verbs", make_verbs());
+		t1 = now_ns();
+		errmsg = AfbApiCreate(binder, config, &api, NULL, NULL, verb_null, NULL, NULL);
+	}
+	else {
+		rp_jsonc_pack(&config, "{ss ss sb}",
+				"uid", "bench",
+				"api", "bench",
+				"seal", 0);
+		table = make_table(binder);
+		if (table == NULL) {
+			errmsg = "out of memory";
+			goto error;
+		}
+		t1 = now_ns();
+		errmsg = AfbApiCreate(binder, config, &api, NULL, NULL, NULL, NULL, NULL);
+		if (errmsg == NULL)
+			errmsg = AfbAddVerbsStatic(binder, api, table, nverbs);
+	}
+	t2 = now_ns();
+	if (errmsg != NULL)
+		goto error;
+
+	printf("acls %u, verbs %u, %s\n", nacls, nverbs, use_static ? "static" : "json");
+	printf("binder config  %10.3f ms\n", (double)tconf / 1e6);
+	printf("api creation   %10.3f ms  (%.3f us/verb)\n",
+		(double)(t2 - t1) / 1e6, (double)(t2 - t1) / 1e3 / nverbs);
+	return EXIT_SUCCESS;
+
+error:
+	fprintf(stderr, "failed: %s\n", errmsg);
+	return EXIT_FAILURE;
+}
@@ -24,6 +24,12 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/eventfd.h>
 
 #include <rp-utils/rp-jsonc.h>
 #include <rp-utils/rp-file.h>
@@ -37,6 +43,14 @@
 #include <libafb/afb-http.h>
 
 #include "afb-binder-defaults.h"
+#include "afb-binder-stats.h"
+#include "afb-binder-lazy.h"
+#include "afb-binder-affinity.h"
+#include "afb-binder-pool.h"
+#include "afb-binder-autoscale.h"
+#include "afb-binder-overload.h"
+#include "afb-binder-fair.h"
+#include "afb-binder-static.h"
 #include "libafb-binder.h"
 
 /* default settings */
@@ -105,6 +119,24 @@ typedef struct {
 }
     afbAclsHandleT;
 
+/**
+ * @brief table of permissions indexed by their uid
+ */
+typedef struct {
+    /** count of permissions */
+    unsigned count;
+
+    /** mask for the hash index, its size minus one */
+    unsigned mask;
+
+    /** hash index of entries: 0 when free or index of the entry plus 1 */
+    unsigned *index;
+
+    /** the permissions, followed by a terminator entry used for NO */
+    afbAclsHandleT entries[];
+}
+    afbAclsTableT;
+
 /**
  * @brief binder configuration deduced from JSON config
  */
@@ -147,9 +179,25 @@ typedef struct {
     /** initial count of threads started */
     int poolThreadSize;
 
+    /** worker pools dedicated to APIs */
+    json_object* poolsJ;
+
+    /** maximum count of threads when autoscaling, 0 for deducing it from CPUs, -1 for no autoscaling */
+    int threadAutoscale;
+
     /** maximum allowed count of pending jobs */
     int maxJobs;
 
+    /** policy applied when jobs overflow, NULL for none */
+    const char* jobsOverflow;
+
+    /** rate limits "RATE[:BURST]" of sessions and of the HTTP interface, NULL for none */
+    const char* sessionRate;
+    const char* interfaceRate;
+
+    /** count of pending jobs above which sessions are served in round robin, 0 for default, -1 for none */
+    int fairQueue;
+
     /** whether the binder should trap signal/faults */
     int trapfaults;
 
@@ -172,6 +220,9 @@ typedef struct {
     }
         trace;
 
+    /** exportation of the API of statistics: private, restricted or public */
+    const char* stats;
+
     /** specification of HTTP server */
     struct {
         /** TCP port */
@@ -201,6 +252,9 @@ typedef struct {
         /** */
         json_object* intfJ;
 
+        /** whether static files of aliases are served from memory */
+        int staticFiles;
+
         /** timeouts */
         struct {
             /** expiration of sessions */
@@ -212,8 +266,20 @@ typedef struct {
         } timeout;
     } httpd;
 
-    /** array of permissions */
-    afbAclsHandleT *acls;
+    /** table of permissions */
+    afbAclsTableT *acls;
+
+    /** time to live in seconds of cached permission decisions, 0 for no cache */
+    int aclCache;
+
+    /** start independent APIs concurrently following their classes */
+    int parallelStart;
+
+    /** CPUs allowed to the threads (example: "0-3,6"), NULL for all */
+    const char *threadCpus;
+
+    /** NUMA memory policy of the threads, NULL for unchanged */
+    const char *numaPolicy;
 }
     AfbBinderConfigT;
 
@@ -227,7 +293,9 @@ static AfbBinderConfigT binderConfigDflt = {
 
     .poolThreadMax=DEFAULT_THREADS_MAX,
     .poolThreadSize=DEFAULT_THREADS_POOL,
+    .threadAutoscale=-1,
     .maxJobs= DEFAULT_JOBS_MAX,
+    .fairQueue= -1,
 
     .httpd.port=DEFAULT_HTTP_PORT,
     .httpd.timeout.session=DEFAULT_SESSION_TIMEOUT,
@@ -236,6 +304,7 @@ static AfbBinderConfigT binderConfigDflt = {
     .httpd.rootapi="/api",
     .httpd.updir="/tmp",
     .httpd.onepage="/opa",
+    .httpd.staticFiles=1,
     .trapfaults=1,
 };
 
@@ -284,6 +353,12 @@ typedef struct {
 
     /** lazyness status of clients */
     const int lazy;
+
+    /** worker pool processing the requests */
+    const char *pool;
+
+    /** priority class within the pool */
+    const char *priority;
 }
     AfbApiConfigT;
 
@@ -312,11 +387,35 @@ struct AfbBinderHandleS {
     /** set of restricted APIs */
     afb_apiset *restrictedApis;
 
+    /** set of APIs called through HTTP, the public APIs gated by the admission policies if any */
+    afb_apiset *httpApis;
+
     /** default global API for receiving events */
     afb_api_x4_t  apiv4;
 
     /** configuration */
     AfbBinderConfigT config;
+
+    /** APIs to start following their classes (when parallelStart) */
+    struct AfbStartNodeS *startNodes;
+
+    /** last item of startNodes */
+    struct AfbStartNodeS **startLast;
+
+    /** host threads joined as workers of the scheduler */
+    struct AfbWorkerS *workers;
+
+    /** set by AfbBinderExit, telling joined workers to leave */
+    int exiting;
+
+    /** index of the ldpath directories, used until the binder starts */
+    struct LdpathDirS *ldpathDirs;
+
+    /** set when the binder started and the ldpath directories are no more indexed */
+    int ldpathUnindexed;
+
+    /** arenas of the closures of the verbs of the APIs */
+    struct ClosureArenaS *arenas;
 };
 
 static const nsKeyEnumT afbApiExportKeys[]= {
@@ -357,6 +456,41 @@ static int verbosity_to_mask(int verbosity)
     return (2 << (verbosity + afb_Log_Level_Error)) - 1;
 }
 
+/**
+ * @brief compute the hash of an uid of permission
+ *
+ * @param key the uid
+ *
+ * @return the hash value
+ */
+static unsigned AfbAclHash(const char *key) {
+    unsigned hash = 2166136261u;
+    while (*key)
+        hash = (hash ^ (unsigned char)*key++) * 16777619u;
+    return hash;
+}
+
+/**
+ * @brief search the index of an entry within API permissions' table
+ *
+ * @param afbAcls the table of permissions
+ * @param key     the uid to search in the table
+ * @param slot    if not NULL, receives the slot of the hash index where
+ *                the key is or should be inserted
+ *
+ * @return the index of the entry if found or a negative value otherwise
+ */
+static int AfbAclIndex(const afbAclsTableT *afbAcls, const char *key, unsigned *slot) {
+    unsigned idx, pos;
+
+    pos = AfbAclHash(key) & afbAcls->mask;
+    while ((idx = afbAcls->index[pos]) != 0 && strcmp(afbAcls->entries[idx - 1].uid, key))
+        pos = (pos + 1) & afbAcls->mask;
+    if (slot != NULL)
+        *slot = pos;
+    return (int)idx - 1;
+}
+
 /**
  * @brief search an auth within API permissions' table
  *
@@ -365,19 +499,17 @@ static int verbosity_to_mask(int verbosity)
  *
  * @return the found AUTH structure if found or NULL otherwise
  */
-static const afb_auth *AfbAclSearch(afbAclsHandleT *afbAcls, const char *key) {
-    if (afbAcls != NULL) {
-        while (afbAcls->uid != NULL) {
-            if (0 == strcmp(afbAcls->uid, key))
-                return &afbAcls->perm;
-            afbAcls++;
-        }
-    }
-    return NULL;
+static const afb_auth *AfbAclSearch(afbAclsTableT *afbAcls, const char *key) {
+    int idx;
+
+    if (afbAcls == NULL)
+        return NULL;
+    idx = AfbAclIndex(afbAcls, key, NULL);
+    return idx < 0 ? NULL : &afbAcls->entries[idx].perm;
 }
 
 /* forward decl, see below */
-static const char* AclBuildItem(afbAclsHandleT *acls, struct afb_auth *auth, json_object *permJ);
+static const char* AclBuildItem(afbAclsTableT *acls, struct afb_auth *auth, json_object *permJ);
 
 /**
  * @brief Put in auth the list of permissions given by permJ accordingly to the given type (afb_auth_And or afb_auth_Or)
@@ -389,7 +521,7 @@ static const char* AclBuildItem(afbAclsHandleT *acls, struct afb_auth *auth, jso
  *
  * @return NULL on success or an error report text
  */
-static const char* AclBuildSeq(afbAclsHandleT *acls, struct afb_auth *auth, json_object *permJ, enum afb_auth_type type) {
+static const char* AclBuildSeq(afbAclsTableT *acls, struct afb_auth *auth, json_object *permJ, enum afb_auth_type type) {
 
     struct afb_auth *first_auth, *next_auth;
     size_t idx, count;
@@ -432,7 +564,7 @@ static const char* AclBuildSeq(afbAclsHandleT *acls, struct afb_auth *auth, json
  *
  * @return NULL on success or an error report text
  */
-static const char* AclBuildItem (afbAclsHandleT *acls, struct afb_auth *auth, json_object *permJ) {
+static const char* AclBuildItem (afbAclsTableT *acls, struct afb_auth *auth, json_object *permJ) {
 
     const char *text;
     json_object *val;
@@ -456,11 +588,9 @@ static const char* AclBuildItem (afbAclsHandleT *acls, struct afb_auth *auth, js
             /* this is a reference to other_auth, trnaslate it as (other_auth OR NO) */
             auth->type = afb_auth_Or;
             auth->first = other_auth;
-            /* use the last entry of acls array for setting NO */
-            while (acls->uid != NULL)
-                acls++;
-            acls->perm.type = afb_auth_No;
-            auth->next = &acls->perm;
+            /* use the terminator entry of acls for setting NO */
+            acls->entries[acls->count].perm.type = afb_auth_No;
+            auth->next = &acls->entries[acls->count].perm;
         }
         return NULL;
 
@@ -554,33 +684,30 @@ static const char* AclBuildItem (afbAclsHandleT *acls, struct afb_auth *auth, js
 }
 
 /* forward declaration, see below */
-static void AclFreeAuthContent(afbAclsHandleT *acls, struct afb_auth *auth);
+static void AclFreeAuthContent(afbAclsTableT *acls, struct afb_auth *auth);
 
 /**
  * @brief free an auth and its content if it is not in acls
  *
- * @param acls array of permissions of reference
+ * @param acls table of permissions of reference
  * @param auth the auth to be freed
  */
-static void AclFreeAuth(afbAclsHandleT *acls, struct afb_auth *auth)
+static void AclFreeAuth(afbAclsTableT *acls, struct afb_auth *auth)
 {
-    afbAclsHandleT *it;
-    for (it = acls ; auth != &it->perm ; it++) {
-        if (it->uid == NULL) {
-            AclFreeAuthContent(acls, auth);
-            free(auth);
-            break;
-        }
+    uintptr_t addr = (uintptr_t)auth;
+    if (addr < (uintptr_t)&acls->entries[0] || addr >= (uintptr_t)&acls->entries[acls->count + 1]) {
+        AclFreeAuthContent(acls, auth);
+        free(auth);
     }
 }
 
 /**
  * @brief free the content of an Auth
  *
- * @param acls array of permissions of reference
+ * @param acls table of permissions of reference
  * @param auth the auth whose content is to be freed
  */
-static void AclFreeAuthContent(afbAclsHandleT *acls, struct afb_auth *auth)
+static void AclFreeAuthContent(afbAclsTableT *acls, struct afb_auth *auth)
 {
     switch(auth->type) {
     case afb_auth_Or:
@@ -598,32 +725,33 @@ static void AclFreeAuthContent(afbAclsHandleT *acls, struct afb_auth *auth)
 /**
  * @brief free the memory used by acls
  *
- * @param acls the first entry of the array to free
+ * @param acls the table to free
  */
-static void AfbAclFree(afbAclsHandleT *acls)
+static void AfbAclFree(afbAclsTableT *acls)
 {
-    afbAclsHandleT *it;
+    unsigned idx;
     if (acls != NULL) {
-        for(it = acls ; it->uid != NULL ; it++)
-            AclFreeAuthContent(acls, &it->perm);
+        for(idx = 0 ; idx < acls->count ; idx++)
+            AclFreeAuthContent(acls, &acls->entries[idx].perm);
         free(acls);
     }
 }
 
 /**
- * @brief Build an array of ACL accordingly to the given JSON spec
+ * @brief Build the table of ACL accordingly to the given JSON spec
  *
  * @param configJ the JSON specification of ACL
  *
- * @return the computed array of permisssons or NULL on error
+ * @return the computed table of permisssons or NULL on error
  */
-static afbAclsHandleT* AfbAclBuildFromJsonC (json_object *configJ) {
+static afbAclsTableT* AfbAclBuildFromJsonC (json_object *configJ) {
 
     const char *errorMsg;
     size_t count;
+    unsigned size, slot;
     int idx;
     struct json_object_iterator it, end;
-    afbAclsHandleT *acls = NULL;
+    afbAclsTableT *acls = NULL;
     json_object *permJ;
 
     /* must be an object */
@@ -632,35 +760,36 @@ static afbAclsHandleT* AfbAclBuildFromJsonC (json_object *configJ) {
         return NULL;
     }
 
-    /* allocate the result */
+    /* allocate the result: the table, its entries and its hash index */
     count = json_object_object_length (configJ);
-    acls = calloc (count + 1, sizeof(afbAclsHandleT));
+    for (size = 16 ; size < 2 * count ; size <<= 1);
+    acls = calloc (1, sizeof *acls + (count + 1) * sizeof acls->entries[0] + size * sizeof acls->index[0]);
     if (acls == NULL) {
         errorMsg = "Out of memory";
         goto OnErrorExit;
     }
+    acls->mask = size - 1;
+    acls->index = (unsigned*)&acls->entries[count + 1];
 
-    /* provision keys for cross references search */
+    /* provision and index keys for cross references search */
     end = json_object_iter_end(configJ);
     it = json_object_iter_begin(configJ);
-    idx = 0;
     while (!json_object_iter_equal(&it, &end)) {
-        acls[idx].uid = json_object_iter_peek_name(&it);
-        acls[idx].perm.type = afb_auth_No;
-        idx++;
+        idx = (int)acls->count++;
+        acls->entries[idx].uid = json_object_iter_peek_name(&it);
+        acls->entries[idx].perm.type = afb_auth_No;
+        AfbAclIndex(acls, acls->entries[idx].uid, &slot);
+        acls->index[slot] = acls->count;
         json_object_iter_next(&it);
     }
 
     /* build the values */
     it = json_object_iter_begin(configJ);
-    idx = 0;
     while (!json_object_iter_equal(&it, &end)) {
-        if (acls[idx].uid != json_object_iter_peek_name(&it))
-            for (idx = 0 ; idx < count && acls[idx].uid != json_object_iter_peek_name(&it); idx++);
+        idx = AfbAclIndex(acls, json_object_iter_peek_name(&it), NULL);
         permJ = json_object_iter_peek_value(&it);
-        errorMsg = AclBuildItem(acls, &acls[idx].perm, permJ);
+        errorMsg = AclBuildItem(acls, &acls->entries[idx].perm, permJ);
         if (errorMsg) goto OnErrorExit;
-        idx++;
         json_object_iter_next(&it);
     }
 
@@ -702,7 +831,9 @@ static int BinderAddOneAlias (void *context, json_object *aliasJ) {
     }
     fullpath= &colon[1];
 
-    /* add the alias */
+    /* add the alias, its static files being served from memory */
+    if (afb_binder_static_add(binder->hsrv, prefix, afb_common_rootdir_get_fd(), fullpath, 1) < 0)
+        LIBAFB_WARNING("BinderAddOneAlias can't serve static files of [%s] from memory", fullpath);
     status= afb_hsrv_add_alias(binder->hsrv, prefix, afb_common_rootdir_get_fd(), fullpath, 0, 0);
     if (status != AFB_HSRV_OK) {
         LIBAFB_ERROR("BinderAddOneAlias fail to add alias=[%s] path=[%s]", prefix, fullpath);
@@ -716,9 +847,262 @@ OnErrorExit:
     return -1;
 }
 
-/* add one verb to the given API */
-const char* AfbAddOneVerb (AfbBinderHandleT *binder, afb_api_x4_t apiv4, json_object *configJ,
-        afb_req_callback_x4_t callback, void *vcbData) {
+/**
+ * @brief create the worker pool of the specification poolJ
+ *
+ * @param context the binder (not used)
+ * @param poolJ   the specification of the pool
+ * @return 0 on success or -1 on error
+ */
+static int BinderAddOnePool (void *context, json_object *poolJ) {
+    return afb_binder_pool_create (poolJ) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief count of decisions cached per session
+ */
+#define ACL_CACHE_SIZE 64
+
+/**
+ * @brief verb data of verbs whose permission decisions are cached
+ */
+typedef struct {
+    /** the data seen by the callback, must be first */
+    AfbVcbDataT vcb;
+
+    /** the binder */
+    AfbBinderHandleT *binder;
+
+    /** the callback of the verb */
+    afb_req_callback_x4_t callback;
+
+    /** the permission required by the verb */
+    const afb_auth *auth;
+}
+    AclCachedVerbT;
+
+/**
+ * @brief a cached decision
+ */
+typedef struct {
+    /** the permission decided or NULL when free */
+    const afb_auth *auth;
+
+    /** the decision: 1 granted, 0 denied */
+    int granted;
+
+    /** expiration time in seconds */
+    time_t expire;
+}
+    AclCacheEntryT;
+
+/**
+ * @brief cache of decisions of one session, freed with the session
+ */
+typedef struct {
+    /** protects the entries */
+    pthread_mutex_t mutex;
+
+    /** the token for which decisions were taken, a reference is held */
+    struct afb_token *token;
+
+    /** the decisions */
+    AclCacheEntryT entries[ACL_CACHE_SIZE];
+}
+    AclCacheT;
+
+/**
+ * @brief pending asynchronous check of a cached verb
+ */
+typedef struct {
+    /** the verb */
+    AclCachedVerbT *verb;
+
+    /** the cache of the session */
+    AclCacheT *cache;
+
+    /** the request */
+    afb_req_x4_t req;
+
+    /** the token at time of request, a reference is held */
+    struct afb_token *token;
+
+    /** count of parameters */
+    unsigned nparams;
+
+    /** parameters, held by the request */
+    afb_data_x4_t const *params;
+}
+    AclCacheCheckT;
+
+/* monotonic time in seconds */
+static time_t AclCacheNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec;
+}
+
+/* slot of the auth in the cache */
+static AclCacheEntryT *AclCacheSlot(AclCacheT *cache, const afb_auth *auth) {
+    uintptr_t x = (uintptr_t)auth;
+    return &cache->entries[(x ^ (x >> 7)) % ACL_CACHE_SIZE];
+}
+
+/* free the cache of a session */
+static void AclCacheFree(void *closure) {
+    AclCacheT *cache = (AclCacheT*)closure;
+    if (cache->token != NULL)
+        afb_token_unref(cache->token);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+/* create the cache of a session */
+static int AclCacheInit(void *closure, void **value, void (**freecb)(void*), void **freeclo) {
+    AclCacheT *cache = calloc(1, sizeof *cache);
+    if (cache == NULL)
+        return X_ENOMEM;
+    pthread_mutex_init(&cache->mutex, NULL);
+    *value = *freeclo = cache;
+    *freecb = AclCacheFree;
+    return 0;
+}
+
+/**
+ * @brief get the cached decision for auth
+ *
+ * The cache holds a reference on the token of its decisions so that its
+ * address can not be reused by an other token while it is cached.
+ *
+ * @return 1 if granted, 0 if denied or -1 if not cached
+ */
+static int AclCacheGet(AclCacheT *cache, struct afb_token *token, const afb_auth *auth) {
+    AclCacheEntryT *entry = AclCacheSlot(cache, auth);
+    int result = -1;
+
+    pthread_mutex_lock(&cache->mutex);
+    if (cache->token != token) {
+        /* token changed, forget previous decisions */
+        memset(cache->entries, 0, sizeof cache->entries);
+        if (cache->token != NULL)
+            afb_token_unref(cache->token);
+        cache->token = token == NULL ? NULL : afb_token_addref(token);
+    }
+    else if (entry->auth == auth && entry->expire > AclCacheNow())
+        result = entry->granted;
+    pthread_mutex_unlock(&cache->mutex);
+    return result;
+}
+
+/* record the decision for auth */
+static void AclCacheSet(AclCacheT *cache, struct afb_token *token, const afb_auth *auth, int granted, int ttl) {
+    AclCacheEntryT *entry = AclCacheSlot(cache, auth);
+
+    pthread_mutex_lock(&cache->mutex);
+    if (cache->token == token) {
+        entry->auth = auth;
+        entry->granted = granted;
+        entry->expire = AclCacheNow() + ttl;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/* process the request of the verb accordingly to the decision */
+static void AclCacheProcess(AclCachedVerbT *verb, afb_req_x4_t req, int granted, unsigned nparams, afb_data_x4_t const params[]) {
+    if (granted > 0)
+        verb->callback(req, nparams, params);
+    else
+        afb_req_reply(req, AFB_ERRNO_INSUFFICIENT_SCOPE, 0, NULL);
+}
+
+/* receive the result of the asynchronous check */
+static void AclCacheCheckedCb(void *closure, int status) {
+    AclCacheCheckT *check = (AclCacheCheckT*)closure;
+
+    if (status >= 0 && check->cache != NULL)
+        AclCacheSet(check->cache, check->token, check->verb->auth, status > 0, check->verb->binder->config.aclCache);
+    AclCacheProcess(check->verb, check->req, status, check->nparams, check->params);
+    if (check->token != NULL)
+        afb_token_unref(check->token);
+    afb_req_unref(check->req);
+    free(check);
+}
+
+/**
+ * @brief callback of verbs whose permission decisions are cached
+ *
+ * The decision for the permission of the verb is searched in the cache of
+ * the session of the request. When not found, the permission is checked
+ * and the decision recorded for the time to live of the setting acl-cache.
+ */
+static void AclCacheVerbCb(afb_req_x4_t req, unsigned nparams, afb_data_x4_t const params[]) {
+    AclCachedVerbT *verb = (AclCachedVerbT*)afb_req_get_vcbdata(req);
+    struct afb_req_common *comreq = afb_req_v4_get_common(req);
+    AclCacheT *cache = NULL;
+    AclCacheCheckT *check;
+    int granted;
+
+    if (comreq->session == NULL
+     || afb_session_cookie_getinit(comreq->session, verb->binder, (void**)&cache, AclCacheInit, NULL) < 0)
+        cache = NULL;
+
+    granted = cache == NULL ? -1 : AclCacheGet(cache, comreq->token, verb->auth);
+    if (granted >= 0) {
+        AclCacheProcess(verb, req, granted, nparams, params);
+        return;
+    }
+
+    check = malloc(sizeof *check);
+    if (check == NULL) {
+        afb_req_reply(req, AFB_ERRNO_OUT_OF_MEMORY, 0, NULL);
+        return;
+    }
+    check->verb = verb;
+    check->cache = cache;
+    check->req = afb_req_addref(req);
+    check->token = comreq->token == NULL ? NULL : afb_token_addref(comreq->token);
+    check->nparams = nparams;
+    check->params = params;
+    afb_auth_check_async(comreq, verb->auth, AclCacheCheckedCb, check);
+}
+
+/**
+ * @brief get the text of an error returned by afb_api_v4_add_verb_hookable
+ *
+ * @param err the error code
+ *
+ * @return the text of the error
+ */
+static const char *AddVerbErrorMsg(int err) {
+    switch (err) {
+    case X_EEXIST:
+        return "verb already exists/registered";
+    case X_ENOMEM:
+        return "memory exhausted";
+    case X_EPERM:
+        return "permission denied";
+    default:
+        return strerror(-err);
+    }
+}
+
+/**
+ * @brief add one verb to the given API
+ *
+ * @param binder   the binder
+ * @param apiv4    the API
+ * @param configJ  specification of the verb
+ * @param callback callback of the verb
+ * @param vcbData  data of the verb
+ * @param cached   if not NULL, the verb data that vcbData is part of and
+ *                 that receives the permission of the verb when the
+ *                 decisions for it are cached
+ * @param lock     if not zero, a reference to configJ is taken
+ *
+ * @return NULL on success or an error string
+ */
+static const char* BinderAddOneVerb (AfbBinderHandleT *binder, afb_api_x4_t apiv4, json_object *configJ,
+        afb_req_callback_x4_t callback, void *vcbData, AclCachedVerbT *cached, int lock) {
     char *errorMsg=NULL;
     const char *uid=NULL, *verb=NULL, *info=NULL, *auth=NULL;
     const uint32_t session=0;
@@ -750,30 +1134,26 @@ const char* AfbAddOneVerb (AfbBinderHandleT *binder, afb_api_x4_t apiv4, json_ob
             errorMsg = "'auth/acl' is undefined";
             goto OnErrorExit;
         }
+        if (cached != NULL) {
+            /* the permission is checked by AclCacheVerbCb */
+            cached->binder = binder;
+            cached->callback = callback;
+            cached->auth = acl;
+            callback = AclCacheVerbCb;
+            acl = NULL;
+        }
     }
 
     /* create the verb */
     err= afb_api_v4_add_verb_hookable (apiv4, verb, info, callback, vcbData, acl, session, regex);
     if (err) {
-        switch (err) {
-        case X_EEXIST:
-            errorMsg = "verb already exists/registered";
-            break;
-        case X_ENOMEM:
-            errorMsg = "memory exhausted";
-            break;
-        case X_EPERM:
-            errorMsg = "permission denied";
-            break;
-        default:
-            errorMsg = strerror(-err);
-            break;
-        }
+        errorMsg = (char*)AddVerbErrorMsg(err);
         goto OnErrorExit;
     }
 
     /* lock the config */
-    json_object_get (configJ);
+    if (lock)
+        json_object_get (configJ);
     return NULL;
 
 OnErrorExit:
@@ -782,6 +1162,161 @@ OnErrorExit:
     return errorMsg;
 }
 
+/* add one verb to the given API */
+const char* AfbAddOneVerb (AfbBinderHandleT *binder, afb_api_x4_t apiv4, json_object *configJ,
+        afb_req_callback_x4_t callback, void *vcbData) {
+    return BinderAddOneVerb (binder, apiv4, configJ, callback, vcbData, NULL, 1);
+}
+
+/* get the index of an ACL */
+int AfbBinderAclIndex(AfbBinderHandleT *binder, const char *uid) {
+    int idx= binder->config.acls == NULL ? -1 : AfbAclIndex(binder->config.acls, uid, NULL);
+    return idx < 0 ? -1 : idx + 1;
+}
+
+/**
+ * @brief Arena holding the closures of verbs created together
+ *
+ * The closures of the verbs described by one JSON array are allocated
+ * in one block sized from the length of the array. The arena holds one
+ * reference on the JSON array, that the closures point to. The closures
+ * of a static table of verbs are allocated the same way, without JSON.
+ * The arenas are recorded by the binder for their API and released when
+ * the API is deleted by AfbApiDelete.
+ */
+typedef struct ClosureArenaS {
+
+    /** next arena of the binder */
+    struct ClosureArenaS *next;
+
+    /** the API of the verbs */
+    afb_api_x4_t apiv4;
+
+    /** the JSON configuration referenced by the closures */
+    json_object *configJ;
+
+    /** size of one closure */
+    size_t itemSize;
+
+    /** count of allocated closures */
+    size_t count;
+
+    /** count of available closures */
+    size_t size;
+
+    /** storage of the closures */
+    max_align_t items[];
+}
+    ClosureArenaT;
+
+/**
+ * @brief create an arena of a given count of closures
+ *
+ * @param configJ  the configuration referenced by the closures or NULL
+ * @param size     count of closures
+ * @param itemSize size of the closures
+ *
+ * @return the created arena or NULL when out of memory
+ */
+static ClosureArenaT *ClosureArenaCreateSized(json_object *configJ, size_t size, size_t itemSize) {
+    ClosureArenaT *arena;
+
+    arena = calloc(1, sizeof *arena + size * itemSize);
+    if (arena != NULL) {
+        arena->configJ = configJ;
+        arena->itemSize = itemSize;
+        arena->size = size;
+    }
+    return arena;
+}
+
+/**
+ * @brief create an arena for the closures of the JSON configuration
+ *
+ * @param configJ  the configuration, a single object or an array
+ * @param itemSize size of the closures
+ *
+ * @return the created arena or NULL when out of memory
+ */
+static ClosureArenaT *ClosureArenaCreate(json_object *configJ, size_t itemSize) {
+    size_t size = json_object_is_type(configJ, json_type_array) ? json_object_array_length(configJ) : 1;
+    return ClosureArenaCreateSized(configJ, size, itemSize);
+}
+
+/**
+ * @brief get a new zeroed closure from the arena
+ *
+ * @param arena the arena
+ *
+ * @return the closure or NULL when the arena is full
+ */
+static void *ClosureArenaAlloc(ClosureArenaT *arena) {
+    if (arena->count >= arena->size)
+        return NULL;
+    return (char*)arena->items + arena->itemSize * arena->count++;
+}
+
+/**
+ * @brief give back the last allocated closure if not used
+ *
+ * @param arena the arena
+ */
+static void ClosureArenaUnalloc(ClosureArenaT *arena) {
+    arena->count--;
+    memset((char*)arena->items + arena->itemSize * arena->count, 0, arena->itemSize);
+}
+
+/** protection of the lists of arenas of the binders */
+static pthread_mutex_t arenasMutex= PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief terminate the filling of the arena, recording it for the API if used
+ *
+ * @param binder the binder
+ * @param apiv4  the API of the closures
+ * @param arena  the arena
+ */
+static void ClosureArenaSeal(AfbBinderHandleT *binder, afb_api_x4_t apiv4, ClosureArenaT *arena) {
+    if (arena->count == 0) {
+        free(arena);
+        return;
+    }
+    json_object_get(arena->configJ);
+    arena->apiv4= apiv4;
+    pthread_mutex_lock(&arenasMutex);
+    arena->next= binder->arenas;
+    binder->arenas= arena;
+    pthread_mutex_unlock(&arenasMutex);
+}
+
+/**
+ * @brief release the arenas of the API
+ *
+ * @param binder the binder
+ * @param apiv4  the API
+ */
+static void ClosureArenasRelease(AfbBinderHandleT *binder, afb_api_x4_t apiv4) {
+    ClosureArenaT *arena, **prev, *released= NULL;
+
+    pthread_mutex_lock(&arenasMutex);
+    prev= &binder->arenas;
+    while ((arena= *prev) != NULL) {
+        if (arena->apiv4 != apiv4)
+            prev= &arena->next;
+        else {
+            *prev= arena->next;
+            arena->next= released;
+            released= arena;
+        }
+    }
+    pthread_mutex_unlock(&arenasMutex);
+    while ((arena= released) != NULL) {
+        released= arena->next;
+        json_object_put(arena->configJ);
+        free(arena);
+    }
+}
+
 /**
  * @brief Structure for creaating verbs in callback
  */
@@ -798,6 +1333,9 @@ typedef struct {
 
     /** the callback */
     afb_req_callback_x4_t callback;
+
+    /** arena of the closures */
+    ClosureArenaT *arena;
 }
     AddVerbsT;
 
@@ -810,7 +1348,16 @@ typedef struct {
  */
 static int AddVerbsCb(void *context, json_object *verbJ) {
     AddVerbsT *adder = (AddVerbsT*)context;
-    AfbVcbDataT *vcbData = calloc (1, sizeof(AfbVcbDataT));
+    AclCachedVerbT *cached = NULL;
+    AfbVcbDataT *vcbData;
+
+    /* when decisions are cached, the verb data is embedded in AclCachedVerbT */
+    if (adder->binder->config.aclCache > 0) {
+        cached = ClosureArenaAlloc (adder->arena);
+        vcbData = cached ? &cached->vcb : NULL;
+    }
+    else
+        vcbData = ClosureArenaAlloc (adder->arena);
 
     if (vcbData == NULL)
         adder->errorMsg = "out of memory";
@@ -818,9 +1365,8 @@ static int AddVerbsCb(void *context, json_object *verbJ) {
         vcbData->magic= (void*)AfbAddVerbs;
         vcbData->configJ= verbJ;
         vcbData->uid= json_object_get_string (json_object_object_get(verbJ, "uid"));
-        adder->errorMsg= AfbAddOneVerb (adder->binder, adder->apiv4, verbJ, adder->callback, vcbData);
-        if (adder->errorMsg) free(vcbData);
-        else json_object_get(verbJ);
+        adder->errorMsg= BinderAddOneVerb (adder->binder, adder->apiv4, verbJ, adder->callback, vcbData, cached, 0);
+        if (adder->errorMsg) ClosureArenaUnalloc (adder->arena);
     }
     return adder->errorMsg == NULL ? 0 : -1;
 }
@@ -833,10 +1379,72 @@ const char* AfbAddVerbs (AfbBinderHandleT *binder, afb_api_x4_t apiv4, json_obje
     adder.binder = binder;
     adder.apiv4 = apiv4;
     adder.callback = callback;
+    adder.arena = ClosureArenaCreate (configJ,
+                binder->config.aclCache > 0 ? sizeof(AclCachedVerbT) : sizeof(AfbVcbDataT));
+    if (adder.arena == NULL)
+        return "out of memory";
     rp_jsonc_optarray_until(configJ, AddVerbsCb, &adder);
+    ClosureArenaSeal (binder, apiv4, adder.arena);
     return adder.errorMsg;
 }
 
+/* add the verbs of the static table */
+const char* AfbAddVerbsStatic(AfbBinderHandleT *binder, afb_api_x4_t apiv4, const AfbVerbDescT *table, size_t count) {
+    afbAclsTableT *acls = binder->config.acls;
+    int cache = binder->config.aclCache > 0;
+    afb_req_callback_x4_t callback;
+    ClosureArenaT *arena;
+    AclCachedVerbT *cached;
+    AfbVcbDataT *vcbData;
+    const afb_auth *acl;
+    const char *errorMsg = NULL;
+    size_t idx;
+    int err;
+
+    arena = ClosureArenaCreateSized (NULL, count, cache ? sizeof(AclCachedVerbT) : sizeof(AfbVcbDataT));
+    if (arena == NULL)
+        return "out of memory";
+
+    for (idx = 0 ; idx < count ; idx++) {
+        if (table[idx].acl == 0)
+            acl = NULL;
+        else if (table[idx].acl > 0 && acls != NULL && (unsigned)table[idx].acl <= acls->count)
+            acl = &acls->entries[table[idx].acl - 1].perm;
+        else {
+            errorMsg = "'acl' index is undefined";
+            break;
+        }
+
+        /* when decisions are cached, the verb data is embedded in AclCachedVerbT */
+        vcbData = ClosureArenaAlloc (arena);
+        vcbData->magic = (void*)AfbAddVerbsStatic;
+        vcbData->uid = table[idx].verb;
+        vcbData->userdata = table[idx].vcbData;
+        callback = table[idx].callback;
+        if (acl != NULL && cache) {
+            /* the permission is checked by AclCacheVerbCb */
+            cached = (AclCachedVerbT*)vcbData;
+            cached->binder = binder;
+            cached->callback = callback;
+            cached->auth = acl;
+            callback = AclCacheVerbCb;
+            acl = NULL;
+        }
+
+        err = afb_api_v4_add_verb_hookable (apiv4, table[idx].verb, table[idx].info,
+                    callback, vcbData, acl, table[idx].session, table[idx].glob);
+        if (err) {
+            ClosureArenaUnalloc (arena);
+            errorMsg = AddVerbErrorMsg(err);
+            break;
+        }
+    }
+    ClosureArenaSeal (binder, apiv4, arena);
+    if (errorMsg != NULL)
+        LIBAFB_ERROR ("AfbAddVerbsStatic:fail verb=%s %s", table[idx].verb, errorMsg);
+    return errorMsg;
+}
+
 /* add one event handler */
 const char* AfbAddOneEvent (afb_api_x4_t apiv4, const char*uid, const char*pattern, afb_event_handler_x4_t callback, void *context) {
     int err = afb_api_v4_event_handler_add_hookable (apiv4, pattern ? pattern : "*", callback, context);
@@ -926,7 +1534,7 @@ static const char *AfbApiConfig (json_object *configJ, AfbApiConfigT *config) {
     // allocate config and set defaults
     memcpy (config, &apiConfigDflt, sizeof(AfbApiConfigT));
 
-    err= rp_jsonc_unpack (configJ, "{ss s?s s?s s?i s?s s?b s?o s?s s?s s?b s?o s?o s?s}"
+    err= rp_jsonc_unpack (configJ, "{ss s?s s?s s?i s?s s?b s?o s?s s?s s?b s?o s?o s?s s?b s?s s?s}"
         , "uid"    , &config->uid /* string */
         , "api"    , &config->api /* string */
         , "info"   , &config->info /* string */
@@ -940,9 +1548,17 @@ static const char *AfbApiConfig (json_object *configJ, AfbApiConfigT *config) {
         , "alias"  , &config->aliasJ /* object */
         , "events" , &config->eventsJ /* object */
         , "provide", &config->provide /* string */
+        , "seal"   , &config->seal /* boolean */
+        , "pool"   , &config->pool /* string */
+        , "priority", &config->priority /* string */
         );
     if (err) return "invalid api configuration";
 
+    if (config->priority) {
+        if (!config->pool) return "api priority requires a pool";
+        if (!afb_binder_pool_is_priority(config->priority)) return "invalid api priority";
+    }
+
     // if api not defined use uid
     if (!config->api)  config->api= config->uid;
 
@@ -1064,6 +1680,65 @@ OnErrorExit:
     return -1;
 }
 
+/**
+ * @brief node of the graph of the APIs started following their classes
+ */
+typedef struct AfbStartNodeS {
+    /** next node in creation order */
+    struct AfbStartNodeS *next;
+
+    /** name of the API */
+    const char *api;
+
+    /** provided classes */
+    const char *provide;
+
+    /** required classes */
+    const char *require;
+
+    /** nodes requiring a class provided by this one */
+    struct AfbStartNodeS **succs;
+
+    /** count of succs */
+    unsigned nsuccs;
+
+    /** count of providers not yet started */
+    unsigned pending;
+
+    /** state of the node: one of AFB_START_xxx */
+    int state;
+
+    /** status of afb_apiset_start_service */
+    int status;
+
+    /** the running graph */
+    struct AfbStartGraphS *graph;
+}
+    AfbStartNodeT;
+
+#define AFB_START_WAITING  0
+#define AFB_START_RUNNING  1
+#define AFB_START_DONE     2
+#define AFB_START_BLOCKED  3
+
+/**
+ * @brief record the API for starting it following its classes
+ *
+ * @param binder the binder
+ * @param config the config of the API
+ * @return 0 on success or -1 when out of memory
+ */
+static int StartNodeAdd (AfbBinderHandleT *binder, const AfbApiConfigT *config) {
+    AfbStartNodeT *node= calloc (1, sizeof(AfbStartNodeT));
+    if (node == NULL) return -1;
+    node->api= config->api;
+    node->provide= config->provide;
+    node->require= config->require;
+    *binder->startLast= node;
+    binder->startLast= &node->next;
+    return 0;
+}
+
 /* create an API Accordingly to what configJ describes */
 const char* AfbApiCreate (AfbBinderHandleT *binder, json_object *configJ, afb_api_x4_t *apiv4,
     afb_api_callback_x4_t usrApiCb, afb_req_callback_x4_t usrInfoCb, afb_req_callback_x4_t usrRqtCb,
@@ -1071,6 +1746,7 @@ const char* AfbApiCreate (AfbBinderHandleT *binder, json_object *configJ, afb_ap
     int err, status;
     const char *errorMsg=NULL;;
     AfbApiInitT apiInit;
+    struct afb_apiset *apiSet;
 
     /* check argument */
     if (binder == NULL) {
@@ -1110,8 +1786,18 @@ const char* AfbApiCreate (AfbBinderHandleT *binder, json_object *configJ, afb_ap
             goto OnErrorExit;
     }
 
+    /* APIs of a pool are first declared in a private set */
+    apiSet= apiInit.apiDeclSet;
+    if (apiInit.config.pool) {
+        apiSet= afb_apiset_create (apiInit.config.api, binder->config.timeout);
+        if (!apiSet) {
+            errorMsg= "out of memory";
+            goto OnErrorExit;
+        }
+    }
+
     // register API
-    status = afb_api_v4_create (apiv4, apiInit.apiDeclSet, apiInit.apiCallSet,
+    status = afb_api_v4_create (apiv4, apiSet, apiInit.apiCallSet,
                                     apiInit.config.api, Afb_String_Const,
                                     apiInit.config.info, Afb_String_Const,
                                     apiInit.config.noconcurency,
@@ -1119,10 +1805,21 @@ const char* AfbApiCreate (AfbBinderHandleT *binder, json_object *configJ, afb_ap
                                     NULL, Afb_String_Const  // no binding.so path
     );
     if (status) {
+        if (apiInit.config.pool) afb_apiset_unref (apiSet);
         errorMsg= apiInit.errorMsg ?: "Unknown error from afb_api_v4_create";
         goto OnErrorExit;
     }
 
+    /* make the API available through its pool */
+    if (apiInit.config.pool) {
+        status= afb_binder_pool_declare (apiInit.config.pool, apiInit.config.priority, apiSet, apiInit.apiDeclSet);
+        afb_apiset_unref (apiSet);
+        if (status < 0) {
+            errorMsg= "can't put api in its pool";
+            goto OnErrorCleanAndExit;
+        }
+    }
+
     /* add HTTP aliases if needed */
     if (apiInit.config.aliasJ) {
         if (rp_jsonc_optarray_until(apiInit.config.aliasJ, BinderAddOneAlias, binder) < 0) {
@@ -1140,18 +1837,40 @@ const char* AfbApiCreate (AfbBinderHandleT *binder, json_object *configJ, afb_ap
         }
     }
 
+    /* record its classes for a parallel start */
+    if (binder->config.parallelStart && StartNodeAdd (binder, &apiInit.config) < 0) {
+        errorMsg= "out of memory";
+        goto OnErrorCleanAndExit;
+    }
+
     /* lock config */
     json_object_get (configJ);
     return NULL;
 
 OnErrorCleanAndExit:
+    afb_apiset_del(apiInit.apiDeclSet, afb_api_v4_name(*apiv4));
     afb_api_v4_unref(*apiv4);
+    ClosureArenasRelease(binder, *apiv4);
 
 OnErrorExit:
     *apiv4=NULL;
     return errorMsg;
 }
 
+/* delete the API created by AfbApiCreate */
+const char* AfbApiDelete (AfbBinderHandleT *binder, afb_api_x4_t apiv4) {
+    afb_apiset *sets[]= { binder->publicApis, binder->restrictedApis, binder->privateApis };
+    const char *name= afb_api_v4_name(apiv4);
+    size_t idx;
+
+    for (idx= 0; idx < sizeof sets / sizeof *sets && afb_apiset_del(sets[idx], name) < 0; idx++);
+    if (idx == sizeof sets / sizeof *sets)
+        return "api not declared by the binder";
+    afb_api_v4_unref(apiv4);
+    ClosureArenasRelease(binder, apiv4);
+    return NULL;
+}
+
 /* import the API described by JSON configJ */
 const char* AfbApiImport (AfbBinderHandleT *binder, json_object *configJ) {
     int err, index;
@@ -1240,6 +1959,7 @@ static char* AfbBinderHttpd(AfbBinderHandleT *binder) {
     }
 
     // initialize the cache timeout
+    afb_binder_static_setup(binder->config.httpd.staticFiles, binder->config.httpd.timeout.cache);
     if (!afb_hsrv_set_cache_timeout(binder->hsrv, binder->config.httpd.timeout.cache)) {
         errorMsg= "Allocating afb_hsrv_create";
         goto OnErrorExit;
@@ -1247,21 +1967,27 @@ static char* AfbBinderHttpd(AfbBinderHandleT *binder) {
 
     // set the root api handlers for http websock
 #if LIBAFB_BEFORE_VERSION(5,0,11)
-    if (!afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_hswitch_websocket_switch, binder->publicApis, 20)) {
+    if (!afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_hswitch_websocket_switch, binder->httpApis, 20)) {
         errorMsg= "Allocating afb_hswitch_websocket_switch";
 #else
-    if (!afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_hswitch_upgrade, binder->publicApis, 20)) {
+    if (!afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_hswitch_upgrade, binder->httpApis, 20)) {
         errorMsg= "Allocating afb_hswitch_upgrade";
 #endif
         goto OnErrorExit;
     }
 
     // set root api for http rest
-    if (!afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_hswitch_apis,binder->publicApis, 10)) {
+    if (!afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_hswitch_apis,binder->httpApis, 10)) {
         errorMsg= "Allocating afb_hswitch_apis";
         goto OnErrorExit;
     }
 
+    // reply 503 to the calls shed by the overload policy
+    if (afb_binder_overload_is_active() && !afb_hsrv_add_handler(binder->hsrv, binder->config.httpd.rootapi, afb_binder_overload_http, NULL, 30)) {
+        errorMsg= "Allocating overload handler";
+        goto OnErrorExit;
+    }
+
     // set OnePageApp rootdir
     if (!afb_hsrv_add_handler(binder->hsrv,  binder->config.httpd.onepage, afb_hswitch_one_page_api_redirect, NULL, -20)) {
         errorMsg= "Allocating one_page_api_redirect";
@@ -1277,7 +2003,9 @@ static char* AfbBinderHttpd(AfbBinderHandleT *binder) {
         }
     }
 
-    // set server rootdir path
+    // set server rootdir path, its static files being served from memory
+    if (afb_binder_static_add(binder->hsrv, "", afb_common_rootdir_get_fd(), binder->config.httpd.basedir, -9) < 0)
+        LIBAFB_WARNING("AfbBinderHttpd: can't serve static files of [%s] from memory", binder->config.httpd.basedir);
     status= afb_hsrv_add_alias(binder->hsrv, "", afb_common_rootdir_get_fd(), binder->config.httpd.basedir, -10, 1);
     if (status != AFB_HSRV_OK) {
         errorMsg= "Registering httpd basedir";
@@ -1329,15 +2057,131 @@ OnErrorExit:
  * @brief structure for searching paths
  */
 typedef struct {
+    /** the binder */
+    AfbBinderHandleT *binder;
     /** the base filename to search */
     const char *filename;
     /** the built path searched for */
     char path[PATH_MAX + 1];
 } ScanPathT;
 
+/**
+ * @brief index of the entries of a directory of ldpath
+ */
+typedef struct LdpathDirS {
+    /** next indexed directory */
+    struct LdpathDirS *next;
+
+    /** count of entries */
+    size_t count;
+
+    /** sorted names of the entries */
+    char **names;
+
+    /** path of the directory */
+    char path[];
+} LdpathDirT;
+
+/**
+ * @brief protection of the ldpathDirs of binders
+ */
+static pthread_mutex_t ldpathMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int LdpathCmpName (const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/**
+ * @brief free the index of a directory
+ *
+ * @param dir the index to free
+ */
+static void LdpathDirFree (LdpathDirT *dir) {
+    while (dir->count) free(dir->names[--dir->count]);
+    free(dir->names);
+    free(dir);
+}
+
+/**
+ * @brief drop the index of the ldpath directories of the binder
+ *
+ * The index is only valid while the binder is configured, as the
+ * directories may change later. Once the binder is started, bindings
+ * are searched directly in the file system.
+ *
+ * @param binder the binder
+ */
+static void LdpathDirsDrop (AfbBinderHandleT *binder) {
+    LdpathDirT *dir;
+
+    pthread_mutex_lock(&ldpathMutex);
+    binder->ldpathUnindexed= 1;
+    while ((dir= binder->ldpathDirs) != NULL) {
+        binder->ldpathDirs= dir->next;
+        LdpathDirFree(dir);
+    }
+    pthread_mutex_unlock(&ldpathMutex);
+}
+
+/**
+ * @brief get the index of the directory of path, reading it at first use
+ *
+ * @param binder the binder
+ * @param path the path of the directory
+ * @return the index or NULL when it can't be built
+ */
+static LdpathDirT *LdpathDirGet (AfbBinderHandleT *binder, const char *path) {
+    LdpathDirT *dir;
+    DIR *dirp;
+    struct dirent *ent;
+    char **names;
+    size_t alloc= 0, len;
+
+    if (binder->ldpathUnindexed) return NULL;
+    for (dir= binder->ldpathDirs; dir != NULL; dir= dir->next)
+        if (!strcmp(dir->path, path)) return dir;
+
+    len= strlen(path);
+    dir= calloc(1, sizeof *dir + len + 1);
+    if (dir == NULL) goto OnErrorExit;
+    memcpy(dir->path, path, len + 1);
+
+    // a directory that can't be opened is indexed empty
+    dirp= opendir(path);
+    if (dirp != NULL) {
+        while ((ent= readdir(dirp)) != NULL) {
+            if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+            if (dir->count == alloc) {
+                alloc= alloc ? 2 * alloc : 32;
+                names= realloc(dir->names, alloc * sizeof *names);
+                if (names == NULL) break;
+                dir->names= names;
+            }
+            dir->names[dir->count]= strdup(ent->d_name);
+            if (dir->names[dir->count] == NULL) break;
+            dir->count++;
+        }
+        closedir(dirp);
+        if (ent != NULL) goto OnErrorExit;
+        qsort(dir->names, dir->count, sizeof *dir->names, LdpathCmpName);
+    }
+
+    dir->next= binder->ldpathDirs;
+    binder->ldpathDirs= dir;
+    return dir;
+
+OnErrorExit:
+    if (dir != NULL) LdpathDirFree(dir);
+    return NULL;
+}
+
 /**
  * @brief search for file within dirnameJ returns an open file decriptor on file when exist
  *
+ * Until the binder starts, plain filenames are first searched in the index
+ * of the directory, avoiding to check the file system for directories not
+ * having it.
+ *
  * @param context the search structure
  * @param dirnameJ the JSON path to check
  * @return 0 to continue searching or 1 if match found
@@ -1345,6 +2189,17 @@ typedef struct {
 static int ScanPathCb (void *context, json_object *dirnameJ) {
     ScanPathT *scanner = (ScanPathT*)context;
     const char* dirname= json_object_get_string(dirnameJ);
+    LdpathDirT *dir;
+    int candidate;
+
+    if (strchr(scanner->filename, '/') == NULL) {
+        pthread_mutex_lock(&ldpathMutex);
+        dir= LdpathDirGet(scanner->binder, dirname);
+        candidate= dir == NULL || NULL != bsearch(&scanner->filename, dir->names,
+                                                  dir->count, sizeof *dir->names, LdpathCmpName);
+        pthread_mutex_unlock(&ldpathMutex);
+        if (!candidate) return 0;
+    }
     snprintf(scanner->path, sizeof scanner->path, "%s/%s", dirname, scanner->filename);
     return 0 == access(scanner->path, R_OK);
 }
@@ -1352,10 +2207,11 @@ static int ScanPathCb (void *context, json_object *dirnameJ) {
 /* load a binding as described by bindingJ */
 const char* AfbBindingLoad (AfbBinderHandleT *binder, json_object *bindingJ) {
     const char *errorMsg=NULL, *uri=NULL;
-    afb_apiset *apiDeclSet, *apiCallSet;
+    afb_apiset *apiDeclSet, *apiCallSet, *apiLoadSet;
     int err;
-    const char *uid=NULL, *libpath, *export=NULL;
+    const char *uid=NULL, *libpath, *export=NULL, *api=NULL, *pool=NULL, *priority=NULL;
     json_object *aliasJ=NULL, *ldpathJ=NULL;
+    int lazy=0;
     ScanPathT scanner;
 
     /* check argument */
@@ -1365,18 +2221,26 @@ const char* AfbBindingLoad (AfbBinderHandleT *binder, json_object *bindingJ) {
     }
 
     /* extract api specification */
-    err= rp_jsonc_unpack (bindingJ, "{ss ss s?s s?s s?o s?o}"
+    err= rp_jsonc_unpack (bindingJ, "{ss ss s?s s?s s?o s?o s?b s?s s?s s?s}"
         , "uid"    , &uid     /* string */
         , "path"   , &libpath /* string */
         , "export" , &export  /* string */
         , "uri"    , &uri     /* string */
         , "ldpath" , &ldpathJ /* object */
         , "alias"  , &aliasJ  /* object */
+        , "lazy"   , &lazy    /* boolean */
+        , "api"    , &api     /* string */
+        , "pool"   , &pool    /* string */
+        , "priority", &priority /* string */
     );
     if (err) {
         errorMsg= "fail parsing json binding config";
         goto OnErrorExit;
     }
+    if (priority && !pool) {
+        errorMsg= "binding priority requires a pool";
+        goto OnErrorExit;
+    }
 
     /* compute declare set and call set */
     apiCallSet= binder->privateApis;
@@ -1413,6 +2277,7 @@ const char* AfbBindingLoad (AfbBinderHandleT *binder, json_object *bindingJ) {
     }
 
     // try to locate the binding within binding/binder ldpath
+    scanner.binder = binder;
     scanner.filename = libpath;
     if (libpath[0] != '/') {
         err = ldpathJ == NULL ? 0 : rp_jsonc_optarray_until (ldpathJ, ScanPathCb, &scanner);
@@ -1421,11 +2286,33 @@ const char* AfbBindingLoad (AfbBinderHandleT *binder, json_object *bindingJ) {
         if (err != 0) scanner.filename = scanner.path;
     }
 
-    // open the binding
-    err= afb_api_so_add_binding_config(scanner.filename, apiDeclSet, apiCallSet, bindingJ);
+    /* APIs of a binding of a pool are first declared in a private set */
+    apiLoadSet= apiDeclSet;
+    if (pool) {
+        apiLoadSet= afb_apiset_create (uid, binder->config.timeout);
+        if (!apiLoadSet) {
+            errorMsg= "out of memory";
+            goto OnErrorExit;
+        }
+    }
+
+    // open the binding now or declare its API for opening it at first call
+    if (lazy)
+        err= afb_binder_lazy_add(api ?: uid, scanner.filename, apiLoadSet, apiCallSet, bindingJ);
+    else
+        err= afb_api_so_add_binding_config(scanner.filename, apiLoadSet, apiCallSet, bindingJ);
+
+    /* make its APIs available through the pool */
+    if (pool) {
+        if (!err) {
+            err= afb_binder_pool_declare (pool, priority, apiLoadSet, apiDeclSet);
+            if (err) errorMsg= "can't put binding in its pool";
+        }
+        afb_apiset_unref (apiLoadSet);
+    }
     if (err) {
         LIBAFB_ERROR ("AfbBindingLoad:fatal [uid=%s] can't open %s", uid, libpath);
-        errorMsg= "binding load fail";
+        errorMsg= errorMsg ?: "binding load fail";
         goto OnErrorExit;
     }
 
@@ -1474,7 +2361,7 @@ static int BinderParseConfig (json_object *configJ, AfbBinderConfigT *config) {
     // allocate config and set defaults
     memcpy (config, &binderConfigDflt, sizeof(AfbBinderConfigT));
 
-    err= rp_jsonc_unpack (configJ, "{ss s?s s?i s?i s?b s?i s?s s?s s?s s?s s?s s?o s?o s?o s?o s?o s?i s?i s?b s?o s?o !}"
+    err= rp_jsonc_unpack (configJ, "{ss s?s s?i s?i s?b s?i s?s s?s s?s s?s s?s s?b s?o s?o s?o s?o s?o s?i s?i s?i s?o s?s s?s s?s s?i s?b s?o s?s s?i s?b s?s s?s s?o !}"
         , "uid",         &config->uid            /* string */
         , "info",        &config->info           /* string */
         , "verbose",     &config->verbose        /* integer */
@@ -1486,6 +2373,7 @@ static int BinderParseConfig (json_object *configJ, AfbBinderConfigT *config) {
         , "rootdir",     &config->rootdir        /* string */
         , "https-cert",  &config->httpd.cert     /* string */
         , "https-key",   &config->httpd.key      /* string */
+        , "static-files", &config->httpd.staticFiles /* boolean */
         , "alias",       &config->httpd.aliasJ   /* object: string or array of string */
         , "intf",        &config->httpd.intfJ    /* object: string or array of string */
         , "extensions",  &config->extendJ        /* object: dictionnary */
@@ -1493,8 +2381,19 @@ static int BinderParseConfig (json_object *configJ, AfbBinderConfigT *config) {
         , "acls",        &aclsJ                  /* object: dictionnary */
         , "thread-pool", &config->poolThreadSize /* integer */
         , "thread-max" , &config->poolThreadMax  /* integer */
+        , "thread-autoscale", &config->threadAutoscale /* integer */
+        , "pools",       &config->poolsJ         /* object: string or array of pool specifications */
+        , "jobs-overflow", &config->jobsOverflow /* string */
+        , "session-rate", &config->sessionRate   /* string */
+        , "interface-rate", &config->interfaceRate /* string */
+        , "fair-queue",  &config->fairQueue      /* integer */
         , "trapfaults",  &config->trapfaults     /* boolean */
         , "set",         &config->settingsJ      /* object: settings */
+        , "stats",       &config->stats          /* string: private, restricted or public */
+        , "acl-cache",   &config->aclCache       /* integer */
+        , "parallel-start", &config->parallelStart /* boolean */
+        , "threads-cpus", &config->threadCpus    /* string */
+        , "numa-policy", &config->numaPolicy     /* string */
         , "onerror",     &ignoredJ               /* object: legacy, ignored */
         );
     if (err) goto OnErrorExit;
@@ -1513,6 +2412,10 @@ static int BinderParseConfig (json_object *configJ, AfbBinderConfigT *config) {
         config->poolThreadMax = 1;
     if (config->poolThreadMax < config->poolThreadSize)
         config->poolThreadSize = config->poolThreadMax;
+
+    /* autoscaling is sampled by a job: unless given, keep enough threads for synchronous calls */
+    if (config->threadAutoscale >= 0 && !json_object_object_get_ex(configJ, "thread-pool", NULL))
+        config->poolThreadSize = DEFAULT_THREADS_MAX;
     return 0;
 
 OnErrorExit:
@@ -1532,6 +2435,7 @@ const char* AfbBinderConfig (json_object *configJ, AfbBinderHandleT **handle, vo
         errorMsg= "can't allocate binder data structures";
         goto OnErrorExit;
     }
+    binder->startLast= &binder->startNodes;
 
     /* parse the config */
     status= BinderParseConfig (configJ, &binder->config);
@@ -1562,6 +2466,7 @@ const char* AfbBinderConfig (json_object *configJ, AfbBinderHandleT **handle, vo
         errorMsg= "can't create public apiset";
         goto OnErrorExit;
     }
+    binder->httpApis= binder->publicApis;
 
     // setup global private api to handle events
     status = afb_api_v4_create (&binder->apiv4, binder->privateApis, binder->privateApis,
@@ -1640,6 +2545,53 @@ const char* AfbBinderConfig (json_object *configJ, AfbBinderHandleT **handle, vo
         }
         afb_hook_create_global(traceFlags, NULL, NULL);
     }
+
+    /* setup the statistics of verbs */
+    if (binder->config.stats) {
+        switch (utilLabel2Value (afbApiExportKeys, binder->config.stats)) {
+            case AFB_EXPORT_PRIVATE:
+                status = afb_binder_stats_init ("stats", binder->privateApis, binder->privateApis);
+                break;
+            case AFB_EXPORT_RESTRICTED:
+                status = afb_binder_stats_init ("stats", binder->restrictedApis, binder->privateApis);
+                break;
+            case AFB_EXPORT_PUBLIC:
+                status = afb_binder_stats_init ("stats", binder->publicApis, binder->privateApis);
+                break;
+            default:
+                errorMsg= "invalid stats export";
+                goto OnErrorExit;
+        }
+        if (status < 0) {
+            errorMsg= "failed to setup statistics";
+            goto OnErrorExit;
+        }
+    }
+    /* create the worker pools */
+    if (binder->config.poolsJ) {
+        if (rp_jsonc_optarray_until (binder->config.poolsJ, BinderAddOnePool, binder) < 0) {
+            errorMsg= "failed to create worker pools";
+            goto OnErrorExit;
+        }
+    }
+
+    /* gate the HTTP calls with the admission policies */
+    if (binder->config.jobsOverflow && afb_binder_overload_setup (binder->config.jobsOverflow) < 0) {
+        errorMsg= "invalid jobs-overflow";
+        goto OnErrorExit;
+    }
+    if (afb_binder_fair_setup (binder->config.sessionRate, binder->config.interfaceRate, binder->config.fairQueue) < 0) {
+        errorMsg= "invalid session-rate, interface-rate or fair-queue";
+        goto OnErrorExit;
+    }
+    if (afb_binder_overload_is_active() || afb_binder_fair_is_active()) {
+        binder->httpApis= afb_binder_overload_gate ("http", binder->publicApis);
+        if (!binder->httpApis) {
+            errorMsg= "failed to create the overload gate";
+            goto OnErrorExit;
+        }
+    }
+
     /* load the extensions if existing */
     if (binder->config.extendJ) {
 #if WITH_EXTENSION
@@ -1734,6 +2686,212 @@ OnErrorExit:
     return -1;
 }
 
+/**
+ * @brief state of the start of the graph of APIs
+ */
+typedef struct AfbStartGraphS {
+    /** the apiset of the APIs */
+    afb_apiset *apiset;
+
+    /** the nodes in creation order */
+    AfbStartNodeT *nodes;
+
+    /** protection of the nodes */
+    pthread_mutex_t mutex;
+
+    /** lock of the scheduler released when all is done */
+    struct afb_sched_lock *lock;
+
+    /** count of APIs currently starting */
+    unsigned running;
+}
+    AfbStartGraphT;
+
+/** separators of class names */
+#define CLASS_SEPARATORS ", \t"
+
+/* check if the class name of length len is in the list */
+static int StartClassIn (const char *list, const char *name, size_t len) {
+    size_t n;
+    while (list && *list) {
+        list += strspn (list, CLASS_SEPARATORS);
+        n= strcspn (list, CLASS_SEPARATORS);
+        if (n == len && !memcmp (list, name, len)) return 1;
+        list += n;
+    }
+    return 0;
+}
+
+/* link the providers of classes to the nodes requiring them */
+static int StartGraphLink (AfbStartNodeT *nodes) {
+    AfbStartNodeT *node, *prov, **succs;
+    const char *req;
+    size_t len;
+
+    for (node= nodes; node; node= node->next) {
+        for (req= node->require; req && *req; req += len) {
+            req += strspn (req, CLASS_SEPARATORS);
+            len= strcspn (req, CLASS_SEPARATORS);
+            if (len == 0) continue;
+            for (prov= nodes; prov; prov= prov->next) {
+                if (prov == node || !StartClassIn (prov->provide, req, len)) continue;
+                succs= realloc (prov->succs, (prov->nsuccs + 1) * sizeof *succs);
+                if (succs == NULL) return -1;
+                succs[prov->nsuccs++]= node;
+                prov->succs= succs;
+                node->pending++;
+            }
+        }
+    }
+    return 0;
+}
+
+static void StartNodePostLocked (AfbStartNodeT *node);
+
+/* mark the node and the nodes depending on it as not startable */
+static void StartNodeBlockLocked (AfbStartNodeT *node) {
+    if (node->state != AFB_START_WAITING) return;
+    node->state= AFB_START_BLOCKED;
+    for (unsigned idx=0; idx < node->nsuccs; idx++)
+        StartNodeBlockLocked (node->succs[idx]);
+}
+
+/* record the start status of the node and release the nodes waiting for it */
+static void StartNodeDoneLocked (AfbStartNodeT *node, int status) {
+    node->state= AFB_START_DONE;
+    node->status= status;
+    for (unsigned idx=0; idx < node->nsuccs; idx++) {
+        AfbStartNodeT *succ= node->succs[idx];
+        if (status < 0)
+            StartNodeBlockLocked (succ);
+        else if (succ->state == AFB_START_WAITING && --succ->pending == 0)
+            StartNodePostLocked (succ);
+    }
+}
+
+/* job starting the API of the node */
+static void StartNodeJobCb (int signum, void *arg) {
+    AfbStartNodeT *node= (AfbStartNodeT*) arg;
+    AfbStartGraphT *graph= node->graph;
+    int status;
+
+    status= signum ? -1 : afb_apiset_start_service (graph->apiset, node->api);
+
+    pthread_mutex_lock (&graph->mutex);
+    graph->running--;
+    StartNodeDoneLocked (node, status);
+    if (graph->running == 0)
+        afb_sched_leave (graph->lock);
+    pthread_mutex_unlock (&graph->mutex);
+}
+
+/* queue the start of the API of the node */
+static void StartNodePostLocked (AfbStartNodeT *node) {
+    AfbStartGraphT *graph= node->graph;
+    int status;
+
+    node->state= AFB_START_RUNNING;
+    graph->running++;
+    status= afb_sched_post_job (NULL, 0, 0, StartNodeJobCb, node, Afb_Sched_Mode_Start);
+    if (status < 0) {
+        graph->running--;
+        StartNodeDoneLocked (node, status);
+    }
+}
+
+/* entering the synchronous start, queue the APIs not requiring others */
+static void StartGraphEnterCb (int signum, void *closure, struct afb_sched_lock *lock) {
+    AfbStartGraphT *graph= (AfbStartGraphT*) closure;
+
+    pthread_mutex_lock (&graph->mutex);
+    graph->lock= lock;
+    if (signum == 0) {
+        for (AfbStartNodeT *node= graph->nodes; node; node= node->next)
+            if (node->state == AFB_START_WAITING && node->pending == 0)
+                StartNodePostLocked (node);
+    }
+    if (graph->running == 0)
+        afb_sched_leave (lock);
+    pthread_mutex_unlock (&graph->mutex);
+}
+
+/**
+ * @brief start the APIs recorded with their classes, running concurrently
+ * the initialisation of the APIs not depending on each other. The APIs
+ * whose classes are not known are first started in order. Failures and
+ * cycles are reported in the order of creation of the APIs.
+ *
+ * @param binder the binder
+ * @return 0 on success or a negative value on error
+ */
+static int BinderStartParallel (AfbBinderHandleT *binder) {
+    AfbStartGraphT graph;
+    AfbStartNodeT *node;
+    const char **names;
+    int status, index, errcount= 0;
+
+    /* link the providers to the APIs requiring their classes */
+    if (StartGraphLink (binder->startNodes) < 0) {
+        LIBAFB_ERROR ("out of memory while starting APIs");
+        return -1;
+    }
+
+    /* start in order the APIs whose classes are not known */
+    names= afb_apiset_get_names (binder->privateApis, 1, 1);
+    if (names == NULL) {
+        LIBAFB_ERROR ("out of memory while starting APIs");
+        return -1;
+    }
+    for (index= 0; names[index]; index++) {
+        for (node= binder->startNodes; node && strcasecmp (node->api, names[index]); node= node->next);
+        if (node == NULL) {
+            status= afb_apiset_start_service (binder->privateApis, names[index]);
+            if (status < 0) {
+                LIBAFB_ERROR ("api %s failed to start", names[index]);
+                free (names);
+                return status;
+            }
+        }
+    }
+    free (names);
+
+    /* start the graph */
+    memset (&graph, 0, sizeof graph);
+    graph.apiset= binder->privateApis;
+    graph.nodes= binder->startNodes;
+    pthread_mutex_init (&graph.mutex, NULL);
+    for (node= graph.nodes; node; node= node->next)
+        node->graph= &graph;
+    status= afb_sched_enter (NULL, 0, StartGraphEnterCb, &graph);
+    pthread_mutex_destroy (&graph.mutex);
+    if (status < 0) {
+        LIBAFB_ERROR ("can't start APIs in parallel");
+        return status;
+    }
+
+    /* report errors in order */
+    for (node= graph.nodes; node; node= node->next) {
+        switch (node->state) {
+        case AFB_START_DONE:
+            if (node->status >= 0) break;
+            LIBAFB_ERROR ("api %s failed to start", node->api);
+            errcount++;
+            break;
+        case AFB_START_BLOCKED:
+            LIBAFB_ERROR ("api %s not started: a provider of its classes [%s] failed", node->api, node->require);
+            errcount++;
+            break;
+        default:
+            LIBAFB_ERROR ("api %s not started: circular dependency of its classes [%s]", node->api, node->require);
+            errcount++;
+            break;
+        }
+        free (node->succs);
+        node->succs= NULL;
+        node->nsuccs= 0;
+    }
+    return errcount ? -1 : 0;
+}
 /**
 * @brief structure for starting 
 */
@@ -1769,6 +2927,15 @@ void BinderStartCb (int signum, void *context) {
         goto OnErrorExit;
     }
 
+    // adapt the count of threads of the scheduler if required
+    if (binder->config.threadAutoscale > 0 && signum == 0) {
+        status= afb_binder_autoscale_start (binder->config.poolThreadSize, binder->config.threadAutoscale);
+        if (status < 0) {
+            errorMsg= "failed to start autoscaling of threads";
+            goto OnErrorExit;
+        }
+    }
+
 #if WITH_EXTENSION
     /* declare extensions */
     status = afb_extend_declare(binder->privateApis, binder->privateApis);
@@ -1785,6 +2952,22 @@ void BinderStartCb (int signum, void *context) {
 #endif
 #endif
 
+    // start concurrently the APIs declaring classes if required
+    if (binder->config.parallelStart && signum == 0) {
+        status= BinderStartParallel (binder);
+        if (status) {
+            errorMsg= "failed to start services in parallel";
+            goto OnErrorExit;
+        }
+    }
+
+    // make the declared APIs available through the overload gate
+    status= afb_binder_overload_fill ();
+    if (status < 0) {
+        errorMsg= "failed to gate APIs";
+        goto OnErrorExit;
+    }
+
     // resolve dependencies and start binding services
     status= afb_apiset_start_all_services (binder->privateApis);
     if (status) {
@@ -1868,6 +3051,19 @@ int AfbBinderStart (AfbBinderHandleT *binder, void *config, AfbStartupCb callbac
     binderCtx.context=context;
     binderCtx.callback= callback;
 
+    // the bindings are loaded, the ldpath directories may now change
+    LdpathDirsDrop(binder);
+
+    // scheduler threads inherit the placement of the starting thread
+    if (afb_binder_affinity_set(binder->config.threadCpus, binder->config.numaPolicy) < 0)
+        return -1;
+
+    // autoscaling runs from thread-pool up to its given or deduced maximum
+    if (binder->config.threadAutoscale >= 0) {
+        afb_binder_autoscale_bounds(&binder->config.poolThreadSize, &binder->config.threadAutoscale);
+        binder->config.poolThreadMax= binder->config.threadAutoscale;
+    }
+
     int status= afb_sched_start(
                     binder->config.poolThreadMax,
                     binder->config.poolThreadSize,
@@ -1885,23 +3081,329 @@ int AfbBinderEnter (AfbBinderHandleT *binder, void *config, AfbStartupCb callbac
     binderCtx.context=context;
     binderCtx.callback= callback;
 
+    LdpathDirsDrop(binder);
+    if (afb_binder_affinity_set(binder->config.threadCpus, binder->config.numaPolicy) < 0)
+        return -1;
+
     BinderStartCb(-1, &binderCtx);
     return 0;
 }
 
+/**
+ * @brief a host thread joined as a worker of the scheduler
+ */
+typedef struct AfbWorkerS {
+    /** next worker of the binder */
+    struct AfbWorkerS *next;
+
+    /** the binder */
+    AfbBinderHandleT *binder;
+
+    /** the flag telling the worker to leave */
+    int *until;
+
+    /** lock of the scheduler held while working, NULL when not entered */
+    struct afb_sched_lock *lock;
+}
+    AfbWorkerT;
+
+/** protection of the list of workers */
+static pthread_mutex_t binderWorkersMutex= PTHREAD_MUTEX_INITIALIZER;
+
+/* the worker entered the scheduler, it runs jobs until leaving */
+static void BinderWorkerEnterCb (int signum, void *closure, struct afb_sched_lock *lock) {
+    AfbWorkerT *worker= (AfbWorkerT*) closure;
+
+    pthread_mutex_lock (&binderWorkersMutex);
+    worker->lock= lock;
+    if (signum || *worker->until || worker->binder->exiting) {
+        worker->lock= NULL;
+        afb_sched_leave (lock);
+    }
+    pthread_mutex_unlock (&binderWorkersMutex);
+}
+
+/* make the workers waiting for the flag until (or all if NULL) leave, must be locked */
+static void BinderWorkersLeaveLocked (AfbBinderHandleT *binder, int *until) {
+    for (AfbWorkerT *worker= binder->workers; worker; worker= worker->next) {
+        if ((until == NULL || worker->until == until) && worker->lock) {
+            afb_sched_leave (worker->lock);
+            worker->lock= NULL;
+        }
+    }
+}
+
+// run jobs of the scheduler in the calling thread until AfbBinderLeaveWorker
+int AfbBinderJoinWorker (AfbBinderHandleT *binder, int *until) {
+    AfbWorkerT worker, **prev;
+    int status;
+
+    worker.binder= binder;
+    worker.until= until;
+    worker.lock= NULL;
+    pthread_mutex_lock (&binderWorkersMutex);
+    if (*until || binder->exiting) {
+        pthread_mutex_unlock (&binderWorkersMutex);
+        return 0;
+    }
+    worker.next= binder->workers;
+    binder->workers= &worker;
+    pthread_mutex_unlock (&binderWorkersMutex);
+
+    status= afb_sched_enter (NULL, 0, BinderWorkerEnterCb, &worker);
+
+    pthread_mutex_lock (&binderWorkersMutex);
+    for (prev= &binder->workers; *prev != &worker; prev= &(*prev)->next);
+    *prev= worker.next;
+    pthread_mutex_unlock (&binderWorkersMutex);
+    if (status < 0)
+        LIBAFB_ERROR ("AfbBinderJoinWorker: can't enter the scheduler");
+    return status;
+}
+
+// tell the workers joined with the flag until to leave
+void AfbBinderLeaveWorker (AfbBinderHandleT *binder, int *until) {
+    pthread_mutex_lock (&binderWorkersMutex);
+    *until= 1;
+    BinderWorkersLeaveLocked (binder, until);
+    pthread_mutex_unlock (&binderWorkersMutex);
+}
+
 // Force mainloop exit
 void AfbBinderExit(AfbBinderHandleT *binder, int exitcode) {
+    pthread_mutex_lock (&binderWorkersMutex);
+    binder->exiting= 1;
+    BinderWorkersLeaveLocked (binder, NULL);
+    pthread_mutex_unlock (&binderWorkersMutex);
 #if WITH_EXTENSION
     afb_extend_exit(binder->privateApis);
 #endif
     afb_sched_exit (0, NULL /*callback*/, NULL/*context*/, exitcode);
 }
 
+/** state of the watcher signaling the wakeup fd */
+typedef enum {
+    /** the host loop is running jobs */
+    BINDER_WAKE_HOST,
+    /** the watcher waits for events of the binder */
+    BINDER_WAKE_WATCHING,
+    /** the watcher signaled the wakeup fd */
+    BINDER_WAKE_SIGNALED,
+} BinderWakeStateE;
+
+/** sleep in ms of the host loop while the queued jobs are blocked by their group */
+#define BINDER_WAKE_BLOCKED_MS 10
+
+/** the wakeup fd of foreign event loops and its watcher */
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    BinderWakeStateE state;
+    /** whether the watcher is out of the event manager */
+    int parked;
+    /** the eventfd returned by AfbBinderGetWakeFd, -1 until created */
+    int fd;
+    /** whether jobs can run now, as seen by the last AfbPollRunJobsEx */
+    int ready;
+    /** monotonic time in ms when jobs can run, -1 if not known */
+    int64_t due;
+} binderWake= {
+    .mutex= PTHREAD_MUTEX_INITIALIZER,
+    .cond= PTHREAD_COND_INITIALIZER,
+    .state= BINDER_WAKE_HOST,
+    .parked= 1,
+    .fd= -1,
+    .ready= 1,
+    .due= -1,
+};
+
+// monotonic time in ms
+static int64_t BinderWakeNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// time to wait in ms before jobs can run, 0 if they can now, -1 if unknown, must be locked
+static int BinderWakeTimeout(void) {
+    int64_t delay;
+
+    if (binderWake.ready) return 0;
+    if (binderWake.due < 0) return -1;
+    delay= binderWake.due - BinderWakeNow();
+    return delay <= 0 ? 0 : delay > INT_MAX ? INT_MAX : (int)delay;
+}
+
+// the watcher waits in the event manager, for the host loop, until
+// something happens: I/O, timer or jobs queued (the scheduler wakes
+// up the event manager when it can't start a thread for a new job)
+static void *BinderWakeWatcher(void *arg) {
+    uint64_t one= 1;
+    ssize_t rc;
+    int timeout;
+
+    pthread_mutex_lock(&binderWake.mutex);
+    for (;;) {
+        while (binderWake.state != BINDER_WAKE_WATCHING)
+            pthread_cond_wait(&binderWake.cond, &binderWake.mutex);
+        binderWake.parked= 0;
+        timeout= BinderWakeTimeout();
+        pthread_mutex_unlock(&binderWake.mutex);
+
+        // the wait also ends when delayed or blocked jobs may run
+        afb_ev_mgr_prepare();
+        afb_ev_mgr_wait(timeout);
+        afb_ev_mgr_release();
+
+        pthread_mutex_lock(&binderWake.mutex);
+        binderWake.parked= 1;
+        if (binderWake.state == BINDER_WAKE_WATCHING) {
+            binderWake.state= BINDER_WAKE_SIGNALED;
+            rc= write(binderWake.fd, &one, sizeof one);
+            (void)rc;
+        }
+        pthread_cond_broadcast(&binderWake.cond);
+    }
+    return NULL;
+}
+
+// get the event manager back from the watcher before running jobs
+static void BinderWakeHold(void) {
+    struct timespec ts;
+    uint64_t count;
+    ssize_t rc;
+
+    pthread_mutex_lock(&binderWake.mutex);
+    binderWake.state= BINDER_WAKE_HOST;
+    while (!binderWake.parked) {
+        // retry the wakeup in case the watcher was not yet waiting
+        afb_ev_mgr_wakeup();
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 10000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&binderWake.cond, &binderWake.mutex, &ts);
+    }
+    rc= read(binderWake.fd, &count, sizeof count);
+    (void)rc;
+    pthread_mutex_unlock(&binderWake.mutex);
+}
+
+// give the event manager to the watcher or keep the wakeup fd signaled if jobs can run
+static void BinderWakeRelease(void) {
+    uint64_t one= 1;
+    ssize_t rc;
+
+    pthread_mutex_lock(&binderWake.mutex);
+    if (binderWake.ready) {
+        binderWake.state= BINDER_WAKE_SIGNALED;
+        rc= write(binderWake.fd, &one, sizeof one);
+        (void)rc;
+    } else {
+        afb_ev_mgr_release();
+        binderWake.state= BINDER_WAKE_WATCHING;
+        pthread_cond_broadcast(&binderWake.cond);
+    }
+    pthread_mutex_unlock(&binderWake.mutex);
+}
+
+// get the fd signaled when the binder has work for the host loop
+int AfbBinderGetWakeFd(void) {
+    pthread_t watcher;
+    uint64_t one= 1;
+    ssize_t rc;
+    int fd, status;
+
+    pthread_mutex_lock(&binderWake.mutex);
+    if (binderWake.fd < 0) {
+        fd= eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (fd < 0) {
+            status= -errno;
+            goto OnErrorExit;
+        }
+        status= -pthread_create(&watcher, NULL, BinderWakeWatcher, NULL);
+        if (status < 0) {
+            close(fd);
+            goto OnErrorExit;
+        }
+        pthread_detach(watcher);
+        binderWake.fd= fd;
+
+        // signaled at start so that the host runs the jobs already queued
+        binderWake.state= BINDER_WAKE_SIGNALED;
+        rc= write(fd, &one, sizeof one);
+        (void)rc;
+    }
+    pthread_mutex_unlock(&binderWake.mutex);
+    return binderWake.fd;
+
+OnErrorExit:
+    pthread_mutex_unlock(&binderWake.mutex);
+    LIBAFB_ERROR("AfbBinderGetWakeFd: can't create the wakeup fd");
+    return status;
+}
+
+// get the time the host loop can sleep without calling AfbPollRunJobs
+int AfbBinderNextTimeout(void) {
+    int timeout;
+
+    pthread_mutex_lock(&binderWake.mutex);
+    timeout= BinderWakeTimeout();
+    pthread_mutex_unlock(&binderWake.mutex);
+    return timeout;
+}
+
 // pop afb waiting event and process them
 void AfbPollRunJobs(void) {
+    AfbPollRunJobsEx(0, 0, NULL);
+}
+
+// pop afb waiting event and process at most maxJobs of them
+int AfbPollRunJobsEx(int timeoutMs, int maxJobs, int *remaining) {
+    struct afb_job *job;
+    int count= 0, ready, pending, wait;
+    long delayms= -1;
+
+    // take the event manager from the watcher of the wakeup fd
+    if (binderWake.fd >= 0) BinderWakeHold();
+
+    // don't wait past the time queued jobs can run: at once when the last
+    // run stopped on its budget, until the due time when they are delayed
+    pthread_mutex_lock(&binderWake.mutex);
+    wait= BinderWakeTimeout();
+    pthread_mutex_unlock(&binderWake.mutex);
+    if (wait >= 0 && (timeoutMs < 0 || wait < timeoutMs)) timeoutMs= wait;
     afb_ev_mgr_prepare();
-    afb_ev_mgr_wait_and_dispatch(0);
-    for (struct afb_job *job= afb_jobs_dequeue(0); job; job= afb_jobs_dequeue(0)) {
+    afb_ev_mgr_wait_and_dispatch(timeoutMs);
+    for (;;) {
+        if (maxJobs > 0 && count >= maxJobs) {
+            // the budget is exhausted, queued jobs are expected to run
+            pending= afb_jobs_get_pending_count();
+            ready= pending > 0;
+            break;
+        }
+        job= afb_jobs_dequeue(&delayms);
+        if (job == NULL) {
+            // the queued jobs, if any, are delayed or blocked by their group
+            pending= 0;
+            ready= 0;
+            if (delayms < 0 && afb_jobs_get_pending_count() > 0)
+                delayms= BINDER_WAKE_BLOCKED_MS;
+            break;
+        }
         afb_jobs_run(job);
+        count++;
     }
+
+    // record when jobs can run again for the watcher and AfbBinderNextTimeout
+    pthread_mutex_lock(&binderWake.mutex);
+    binderWake.ready= ready;
+    binderWake.due= ready || delayms < 0 ? -1 : BinderWakeNow() + delayms;
+    pthread_mutex_unlock(&binderWake.mutex);
+
+    if (binderWake.fd >= 0) BinderWakeRelease();
+    if (remaining) *remaining= pending;
+    return count;
 }
@@ -39,6 +39,20 @@ typedef struct {
     void *state;           /**< a state */
 } AfbVcbDataT;
 
+/**
+ * @brief static description of a verb
+ * @see AfbAddVerbsStatic
+ */
+typedef struct {
+    const char *verb;               /**< name (or glob pattern) of the verb */
+    const char *info;               /**< informational text or NULL */
+    afb_req_callback_t callback;    /**< callback of the verb */
+    void *vcbData;                  /**< data of the verb or NULL, see AfbAddVerbsStatic */
+    int acl;                        /**< the ACL as returned by AfbBinderAclIndex or 0 for none */
+    uint32_t session;               /**< session requirements */
+    int glob;                       /**< not zero when verb is a glob pattern */
+} AfbVerbDescT;
+
 /**
  * @brief opaque handler for binder structure
  */
@@ -109,6 +123,21 @@ extern const char* AfbApiCreate(
                     afb_event_handler_x4_t usrEvtCb,
                     void *userData);
 
+/**
+ * @brief Deletes an API created by AfbApiCreate
+ *
+ * @param binder the binder context
+ * @param apiv4  the API to delete
+ *
+ * @return NULL on success or an error string
+ *
+ * The API is removed from the set where it was declared and the
+ * reference given by AfbApiCreate is released. The closures of the
+ * verbs added by AfbAddVerbs and AfbAddVerbsStatic are released too, so
+ * the API must not be processing requests anymore.
+ */
+extern const char* AfbApiDelete(AfbBinderHandleT *binder, afb_api_x4_t apiv4);
+
 /**
  * @brief Add one verb to the API of the binder accordingly to JSON configJ
  *
@@ -139,9 +168,48 @@ extern const char* AfbAddOneVerb(AfbBinderHandleT *binder, afb_api_x4_t apiv4,
  *  - magic:   points to AfbAddVerbs itself
  *  - configJ: the configuration object of the event
  *  - uid:     the uid of configJ (equals json_object_get_string(json_object_object_get(configJ, "uid")))
+ *
+ * These structures are allocated together in one block released by
+ * AfbApiDelete, they must not be freed.
  */
 extern const char* AfbAddVerbs(AfbBinderHandleT *binder, afb_api_x4_t apiv4, json_object *configJ, afb_req_callback_t callback);
 
+/**
+ * @brief Get the index of the ACL of the given uid for AfbVerbDescT
+ *
+ * @param binder binder handler
+ * @param uid    uid of the ACL as declared in the field acls of binder's config
+ *
+ * @return the index of the ACL, always greater than zero, or -1 if not found
+ */
+extern int AfbBinderAclIndex(AfbBinderHandleT *binder, const char *uid);
+
+/**
+ * @brief Add to the API of the binder the verbs of a static table
+ *
+ * Unlike AfbAddVerbs, no JSON object is involved and ACLs are given
+ * by their index. The table is not copied and must remain valid for the
+ * life of the API.
+ *
+ * @param binder binder handler
+ * @param apiv4 api handler
+ * @param table the table of the verbs
+ * @param count count of verbs in the table
+ *
+ * @return NULL on success or an error string
+ *
+ * The callbacks will receive as closure parameter a pointer to an instance
+ * structure AfbVcbDataT with the fields below:
+ *
+ *  - magic:    points to AfbAddVerbsStatic itself
+ *  - uid:      the name of the verb
+ *  - userdata: the field vcbData of the verb
+ *
+ * These structures are allocated together in one block released by
+ * AfbApiDelete, they must not be freed.
+ */
+extern const char* AfbAddVerbsStatic(AfbBinderHandleT *binder, afb_api_x4_t apiv4, const AfbVerbDescT *table, size_t count);
+
 /**
  * @brief add one event handler for the api
  *
@@ -170,6 +238,9 @@ extern const char* AfbAddOneEvent(afb_api_x4_t apiv4, const char*uid, const char
  *  - magic:   points to AfbAddEvents itself
  *  - configJ: the configuration object of the event
  *  - uid:     the uid of configJ (equals json_object_get_string(json_object_object_get(configJ, "uid")))
+ *
+ * Each of these structures is allocated on its own: the closure given
+ * back by AfbDelOneEvent can be freed by the caller.
  */
 extern const char* AfbAddEvents(afb_api_x4_t apiv4, json_object *configJ, afb_event_handler_t callback);
 
@@ -234,6 +305,32 @@ extern int AfbBinderStart(AfbBinderHandleT *binder, void *config, AfbStartupCb c
  */
 extern void AfbBinderExit(AfbBinderHandleT *binder, int exitcode);
 
+/**
+ * @brief make the calling host thread run the jobs of the binder's
+ *        scheduler until AfbBinderLeaveWorker is called for the flag
+ *        until or until AfbBinderExit is called
+ *
+ * This lets glue runtimes owning a thread pool share it with the binder
+ * (with a low thread-max in the config of the binder) instead of running
+ * two pools on the same cores.
+ *
+ * @param binder the binder handler
+ * @param until the flag telling to leave, the function returns at once
+ *        when it is not zero, it is set by AfbBinderLeaveWorker. It also
+ *        returns at once after AfbBinderExit
+ *
+ * @return 0 when leaving or a negative error code
+ */
+extern int AfbBinderJoinWorker(AfbBinderHandleT *binder, int *until);
+
+/**
+ * @brief tell the host threads that joined with the flag until to leave
+ *
+ * @param binder the binder handler
+ * @param until the flag given to AfbBinderJoinWorker, set to 1
+ */
+extern void AfbBinderLeaveWorker(AfbBinderHandleT *binder, int *until);
+
 /**
  * @brief start the services of the binder but not the scheduler
  *
@@ -252,6 +349,51 @@ extern int AfbBinderEnter(AfbBinderHandleT *binder, void *config, AfbStartupCb c
  */ 
 extern void AfbPollRunJobs(void);
 
+/**
+ * @brief Wait for an event at most timeoutMs, dispatch it and run at most
+ * maxJobs of the scheduled jobs
+ *
+ * The wait is skipped when jobs are already scheduled, so that a host loop
+ * calling it with a budget interleaves fairly with its own work and can
+ * sleep when the binder is idle, i.e. when remaining is zero.
+ *
+ * @param timeoutMs maximum wait in milliseconds, 0 for no wait, -1 for no limit
+ * @param maxJobs maximum count of jobs to run, 0 or negative for no limit
+ * @param remaining if not NULL, receives the count of jobs still scheduled when
+ *        the budget stopped the run or 0 when the queued jobs, if any, can't
+ *        run yet, being delayed or blocked by their group
+ *
+ * @return the count of jobs run
+ */
+extern int AfbPollRunJobsEx(int timeoutMs, int maxJobs, int *remaining);
+
+/**
+ * @brief Get a file descriptor that becomes readable when the binder has
+ * work for the host loop: I/O, timers or queued jobs
+ *
+ * A thread of the binder watches the events of the binder while the host
+ * loop does not run AfbPollRunJobs or AfbPollRunJobsEx. The descriptor is
+ * cleared by these functions and stays readable after them while queued
+ * jobs can run. It becomes readable again when delayed jobs are due. It
+ * must not be read or closed by the host loop.
+ *
+ * @return the file descriptor or a negative error code
+ */
+extern int AfbBinderGetWakeFd(void);
+
+/**
+ * @brief Get the time the host loop can sleep before calling AfbPollRunJobs
+ * or AfbPollRunJobsEx when watching the file descriptor of AfbBinderGetWakeFd
+ *
+ * The time is computed by the last call to AfbPollRunJobsEx: it is the delay
+ * of the next delayed job or a short delay when the queued jobs are blocked
+ * by their group.
+ *
+ * @return 0 if jobs can run, the time to wait in ms or -1 for waiting the
+ *         file descriptor without timeout
+ */
+extern int AfbBinderNextTimeout(void);
+
 /*************************************************************************************/
 /*************************************************************************************/
 /***** D E P R E C A T E D                                                       *****/
@@ -29,17 +29,32 @@
 #include <stdint.h>
 #include <signal.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <time.h>
+#include <pthread.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <json-c/json.h>
 
 #include "afb-binder-defaults.h"
 #include "afb-binder-opts.h"
 #include "afb-binder-utils.h"
+#include "afb-binder-stats.h"
+#include "afb-binder-preload.h"
+#include "afb-binder-profile.h"
+#include "afb-binder-lazy.h"
+#include "afb-binder-affinity.h"
+#include "afb-binder-pool.h"
+#include "afb-binder-autoscale.h"
+#include "afb-binder-overload.h"
+#include "afb-binder-fair.h"
+#include "afb-binder-static.h"
 
 #if WITH_CALL_PERSONALITY
 #include <sys/personality.h>
@@ -78,6 +93,12 @@
 
 struct afb_apiset *afb_binder_public_apiset;
 struct afb_apiset *afb_binder_main_apiset;
+
+/* apiset of the HTTP entry point, gated by the admission policies if any */
+static struct afb_apiset *public_entry_set;
+
+/* whether the entry points are gated by admission policies */
+static int gating;
 struct json_object *afb_binder_main_config;
 #if WITH_LIBMICROHTTPD
 struct afb_hsrv *afb_binder_http_server;
@@ -195,7 +216,15 @@ static int run_start(void *closure, const char *value)
 {
 	int (*starter) (const char *value, struct afb_apiset *declare_set, struct afb_apiset *call_set) = closure;
 	struct afb_apiset *declset = get_declare_set(&value, Export_Private);
-	return starter(value, declset, afb_binder_main_apiset) >= 0;
+	struct afb_apiset *callset = afb_binder_main_apiset;
+
+	/* each served socket is an interface gated by the admission policies */
+	if (gating) {
+		callset = afb_binder_overload_gate(value, afb_binder_main_apiset);
+		if (callset == NULL)
+			return 0;
+	}
+	return starter(value, declset, callset) >= 0;
 }
 
 static void apiset_start_list(const char *name,
@@ -210,6 +239,46 @@ static void apiset_start_list(const char *name,
 }
 
 #if WITH_DYNAMIC_BINDING
+/**
+ * Tells whether the binding specified by the object 'value' is lazy
+ * and if so returns the name of its API in 'apiname'
+ *
+ * @param value an object describing the binding
+ * @param apiname where to store the name of the API of the binding
+ *
+ * @return 1 if lazy, 0 otherwise
+ */
+static int is_lazy_binding(struct json_object *value, const char **apiname)
+{
+	struct json_object *obj;
+
+	if (!json_object_is_type(value, json_type_object)
+	 || !json_object_object_get_ex(value, "lazy", &obj)
+	 || !json_object_get_boolean(obj))
+		return 0;
+	if (!json_object_object_get_ex(value, "api", &obj)
+	 && !json_object_object_get_ex(value, "uid", &obj))
+		obj = NULL;
+	*apiname = json_object_get_string(obj);
+	return 1;
+}
+
+/**
+ * Gets the pool and the priority of the binding specified by the object 'value'
+ *
+ * @param value an object describing the binding
+ * @param priority where to store the priority of the binding
+ *
+ * @return the name of the pool of the binding or NULL when none
+ */
+static const char *pool_of_binding(struct json_object *value, const char **priority)
+{
+	struct json_object *obj;
+
+	*priority = json_object_object_get_ex(value, "priority", &obj) ? json_object_get_string(obj) : NULL;
+	return json_object_object_get_ex(value, "pool", &obj) ? json_object_get_string(obj) : NULL;
+}
+
 /**
  * Loads the binding specified by the object 'value'
  *
@@ -218,15 +287,16 @@ static void apiset_start_list(const char *name,
  */
 static void load_one_binding_cb(void *closure, struct json_object *value)
 {
-	struct afb_apiset *declset;
+	struct afb_apiset *declset, *loadset;
 	struct json_object *path;
-	const char *pathstr;
-	int rc;
+	const char *pathstr, *apiname, *pool = NULL, *priority = NULL;
+	int rc, span;
 
 	/* mainstream type is an object { path, uid, config } */
 	if (json_object_is_type(value, json_type_object)
 		&& json_object_object_get_ex(value, "path", &path)) {
 		pathstr = json_object_get_string(path);
+		pool = pool_of_binding(value, &priority);
 	}
 	/* try legacy plain strings if config files for it exist */
 	else if (json_object_is_type(value, json_type_string)) {
@@ -239,27 +309,141 @@ static void load_one_binding_cb(void *closure, struct json_object *value)
 		exit(EXIT_FAILURE);
 	}
 
-	/* add the binding now */
+	/* the APIs of a binding of a pool are first declared in a private set */
 	declset = get_declare_set(&pathstr, Export_Public);
-	rc = afb_api_so_add_binding_config(pathstr, declset, afb_binder_main_apiset, value);
-	if (rc < 0) {
-		LIBAFB_ERROR("can't load binding %s", pathstr);
+	loadset = declset;
+	if (pool != NULL) {
+		loadset = afb_apiset_create(pathstr, afb_apiset_timeout_get(afb_binder_main_apiset));
+		if (loadset == NULL) {
+			LIBAFB_ERROR("out of memory");
+			exit(EXIT_FAILURE);
+		}
+	}
+	else if (priority != NULL) {
+		LIBAFB_ERROR("priority of binding %s requires a pool", pathstr);
 		exit(EXIT_FAILURE);
 	}
+
+	if (value != NULL && is_lazy_binding(value, &apiname)) {
+		/* declare the API of a lazy binding */
+		if (apiname == NULL) {
+			LIBAFB_ERROR("lazy binding %s requires an api or an uid", pathstr);
+			exit(EXIT_FAILURE);
+		}
+		rc = afb_binder_lazy_add(apiname, pathstr, loadset, afb_binder_main_apiset, value);
+		if (rc < 0) {
+			LIBAFB_ERROR("can't declare lazy binding %s", pathstr);
+			exit(EXIT_FAILURE);
+		}
+	}
+	else {
+		/* add the binding now */
+		span = afb_binder_profile_begin("binding", pathstr);
+		rc = afb_api_so_add_binding_config(pathstr, loadset, afb_binder_main_apiset, value);
+		afb_binder_profile_end(span);
+		if (rc < 0) {
+			LIBAFB_ERROR("can't load binding %s", pathstr);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* make the APIs available through the pool */
+	if (pool != NULL) {
+		rc = afb_binder_pool_declare(pool, priority, loadset, declset);
+		afb_apiset_unref(loadset);
+		if (rc < 0) {
+			LIBAFB_ERROR("can't put binding %s in pool %s", pathstr, pool);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/**
+ * Records the path of the binding specified by the object 'value'
+ *
+ * @param closure the array of paths being filled
+ * @param value an object describing the binding to load
+ */
+static void path_of_one_binding_cb(void *closure, struct json_object *value)
+{
+	const char **paths = closure, *pathstr = NULL, *apiname;
+	struct json_object *path;
+	size_t idx;
+
+	if (is_lazy_binding(value, &apiname))
+		return;
+	if (json_object_is_type(value, json_type_object)
+		&& json_object_object_get_ex(value, "path", &path))
+		pathstr = json_object_get_string(path);
+	else if (json_object_is_type(value, json_type_string))
+		pathstr = json_object_get_string(value);
+	if (pathstr != NULL) {
+		pathstr += scan_export_prefix(pathstr, NULL);
+		for (idx = 0 ; paths[idx] != NULL ; idx++);
+		paths[idx] = pathstr;
+	}
+}
+
+/**
+ * Creates the pool specified by 'value'
+ *
+ * @param closure not used
+ * @param value a string or an object describing the pool
+ */
+static void create_one_pool_cb(void *closure, struct json_object *value)
+{
+	if (afb_binder_pool_create(value) < 0)
+		exit(EXIT_FAILURE);
 }
 
 /**
  * Load the bindings within the given 'name' of the config.
+ * When the option preload-bindings is set, the bindings are
+ * prefetched and opened by parallel threads while being registered
+ * in the order of the config.
  *
  * @param name name of the array of bindings to load
  */
 static void load_bindings(const char *name)
 {
-	struct json_object *array;
+	struct json_object *array, *obj;
+	struct afb_binder_preload *preload = NULL;
+	struct timespec start, end;
+	const char **paths;
+	size_t count;
+	int threads;
+
+	/* create the worker pools */
+	if (json_object_object_get_ex(afb_binder_main_config, "pool", &array))
+		rp_jsonc_optarray_for_all(array, create_one_pool_cb, NULL);
 
 	/* check if the name exists */
-	if (json_object_object_get_ex(afb_binder_main_config, name, &array))
+	if (json_object_object_get_ex(afb_binder_main_config, name, &array)) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		/* start preloading */
+		if (json_object_object_get_ex(afb_binder_main_config, "preload-bindings", &obj)) {
+			threads = json_object_get_int(obj);
+			count = json_object_is_type(array, json_type_array) ? json_object_array_length(array) : 1;
+			paths = calloc(count + 1, sizeof *paths);
+			if (paths != NULL) {
+				rp_jsonc_optarray_for_all(array, path_of_one_binding_cb, paths);
+				for (count = 0 ; paths[count] != NULL ; count++);
+				preload = afb_binder_preload_start(paths, (unsigned)count, (unsigned)threads);
+				free(paths);
+			}
+			if (preload == NULL)
+				LIBAFB_WARNING("can't preload bindings");
+		}
+
 		rp_jsonc_optarray_for_all(array, load_one_binding_cb, NULL);
+		afb_binder_preload_end(preload);
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		LIBAFB_NOTICE("bindings loaded in %.3f ms%s",
+			(double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6,
+			preload ? " with preloading" : "");
+	}
 }
 #endif
 
@@ -297,10 +481,44 @@ static void on_sigterm(int signum, siginfo_t *info, void *uctx)
 	exit(EXIT_SUCCESS);
 }
 
+static void reload_config_job(int signum, void *arg);
+
+/* the arguments of the program, for reloading the config */
+static int main_argc;
+static char **main_argv;
+
+/* eventfd signaled on SIGHUP, watched by the event manager */
+static int reload_fd = -1;
+static struct ev_fd *reload_efd;
+
 static void on_sighup(int signum, siginfo_t *info, void *uctx)
 {
-	LIBAFB_NOTICE("Received SIGHUP");
-	/* TODO */
+	uint64_t one = 1;
+	int errsav = errno;
+	ssize_t rc;
+
+	/* only async-signal-safe calls here, the reload is posted by on_reload */
+	rc = write(reload_fd, &one, sizeof one);
+	(void)rc;
+	errno = errsav;
+}
+
+static void on_reload(struct ev_fd *efd, int fd, uint32_t revents, void *closure)
+{
+	uint64_t count;
+
+	if (read(fd, &count, sizeof count) == (ssize_t)sizeof count) {
+		LIBAFB_NOTICE("Received SIGHUP");
+		if (afb_sched_post_job(&main_argv, 0, 0, reload_config_job, NULL, Afb_Sched_Mode_Normal) < 0)
+			LIBAFB_ERROR("can't reload the config");
+	}
+}
+
+/* watch the SIGHUP notifications, from the event manager that needs a started scheduler */
+static void watch_reload()
+{
+	if (reload_fd >= 0 && afb_ev_mgr_add_fd(&reload_efd, reload_fd, EPOLLIN, on_reload, NULL, 0, 0) < 0)
+		LIBAFB_ERROR("can't watch SIGHUP, the config can't be reloaded");
 }
 
 #if !_DEFAULT_SOURCE /* no on_exit function */
@@ -328,8 +546,13 @@ static void setup_handlers()
 	siga.sa_sigaction = on_sigterm;
 	sigaction(SIGTERM, &siga, NULL);
 
-	siga.sa_sigaction = on_sighup;
-	sigaction(SIGHUP, &siga, NULL);
+	reload_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (reload_fd < 0)
+		LIBAFB_ERROR("can't create eventfd, the config can't be reloaded");
+	else {
+		siga.sa_sigaction = on_sighup;
+		sigaction(SIGHUP, &siga, NULL);
+	}
 
 	/* handle exiting */
 #if _DEFAULT_SOURCE
@@ -411,6 +634,9 @@ static void daemonize()
 static int add_alias(struct afb_hsrv *hsrv, const char *prefix, const char *alias, int priority, int relax)
 {
 #if WITH_OPENAT
+	/* static files are served from memory before the alias */
+	if (afb_binder_static_add(hsrv, prefix, afb_common_rootdir_get_fd(), alias, priority + 1) < 0)
+		LIBAFB_WARNING("can't serve static files of %s from memory", alias);
 	return afb_hsrv_add_alias(hsrv, prefix, afb_common_rootdir_get_fd(), alias, priority, relax);
 #else
 	return afb_hsrv_add_alias_path(hsrv, prefix, afb_common_rootdir_get_path(), alias, priority, relax);
@@ -426,6 +652,10 @@ static int add_alias_weak_dir(struct afb_hsrv *hsrv, const char *prefix, const c
 {
 	char * dirname = rp_expand_vars_env_only(alias, 0);
 	int rc = afb_hsrv_add_alias_dirname(hsrv, prefix, dirname ?: alias, priority, relax);
+#if WITH_OPENAT
+	if (rc && afb_binder_static_add(hsrv, prefix, AT_FDCWD, dirname ?: alias, priority + 1) < 0)
+		LIBAFB_DEBUG("can't serve static files of %s from memory", dirname ?: alias);
+#endif
 	free(dirname);
 	return rc;
 }
@@ -462,7 +692,7 @@ static int http_server_create(struct afb_hsrv **result)
 	struct json_object *itfs = NULL;
 	int cache_timeout, http_port = -1;
 	int session_timeout;
-	int no_httpd = 0, is_https = 0;
+	int no_httpd = 0, is_https = 0, static_files = 1;
 	struct json_object *obj;
 
 	/* default result: NULL */
@@ -470,7 +700,7 @@ static int http_server_create(struct afb_hsrv **result)
 
 	/* read parameters */
 	http_port = -1;
-	rc = rp_jsonc_unpack(afb_binder_main_config, "{ss ss si s?i ss s?b s?b si ss s?s s?o}",
+	rc = rp_jsonc_unpack(afb_binder_main_config, "{ss ss si s?i ss s?b s?b si ss s?s s?o s?b}",
 				"uploaddir", &uploaddir,
 				"rootdir", &rootdir,
 				"cache-eol", &cache_timeout,
@@ -483,7 +713,8 @@ static int http_server_create(struct afb_hsrv **result)
 				"cntxtimeout", &session_timeout,
 				"rootbase", &rootbase,
 				"roothttp", &roothttp,
-				"interface", &itfs
+				"interface", &itfs,
+				"static-files", &static_files
 			);
 	if (rc < 0) {
 		LIBAFB_ERROR("Can't get HTTP server config");
@@ -589,17 +820,23 @@ static int http_server_create(struct afb_hsrv **result)
 	/* initialize the cache timeout */
 	if (!afb_hsrv_set_cache_timeout(hsrv, cache_timeout))
 		goto error;
+	afb_binder_static_setup(static_files, cache_timeout);
 
 	/* set the root api handlers */
 	if (!afb_hsrv_add_handler(hsrv, rootapi,
 #if LIBAFB_BEFORE_VERSION(5,0,11)
-			afb_hswitch_websocket_switch, afb_binder_public_apiset, 20))
+			afb_hswitch_websocket_switch, public_entry_set, 20))
 #else
-			afb_hswitch_upgrade, afb_binder_public_apiset, 20))
+			afb_hswitch_upgrade, public_entry_set, 20))
 #endif
 		goto error;
 	if (!afb_hsrv_add_handler(hsrv, rootapi,
-			afb_hswitch_apis, afb_binder_public_apiset, 10))
+			afb_hswitch_apis, public_entry_set, 10))
+		goto error;
+
+	/* reply 503 to the calls of APIs shed by the overload policy */
+	if (afb_binder_overload_is_active()
+	 && !afb_hsrv_add_handler(hsrv, rootapi, afb_binder_overload_http, NULL, 30))
 		goto error;
 
 	/* set alias of config */
@@ -983,6 +1220,7 @@ static int execute_command()
 		/* run */
 		if (!SELF_PGROUP)
 			setpgid(0, 0);
+		afb_binder_affinity_restore();
 		execv(args[0], args);
 		LIBAFB_ERROR("can't launch %s: %m", args[0]);
 	}
@@ -994,31 +1232,131 @@ static int execute_command()
  | startup calls
  +--------------------------------------------------------- */
 
+/* states of a startup call */
+#define STARTUP_WAITING 0
+#define STARTUP_RUNNING 1
+#define STARTUP_DONE    2
+
+struct startup_batch;
+
 struct startup_req
 {
 	struct afb_req_common comreq;
+	struct startup_batch *batch;
 	char *api;
 	char *verb;
-	struct json_object *calls;
-	int index;
-	int count;
 	const char *callspec;
+	int *deps;
+	int ndeps;
+	int state;
+	int span;
+	struct timespec start;
+};
+
+struct startup_batch
+{
+	pthread_mutex_t mutex;
 	struct afb_session *session;
+	int count;
+	int running;
+	int done;
+	int max;
+	struct startup_req reqs[];
 };
 
+/* count of steps before the end of the startup: readyness and startup calls */
+static int startup_steps = 2;
+
+/**
+ * Called at the end of each step of the startup
+ */
+static void startup_step_done()
+{
+	if (__atomic_sub_fetch(&startup_steps, 1, __ATOMIC_ACQ_REL) == 0)
+		afb_binder_profile_done();
+}
+
 static void startup_call_reply(struct afb_req_common *comreq, int status, unsigned nreplies, struct afb_data * const *replies)
 {
 	struct startup_req *sreq = containerof(struct startup_req, comreq, comreq);
+	struct timespec now;
+	double ms;
 
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (double)(now.tv_sec - sreq->start.tv_sec) * 1e3 + (double)(now.tv_nsec - sreq->start.tv_nsec) / 1e6;
 	if (status >= 0) {
-		LIBAFB_NOTICE("startup call %s returned %d", sreq->callspec, status);
+		LIBAFB_NOTICE("startup call %s returned %d in %.3f ms", sreq->callspec, status, ms);
 	} else {
-		LIBAFB_ERROR("startup call %s ERROR! %d", sreq->callspec, status);
+		LIBAFB_ERROR("startup call %s ERROR! %d after %.3f ms", sreq->callspec, status, ms);
 		exit(EXIT_FAILURE);
 	}
 }
 
-static void startup_call_current(struct startup_req *sreq);
+/**
+ * Selects the startup calls that can be started, the ones whose
+ * dependencies are done, lowest index first, within the limit of
+ * concurrent calls. Must be called with the mutex of the batch locked.
+ *
+ * @param batch the batch of calls
+ * @param starts array receiving the selected calls
+ *
+ * @return the count of selected calls
+ */
+static int startup_call_select(struct startup_batch *batch, struct startup_req **starts)
+{
+	struct startup_req *sreq;
+	int idx, dep, nstarts = 0;
+
+	for (idx = 0 ; idx < batch->count && batch->running < batch->max ; idx++) {
+		sreq = &batch->reqs[idx];
+		if (sreq->state != STARTUP_WAITING)
+			continue;
+		for (dep = 0 ; dep < sreq->ndeps && batch->reqs[sreq->deps[dep]].state == STARTUP_DONE ; dep++);
+		if (dep < sreq->ndeps)
+			continue;
+		sreq->state = STARTUP_RUNNING;
+		batch->running++;
+		starts[nstarts++] = sreq;
+	}
+	return nstarts;
+}
+
+static void startup_call_start(struct startup_req *sreq);
+
+/**
+ * Records the end of the call 'done' if not NULL and starts
+ * the startup calls that can be started
+ *
+ * @param batch the batch of calls
+ * @param done the call that is done or NULL
+ */
+static void startup_call_next(struct startup_batch *batch, struct startup_req *done)
+{
+	struct startup_req *starts[batch->max];
+	int idx, nstarts, finished;
+
+	pthread_mutex_lock(&batch->mutex);
+	if (done != NULL) {
+		done->state = STARTUP_DONE;
+		batch->running--;
+		batch->done++;
+	}
+	nstarts = startup_call_select(batch, starts);
+	finished = batch->done == batch->count;
+	pthread_mutex_unlock(&batch->mutex);
+
+	for (idx = 0 ; idx < nstarts ; idx++)
+		startup_call_start(starts[idx]);
+
+	if (finished) {
+		for (idx = 0 ; idx < batch->count ; idx++)
+			free(batch->reqs[idx].deps);
+		afb_session_unref(batch->session);
+		pthread_mutex_destroy(&batch->mutex);
+		free(batch);
+		startup_step_done();
+	}
+}
 
 static void startup_call_unref(struct afb_req_common *comreq)
 {
@@ -1027,12 +1365,8 @@ static void startup_call_unref(struct afb_req_common *comreq)
 	free(sreq->api);
 	free(sreq->verb);
 	afb_req_common_cleanup(&sreq->comreq);
-	if (++sreq->index < sreq->count)
-		startup_call_current(sreq);
-	else {
-		afb_session_unref(sreq->session);
-		free(sreq);
-	}
+	afb_binder_profile_end(sreq->span);
+	startup_call_next(sreq->batch, sreq);
 }
 
 static struct afb_req_common_query_itf startup_req_common_itf =
@@ -1041,13 +1375,14 @@ static struct afb_req_common_query_itf startup_req_common_itf =
 	.unref = startup_call_unref
 };
 
-static void startup_call_current(struct startup_req *sreq)
+static void startup_call_start(struct startup_req *sreq)
 {
 	const char *api, *verb, *json;
 	struct afb_data *arg0;
 	int rc;
 
-	sreq->callspec = json_object_get_string(json_object_array_get_idx(sreq->calls, sreq->index)),
+	sreq->span = afb_binder_profile_begin("call", sreq->callspec);
+	clock_gettime(CLOCK_MONOTONIC, &sreq->start);
 	api = sreq->callspec;
 	verb = strchr(api, '/');
 	if (verb) {
@@ -1063,7 +1398,7 @@ static void startup_call_current(struct startup_req *sreq)
 #else
 				afb_req_common_init(&sreq->comreq, &startup_req_common_itf, sreq->api, sreq->verb, 1, &arg0, NULL);
 #endif
-				afb_req_common_set_session(&sreq->comreq, sreq->session);
+				afb_req_common_set_session(&sreq->comreq, sreq->batch->session);
 				sreq->comreq.validated = 1;
 				afb_req_common_process(&sreq->comreq, afb_binder_main_apiset);
 				return;
@@ -1074,22 +1409,99 @@ static void startup_call_current(struct startup_req *sreq)
 	exit(EXIT_FAILURE);
 }
 
+/**
+ * Tells whether the call specification 'callspec' is for API/VERB
+ * given by 'name' of length 'len'
+ */
+static int startup_call_is(const char *callspec, const char *name, size_t len)
+{
+	return !strncmp(callspec, name, len) && callspec[len] == ':';
+}
+
+/**
+ * Sets the dependencies of the startup call of index 'index' of the batch.
+ * The call specification can be prefixed by after:API/VERB[,API/VERB...]:
+ * telling that the call must start after the end of the previous calls
+ * of the given API/VERB.
+ *
+ * @param batch the batch of calls
+ * @param index index of the call in the batch
+ */
+static void startup_call_deps(struct startup_batch *batch, int index)
+{
+	struct startup_req *sreq = &batch->reqs[index];
+	const char *after, *end;
+	size_t len;
+	int idx, dep, found;
+
+	if (strncmp(sreq->callspec, "after:", 6))
+		return;
+	after = &sreq->callspec[6];
+	end = strchr(after, ':');
+	if (end == NULL) {
+		LIBAFB_ERROR("Bad call specification %s", sreq->callspec);
+		exit(EXIT_FAILURE);
+	}
+	sreq->callspec = end + 1;
+	sreq->deps = calloc((size_t)index + 1, sizeof *sreq->deps);
+	if (sreq->deps == NULL) {
+		LIBAFB_ERROR("out of memory");
+		exit(EXIT_FAILURE);
+	}
+	while (after < end) {
+		len = strcspn(after, ",:");
+		for (found = 0, idx = 0 ; idx < index ; idx++) {
+			if (startup_call_is(batch->reqs[idx].callspec, after, len)) {
+				found = 1;
+				for (dep = 0 ; dep < sreq->ndeps && sreq->deps[dep] != idx ; dep++);
+				if (dep == sreq->ndeps)
+					sreq->deps[sreq->ndeps++] = idx;
+			}
+		}
+		if (!found) {
+			LIBAFB_ERROR("startup call %s can't be after %.*s that isn't a previous call",
+					sreq->callspec, (int)len, after);
+			exit(EXIT_FAILURE);
+		}
+		after += len + (after[len] == ',');
+	}
+}
+
 static void run_startup_calls()
 {
-	struct json_object *calls;
-	struct startup_req *sreq;
-	int count;
+	struct json_object *calls, *obj;
+	struct startup_batch *batch;
+	int idx, count;
 
 	if (json_object_object_get_ex(afb_binder_main_config, "call", &calls)
 	 && json_object_is_type(calls, json_type_array)
 	 && (count = (int)json_object_array_length(calls))) {
-		sreq = calloc(1, sizeof *sreq);
-		sreq->session = afb_session_addref(afb_api_common_get_common_session());
-		sreq->calls = calls;
-		sreq->index = 0;
-		sreq->count = count;
-		startup_call_current(sreq);
+		batch = calloc(1, sizeof *batch + (size_t)count * sizeof *batch->reqs);
+		if (batch == NULL) {
+			LIBAFB_ERROR("out of memory");
+			exit(EXIT_FAILURE);
+		}
+		pthread_mutex_init(&batch->mutex, NULL);
+		batch->session = afb_session_addref(afb_api_common_get_common_session());
+		batch->count = count;
+		batch->max = 1;
+		if (json_object_object_get_ex(afb_binder_main_config, "call-parallel", &obj)) {
+			/* the config file is not checked as the options are, clamp it */
+			batch->max = json_object_get_int(obj);
+			if (batch->max < 1 || batch->max > 256) {
+				LIBAFB_WARNING("call-parallel %d out of range 1..256, clamped", batch->max);
+				batch->max = batch->max < 1 ? 1 : 256;
+			}
+		}
+		for (idx = 0 ; idx < count ; idx++) {
+			batch->reqs[idx].batch = batch;
+			batch->reqs[idx].callspec = json_object_get_string(json_object_array_get_idx(calls, idx));
+			startup_call_deps(batch, idx);
+		}
+		startup_call_next(batch, NULL);
 	}
+	else
+		startup_step_done();
 }
 
 /**
@@ -1166,27 +1578,120 @@ static void notify_readyness()
  | job starting the binder
  +--------------------------------------------------------- */
 
+#if WITH_AFB_HOOK
+/* the keys of the config for tracing */
+static const char *const trace_keys[] = { "tracereq", "traceapi", "traceevt", "traceses", "traceglob" };
+
+/* the installed hooks of tracing */
+static struct {
+	struct afb_hook_req *req;
+	struct afb_hook_api *api;
+	struct afb_hook_evt *evt;
+	struct afb_hook_session *ses;
+	struct afb_hook_global *glob;
+} trace_hooks;
+
+/**
+ * Installs the tracing hook for the 'key' of the 'config', replacing the
+ * hook previously installed for that key
+ *
+ * @param config the config
+ * @param key    the key of the tracing spec (tracereq, traceapi, ...)
+ *
+ * @return 0 on success or -1 if the spec is invalid
+ */
+static int install_trace_hook(struct json_object *config, const char *key)
+{
+	struct json_object *obj;
+	const char *spec = NULL;
+	unsigned flags = 0;
+	int rc = 0;
+
+	if (json_object_object_get_ex(config, key, &obj))
+		spec = json_object_get_string(obj);
+
+	switch (key[5]) {
+	case 'r':
+		if (spec)
+			rc = afb_hook_flags_req_from_text(spec, &flags);
+		if (rc >= 0) {
+			if (trace_hooks.req)
+				afb_hook_unref_req(trace_hooks.req);
+			trace_hooks.req = spec ? afb_hook_create_req(NULL, NULL, NULL, flags, NULL, NULL) : NULL;
+		}
+		break;
+	case 'a':
+		if (spec)
+			rc = afb_hook_flags_api_from_text(spec, &flags);
+		if (rc >= 0) {
+			if (trace_hooks.api)
+				afb_hook_unref_api(trace_hooks.api);
+			trace_hooks.api = spec ? afb_hook_create_api(NULL, flags, NULL, NULL) : NULL;
+		}
+		break;
+	case 'e':
+		if (spec)
+			rc = afb_hook_flags_evt_from_text(spec, &flags);
+		if (rc >= 0) {
+			if (trace_hooks.evt)
+				afb_hook_unref_evt(trace_hooks.evt);
+			trace_hooks.evt = spec ? afb_hook_create_evt(NULL, flags, NULL, NULL) : NULL;
+		}
+		break;
+	case 's':
+		if (spec)
+			rc = afb_hook_flags_session_from_text(spec, &flags);
+		if (rc >= 0) {
+			if (trace_hooks.ses)
+				afb_hook_unref_session(trace_hooks.ses);
+			trace_hooks.ses = spec ? afb_hook_create_session(NULL, flags, NULL, NULL) : NULL;
+		}
+		break;
+	case 'g':
+		if (spec)
+			rc = afb_hook_flags_global_from_text(spec, &flags);
+		if (rc >= 0) {
+			if (trace_hooks.glob)
+				afb_hook_unref_global(trace_hooks.glob);
+			trace_hooks.glob = spec ? afb_hook_create_global(flags, NULL, NULL) : NULL;
+		}
+		break;
+	}
+	if (rc < 0) {
+		LIBAFB_ERROR("invalid %s spec '%s'", key, spec);
+		return -1;
+	}
+	return 0;
+}
+#endif
+
+/* bounds of the autoscaling of threads, if active */
+static int autoscale_min, autoscale_max;
+
 static void start(int signum, void *arg)
 {
 #if WITH_AFB_HOOK
-	const char *tracereq = NULL, *traceapi = NULL, *traceevt = NULL;
-	const char *traceses = NULL, *traceglob = NULL;
-	unsigned flags;
+	struct json_object *stats = NULL;
+	const char *statsexp;
 #endif
-	const char *uuid = NULL;
+	const char *uuid = NULL, *session_rate, *intf_rate;
 	struct json_object *settings = NULL, *tmpobj;
-	int max_session_count, session_timeout, api_timeout;
-	int rc;
+	int max_session_count, session_timeout, api_timeout, fair_queue;
+	int rc, span;
 
 #if WITH_AFB_DEBUG
 	afb_debug("start-entry");
 #endif
+	span = afb_binder_profile_begin("phase", "init");
 
 	if (signum) {
 		LIBAFB_ERROR("start aborted: received signal %s", strsignal(signum));
 		exit(EXIT_FAILURE);
 	}
 
+	if (autoscale_max > 0 && afb_binder_autoscale_start(autoscale_min, autoscale_max) < 0)
+		exit(EXIT_FAILURE);
+
 	rc = rp_jsonc_unpack(afb_binder_main_config, "{"
 			"si si si s?s"
 			"s?o"
@@ -1206,14 +1711,10 @@ static void start(int signum, void *arg)
 
 #if WITH_AFB_HOOK
 	rc = rp_jsonc_unpack(afb_binder_main_config, "{"
-			"s?s s?s s?s s?s s?s"
+			"s?o"
 			"}",
 
-			"tracereq", &tracereq,
-			"traceapi", &traceapi,
-			"traceevt", &traceevt,
-			"traceses",  &traceses,
-			"traceglob", &traceglob
+			"stats", &stats
 			);
 	if (rc < 0) {
 		LIBAFB_ERROR("Unable to get hook config");
@@ -1264,6 +1765,26 @@ static void start(int signum, void *arg)
 		LIBAFB_ERROR("can't create public apiset");
 		goto error;
 	}
+	public_entry_set = afb_binder_public_apiset;
+
+	/* gate the entry points with the admission policies */
+	if (json_object_object_get_ex(afb_binder_main_config, "jobs-overflow", &tmpobj)
+	 && afb_binder_overload_setup(json_object_get_string(tmpobj)) < 0)
+		goto error;
+	session_rate = intf_rate = NULL;
+	fair_queue = -1;
+	rp_jsonc_unpack(afb_binder_main_config, "{s?s s?s s?i}",
+			"session-rate", &session_rate,
+			"interface-rate", &intf_rate,
+			"fair-queue", &fair_queue);
+	if (afb_binder_fair_setup(session_rate, intf_rate, fair_queue) < 0)
+		goto error;
+	gating = afb_binder_overload_is_active() || afb_binder_fair_is_active();
+	if (gating) {
+		public_entry_set = afb_binder_overload_gate("http", afb_binder_public_apiset);
+		if (!public_entry_set)
+			goto error;
+	}
 	afb_global_api_init(afb_binder_main_apiset);
 	rc = afb_monitor_init(afb_binder_public_apiset, afb_binder_public_apiset);
 	if (rc < 0) {
@@ -1280,46 +1801,35 @@ static void start(int signum, void *arg)
 
 #if WITH_AFB_HOOK
 	/* install hooks */
-	if (tracereq) {
-		rc = afb_hook_flags_req_from_text(tracereq, &flags);
-		if (rc < 0) {
-			LIBAFB_ERROR("invalid tracereq spec '%s'", tracereq);
+	for (rc = 0 ; rc < (int)(sizeof trace_keys / sizeof *trace_keys) ; rc++)
+		if (install_trace_hook(afb_binder_main_config, trace_keys[rc]) < 0)
 			goto error;
-		}
-		afb_hook_create_req(NULL, NULL, NULL, flags, NULL, NULL);
-	}
-	if (traceapi) {
-		rc = afb_hook_flags_api_from_text(traceapi, &flags);
-		if (rc < 0) {
-			LIBAFB_ERROR("invalid traceapi spec '%s'", traceapi);
-			goto error;
-		}
-		afb_hook_create_api(NULL, flags, NULL, NULL);
-	}
-	if (traceevt) {
-		rc = afb_hook_flags_evt_from_text(traceevt, &flags);
-		if (rc < 0) {
-			LIBAFB_ERROR("invalid traceevt spec '%s'", traceevt);
-			goto error;
-		}
-		afb_hook_create_evt(NULL, flags, NULL, NULL);
-	}
-	if (traceses) {
-		rc = afb_hook_flags_session_from_text(traceses, &flags);
-		if (rc < 0) {
-			LIBAFB_ERROR("invalid traceses spec '%s'", traceses);
+
+	/* install statistics of verbs: private (or true) or public */
+	if (stats) {
+		if (json_object_is_type(stats, json_type_boolean))
+			statsexp = json_object_get_boolean(stats) ? "private" : NULL;
+		else
+			statsexp = json_object_get_string(stats);
+		if (statsexp == NULL)
+			rc = 0;
+		else if (!strcmp(statsexp, "private"))
+			rc = afb_binder_stats_init("stats", afb_binder_main_apiset, afb_binder_main_apiset);
+		else if (!strcmp(statsexp, "public"))
+			rc = afb_binder_stats_init("stats", afb_binder_public_apiset, afb_binder_main_apiset);
+		else {
+			LIBAFB_ERROR("invalid stats spec '%s'", statsexp);
 			goto error;
 		}
-		afb_hook_create_session(NULL, flags, NULL, NULL);
-	}
-	if (traceglob) {
-		rc = afb_hook_flags_global_from_text(traceglob, &flags);
 		if (rc < 0) {
-			LIBAFB_ERROR("invalid traceglob spec '%s'", traceglob);
+			LIBAFB_ERROR("failed to setup statistics");
 			goto error;
 		}
-		afb_hook_create_global(flags, NULL, NULL);
 	}
+
+	/* record the start of services in the startup profile */
+	if (afb_binder_profile_hook_services() < 0)
+		LIBAFB_WARNING("can't profile the start of services");
 #endif
 
 #if WITH_EXTENSION
@@ -1347,6 +1857,8 @@ static void start(int signum, void *arg)
 #if WITH_AFB_DEBUG
 	afb_debug("start-load");
 #endif
+	afb_binder_profile_end(span);
+	span = afb_binder_profile_begin("phase", "load");
 #if WITH_DYNAMIC_BINDING
 	load_bindings("binding");
 #if WITH_DIRENT
@@ -1382,7 +1894,10 @@ static void start(int signum, void *arg)
 #if WITH_CALL_PERSONALITY
 	personality((unsigned long)-1L);
 #endif
+	afb_binder_profile_end(span);
+	span = afb_binder_profile_begin("phase", "services");
 	rc = afb_apiset_start_all_services(afb_binder_main_apiset);
+	afb_binder_profile_end(span);
 	if (rc < 0) {
 		LIBAFB_ERROR("Services start failed");
 		goto error;
@@ -1391,6 +1906,10 @@ static void start(int signum, void *arg)
 	/* export started apis */
 	apiset_start_list("ws-server", afb_api_ws_add_server, "the afb-websocket service");
 	apiset_start_list("rpc-server", afb_api_rpc_add_server, "the rpc-websocket service");
+
+	/* make the APIs available through the gates */
+	if (afb_binder_overload_fill() < 0)
+		goto error;
 #if WITH_EXTENSION
 	/* start extensions */
 	rc = afb_extend_serve(afb_binder_main_apiset);
@@ -1406,7 +1925,9 @@ static void start(int signum, void *arg)
 	afb_debug("start-http");
 #endif
 	if (afb_binder_http_server != NULL) {
+		span = afb_binder_profile_begin("phase", "http");
 		rc = http_server_start(afb_binder_http_server);
+		afb_binder_profile_end(span);
 		if (rc < 0)
 			goto error;
 	}
@@ -1427,6 +1948,8 @@ static void start(int signum, void *arg)
 
 	/* ready */
 	notify_readyness();
+	afb_binder_profile_mark("phase", "ready");
+	startup_step_done();
 
 	/* activate the watchdog */
 #if HAS_WATCHDOG
@@ -1434,11 +1957,226 @@ static void start(int signum, void *arg)
 		LIBAFB_ERROR("can't start the watchdog");
 #endif
 
+	/* reload the config on SIGHUP */
+	watch_reload();
+
 	return;
 error:
 	exit(EXIT_FAILURE);
 }
 
+#if WITH_EXTENSION
+/**
+ * Loads the extension or the extension path 'value' using the
+ * loader given by 'closure'
+ *
+ * @return 0 on success or 1 on error
+ */
+static int load_one_extension_cb(void *closure, struct json_object *value)
+{
+	int (*loader)(struct json_object *) = closure;
+	struct json_object *path;
+	int rc, span;
+
+	if (!json_object_object_get_ex(value, "path", &path))
+		path = value;
+	span = afb_binder_profile_begin("extension", json_object_get_string(path));
+	rc = loader(value);
+	afb_binder_profile_end(span);
+	return rc < 0;
+}
+#endif
+
+/*---------------------------------------------------------
+ | reload of the config
+ +--------------------------------------------------------- */
+
+/* count of items of a value being a single item or an array */
+static int item_count(struct json_object *value)
+{
+	return value == NULL ? 0 : json_object_is_type(value, json_type_array) ? (int)json_object_array_length(value) : 1;
+}
+
+/* item of index 'idx' of a value being a single item or an array */
+static const char *item_at(struct json_object *value, int idx)
+{
+	return json_object_get_string(json_object_is_type(value, json_type_array) ? json_object_array_get_idx(value, idx) : value);
+}
+
+/**
+ * Applies the items of 'newval' not in 'oldval' using 'add'.
+ * When some items are added, the items now effective, the ones of 'oldval'
+ * and the added ones, are recorded for 'key' in 'config', the config
+ * being built, so that next reloads don't add them again even if a
+ * restart is needed.
+ *
+ * @return 1 if applied, 0 if some items of 'oldval' are removed
+ *         or if adding an item failed
+ */
+static int reload_items(struct json_object *config, const char *key, struct json_object *oldval, struct json_object *newval,
+			int (*add)(void *closure, const char *value), void *closure)
+{
+	int iold, inew, nold = item_count(oldval), nnew = item_count(newval), result = 1;
+	struct json_object *effective = NULL;
+
+	for (iold = 0 ; iold < nold ; iold++) {
+		for (inew = 0 ; inew < nnew && strcmp(item_at(oldval, iold), item_at(newval, inew)) ; inew++);
+		if (inew == nnew)
+			result = 0;
+	}
+	for (inew = 0 ; inew < nnew ; inew++) {
+		for (iold = 0 ; iold < nold && strcmp(item_at(oldval, iold), item_at(newval, inew)) ; iold++);
+		if (iold < nold)
+			continue;
+		if (!add(closure, item_at(newval, inew))) {
+			LIBAFB_ERROR("can't add %s", item_at(newval, inew));
+			result = 0;
+			continue;
+		}
+		if (effective == NULL) {
+			effective = json_object_new_array();
+			for (iold = 0 ; iold < nold ; iold++)
+				json_object_array_add(effective, json_object_new_string(item_at(oldval, iold)));
+		}
+		json_object_array_add(effective, json_object_new_string(item_at(newval, inew)));
+	}
+	if (effective != NULL)
+		json_object_object_add(config, key, effective);
+	return result;
+}
+
+/**
+ * Applies the change of the value of 'key' from 'oldval' to 'newval'
+ * (NULL when removed) of the new config 'newconf', 'config' being the
+ * config built from the current one
+ *
+ * @return 1 if applied, 0 if a restart is needed
+ */
+static int reload_key(struct json_object *config, struct json_object *newconf, const char *key,
+			struct json_object *oldval, struct json_object *newval)
+{
+	struct run_export re = { Export_Private, NULL };
+	int value, idx;
+
+	/* already set when parsing the new config */
+	if (!strcmp(key, "log"))
+		return 1;
+
+#if WITH_AFB_HOOK
+	for (idx = 0 ; idx < (int)(sizeof trace_keys / sizeof *trace_keys) ; idx++)
+		if (!strcmp(key, trace_keys[idx]))
+			return install_trace_hook(newconf, key) == 0;
+#endif
+
+	if (!strcmp(key, "ws-client")) {
+		re.starter = afb_api_ws_add_client_weak;
+		return reload_items(config, key, oldval, newval, run_start_export, &re);
+	}
+	if (!strcmp(key, "rpc-client")) {
+		re.starter = afb_api_rpc_add_client_weak;
+		return reload_items(config, key, oldval, newval, run_start_export, &re);
+	}
+#if WITH_LIBMICROHTTPD
+	if (!strcmp(key, "alias"))
+		return afb_binder_http_server != NULL
+			&& reload_items(config, key, oldval, newval, init_alias, afb_binder_http_server);
+#endif
+
+	/* integer values */
+	if (newval == NULL || !json_object_is_type(newval, json_type_int))
+		return 0;
+	value = json_object_get_int(newval);
+	if (!strcmp(key, "apitimeout")) {
+		afb_apiset_timeout_set(afb_binder_main_apiset, value);
+		afb_apiset_timeout_set(afb_binder_public_apiset, value);
+		return 1;
+	}
+	if (!strcmp(key, "jobs-max")) {
+		afb_jobs_set_max_count(value < DEFAULT_JOBS_MIN ? DEFAULT_JOBS_MIN : value);
+		return 1;
+	}
+#if WITH_LIBMICROHTTPD
+	if (!strcmp(key, "cache-eol")) {
+		if (afb_binder_http_server == NULL
+		 || !afb_hsrv_set_cache_timeout(afb_binder_http_server, value))
+			return 0;
+		afb_binder_static_set_cache_timeout(value);
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+/**
+ * Reads again the config and applies the changes that can be applied
+ * safely. The keys whose change needs a restart are reported.
+ *
+ * The current config is never modified because other threads may read
+ * it: the changes are applied to a copy sharing its values, then that
+ * copy replaces it. The replaced configs are kept because extensions
+ * and the supervision can hold references to their values.
+ */
+static void reload_config_job(int signum, void *arg)
+{
+	static struct json_object *replaced;
+	struct json_object *current = afb_binder_main_config;
+	struct json_object *newconf, *config, *applied, *restart, *oldval;
+
+	if (signum)
+		return;
+
+	if (afb_binder_opts_parse_reload(main_argc, main_argv, &newconf) < 0) {
+		LIBAFB_ERROR("can't reload the config, it is unchanged");
+		return;
+	}
+
+	config = json_object_new_object();
+	json_object_object_foreach(current, curkey, curval)
+		json_object_object_add(config, curkey, json_object_get(curval));
+	applied = json_object_new_array();
+	restart = json_object_new_array();
+
+	/* changed or added keys */
+	json_object_object_foreach(newconf, key, newval) {
+		if (!json_object_object_get_ex(current, key, &oldval))
+			oldval = NULL;
+		if (json_object_equal(oldval, newval))
+			continue;
+		if (reload_key(config, newconf, key, oldval, newval)) {
+			json_object_array_add(applied, json_object_new_string(key));
+			json_object_object_add(config, key, json_object_get(newval));
+		}
+		else
+			json_object_array_add(restart, json_object_new_string(key));
+	}
+
+	/* removed keys */
+	json_object_object_foreach(current, oldkey, oldobj) {
+		if (json_object_object_get_ex(newconf, oldkey, NULL))
+			continue;
+		if (reload_key(config, newconf, oldkey, oldobj, NULL)) {
+			json_object_array_add(applied, json_object_new_string(oldkey));
+			json_object_object_del(config, oldkey);
+		}
+		else
+			json_object_array_add(restart, json_object_new_string(oldkey));
+	}
+
+	/* publish the new config */
+	if (replaced == NULL)
+		replaced = json_object_new_array();
+	json_object_array_add(replaced, current);
+	__atomic_store_n(&afb_binder_main_config, config, __ATOMIC_RELEASE);
+
+	LIBAFB_NOTICE("config reloaded, applied changes: %s", json_object_to_json_string(applied));
+	if (json_object_array_length(restart))
+		LIBAFB_WARNING("config changes needing a restart: %s", json_object_to_json_string(restart));
+
+	json_object_put(restart);
+	json_object_put(applied);
+	json_object_put(newconf);
+}
+
 /*---------------------------------------------------------
  | main
  |   Parse option and launch action
@@ -1447,11 +2185,14 @@ error:
 int main(int argc, char *argv[])
 {
 	struct json_object *obj;
-	int njobs, nthr, nthrini, rc;
+	int njobs, nthr, nthrini, rc, span;
 
 #if WITH_AFB_DEBUG
 	afb_debug("main-entry");
 #endif
+	span = afb_binder_profile_begin("config", "config");
+	main_argc = argc;
+	main_argv = argv;
 
 	// ------------- Build session handler & init config -------
 	afb_binder_main_config = json_object_new_object();
@@ -1462,18 +2203,22 @@ int main(int argc, char *argv[])
 #if WITH_EXTENSION
 	/* load extensions */
 	if (json_object_object_get_ex(afb_binder_main_config, "extension", &obj)
-	 && afb_extend_load_set_of_extensions(obj) < 0) {
+	 && rp_jsonc_optarray_until(obj, load_one_extension_cb, afb_extend_load_set_of_extensions)) {
 		LIBAFB_ERROR("loading extension failed");
 		return 1;
 	}
 	if (json_object_object_get_ex(afb_binder_main_config, "extpaths", &obj)
-	 && afb_extend_load_set_of_extpaths(obj) < 0) {
+	 && rp_jsonc_optarray_until(obj, load_one_extension_cb, afb_extend_load_set_of_extpaths)) {
 		LIBAFB_ERROR("loading extension failed");
 		return 1;
 	}
 #endif
 
 	afb_binder_opts_parse_final(argc, argv, &afb_binder_main_config);
+	afb_binder_profile_end(span);
+	afb_binder_profile_enable(
+		json_object_object_get_ex(afb_binder_main_config, "startup-profile", &obj)
+			? json_object_get_string(obj) : NULL);
 
 	if (afb_sig_monitor_init(
 		!json_object_object_get_ex(afb_binder_main_config, "trap-faults", &obj)
@@ -1525,6 +2270,23 @@ int main(int argc, char *argv[])
 	if (nthrini < 1)
 		nthrini = 1;
 
+	/* place the threads, before deducing the bounds of autoscaling from the available CPUs */
+	if (afb_binder_affinity_set(
+		json_object_object_get_ex(afb_binder_main_config, "threads-cpus", &obj)
+			? json_object_get_string(obj) : NULL,
+		json_object_object_get_ex(afb_binder_main_config, "numa-policy", &obj)
+			? json_object_get_string(obj) : NULL) < 0)
+		return EXIT_FAILURE;
+
+	/* the autoscaling starts from threads-init, up to its given or deduced maximum */
+	if (json_object_object_get_ex(afb_binder_main_config, "threads-autoscale", &obj)) {
+		autoscale_min = nthrini;
+		autoscale_max = json_object_get_int(obj);
+		afb_binder_autoscale_bounds(&autoscale_min, &autoscale_max);
+		nthrini = autoscale_min;
+		nthr = autoscale_max;
+	}
+
 	/* enter job processing */
 	rc = afb_sched_start(nthr, nthrini, njobs, start, NULL);
 	return rc < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
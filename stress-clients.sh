@@ -7,14 +7,25 @@
 ROOT=$(dirname $0)
 echo ROOT=$ROOT
 
-AFB=afb-binder
-CLI="afb-client -e"
+# the load generator (see src/bench/afb-wsload.c, built with -DWITH_BENCH=ON)
+LOAD=${AFB_WSLOAD:-$(type -p afb-wsload)}
+for x in "$ROOT"/build/src/bench/afb-wsload "$ROOT"/*/src/bench/afb-wsload; do
+	test -n "$LOAD" && break
+	test -x "$x" && LOAD="$x"
+done
+if test -z "$LOAD"; then
+	echo "error: afb-wsload not found, build with -DWITH_BENCH=ON or set AFB_WSLOAD" >&2
+	exit 1
+fi
 PORT=12345
 
-sync="-s"
+depth=1
 count=10
 null=false
-eval set -- $(getopt -o c:np:P:s -l count:,null,pipe:,port:,sync -- "$@") || exit
+rate=
+duration=10
+percentiles=
+eval set -- $(getopt -o c:np:P:sr:D:H -l count:,null,pipe:,port:,sync,rate:,duration:,hdr -- "$@") || exit
 while true
 do
 	case "$1" in
@@ -31,7 +42,7 @@ do
 		shift
 		;;
 	-p|--pipe)
-		sync="-p $2"
+		depth="$2"
 		shift 2
 		;;
 	-P|--port)
@@ -39,7 +50,19 @@ do
 		shift 2
 		;;
 	-s|--sync)
-		sync="-s"
+		depth=1
+		shift
+		;;
+	-r|--rate)
+		rate="--rate=$2"
+		shift 2
+		;;
+	-D|--duration)
+		duration="$2"
+		shift 2
+		;;
+	-H|--hdr)
+		percentiles="--percentiles"
 		shift
 		;;
 	--)
@@ -48,7 +71,6 @@ do
 		;;
 	esac
 done
-CLI="$CLI $sync"
 
 OUT="$ROOT/stress-out-clients"
 echo rm $OUT.*
@@ -57,7 +79,7 @@ rm $OUT.* 2> /dev/null
 if $null; then
 	OUT=/dev/null
 else
-	OUT="$OUT.%03d"
+	OUT="$OUT.txt"
 fi
 
 commands() {
@@ -94,22 +116,10 @@ hello eventdel {"tag":"ev2"}
 EOC
 }
 
-r() {
-	while :; do commands; done |
-	$CLI "localhost:$PORT/api" > "$1" 2>&1
-}
-
-echo launch clients...
-declare -A children
-i=1
-while test $i -le $count; do
-	echo " + launch clients $i"
-	r $(printf "$OUT" $i) &
-	children[$!]=$!
-	i=$(expr $i + 1)
-done
-echo "done [${children[*]}]"
-
-trap "kill ${children[*]}" SIGTERM SIGINT SIGQUIT EXIT
-wait ${children[*]}
+SCRIPT=$(mktemp)
+trap "rm -f $SCRIPT" EXIT
+commands > $SCRIPT
 
+echo "launch $count connections, depth $depth ${rate:-closed loop}..."
+$LOAD --connections=$count --depth=$depth --duration=$duration $rate $percentiles \
+	--file=$SCRIPT "$@" "localhost:$PORT/api" | tee "$OUT"